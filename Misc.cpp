@@ -25,9 +25,17 @@
 
 
 #include "Misc.h"
+#include <sys/time.h>
 
 void do_assert_failed(const char *file, int line){
+	GLog().flush(); //What led up to it first
 	fprintf(stderr, "Failure at %s : %i\n", file, line);
 	throw 3;
 }
 
+Real GetWallClockTime(){
+	timeval now;
+	gettimeofday(&now, NULL);
+	return now.tv_sec + 1e-6*now.tv_usec;
+}
+
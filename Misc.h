@@ -43,6 +43,7 @@
 
 #include <memory>
 #include <utility>
+#include <string.h>
 
 #ifdef USE_BOOST
 #include <boost/foreach.hpp>
@@ -68,8 +69,11 @@ typedef double Real;
 #define DBG_LOG_WARNING 2
 #define DBG_LOG_ERROR 1
 #define DBG_LOG_CRITICAL 0
-#define DEBUG_LOG_MESSAGE_LEVEL DBG_LOG_WARNING
-#define DBG_LOG(level, msg) if(level <= DEBUG_LOG_MESSAGE_LEVEL) cout << msg << endl
+#ifndef DEBUG_LOG_MESSAGE_LEVEL
+#define DEBUG_LOG_MESSAGE_LEVEL DBG_LOG_WARNING //The real-time build only logs errors, so that clipping doesn't write to cout
+#endif
+//Messages above DEBUG_LOG_MESSAGE_LEVEL are compiled out, and those above GLog().getLevel() skipped at run time. See logging.h.
+#define DBG_LOG(level, msg) do { if (level <= DEBUG_LOG_MESSAGE_LEVEL && level <= GLog().getLevel()) { static LogSite logSite; if (logSite.admit()) { LogMessage logMessage(logSite.takeNumSuppressed()); logMessage << msg; GLog().post(logMessage); } } } while (0)
 
 #define LOG_INFO(msg) DBG_LOG(DBG_LOG_INFO,"INFO: " << msg)
 #define LOG_WARNING(msg) DBG_LOG(DBG_LOG_WARNING,"WARNING: " << msg)
@@ -82,7 +86,7 @@ typedef double Real;
 #ifndef Assert
 
 #ifndef DEBUG_MODE
-#define DEBUG_MODE true
+#define DEBUG_MODE true //The real-time build defines this as 0, which compiles the checks below out
 #endif
 
 #if DEBUG_MODE
@@ -106,6 +110,7 @@ typedef double Real;
 #define Failure() do_assert_failed(__FILE__, __LINE__)
 
 void do_assert_failed(const char *file, int line);
+Real GetWallClockTime(); //In seconds, unlike clock() it doesn't add up the time of every thread
 
 template < class T >
 string ToString(const T &arg){
@@ -114,4 +119,6 @@ string ToString(const T &arg){
 	return(out.str());
 }
 
+#include "logging.h"
+
 #endif
@@ -91,6 +91,35 @@ Real ConvertdBmToRMSVoltage(Real dBm, Real resistance){
 	return sqrt(x*resistance);
 }
 
+void BicubicTable::setup(uint numXPoints_, uint numYPoints_, Real xMin_, Real xMax_, Real yMin_, Real yMax_){
+	Assert(numXPoints_ >= 2);
+	Assert(numYPoints_ >= 2);
+	Assert(xMax_ > xMin_);
+	Assert(yMax_ > yMin_);
+	numXPoints = numXPoints_;
+	numYPoints = numYPoints_;
+	xMin = xMin_;
+	xMax = xMax_;
+	yMin = yMin_;
+	yMax = yMax_;
+	xScale = ((Real) (numXPoints - 1))/(xMax - xMin);
+	yScale = ((Real) (numYPoints - 1))/(yMax - yMin);
+	stride = numYPoints + 2;
+	table.assign((numXPoints + 2)*stride, 0.0);
+}
+
+void BicubicTable::extrapolateEdges(){
+	for (uint i = 1; i <= numXPoints; ++i) {
+		Real *row = &table[i*stride];
+		row[0] = 2.0*row[1] - row[2];
+		row[numYPoints + 1] = 2.0*row[numYPoints] - row[numYPoints - 1];
+	}
+	for (uint j = 0; j < stride; ++j) {
+		table[j] = 2.0*table[stride + j] - table[2*stride + j];
+		table[(numXPoints + 1)*stride + j] = 2.0*table[numXPoints*stride + j] - table[(numXPoints - 1)*stride + j];
+	}
+}
+
 void FillWithSineWave(Real* output, uint numSamples, uint stepSize, Real amplitude, Real frequency, Real sampleRate){
 	for (uint i = 0; i < numSamples; i += 1){
 		Real t = ((Real) i) / sampleRate;
@@ -67,11 +67,139 @@ public:
 			output[i] = 0.54 - 0.46 * cos( (2.0 * M_PI * ((Real) i)) / ((Real) (length - 1)) );
 		}
 	}
+	
+	/**
+	 * Kaiser window, beta trades main lobe width against side lobe height (beta = 8 gives side
+	 * lobes about 80dB down)
+	 * @return w(i) = I0(beta*sqrt(1 - (2i/(length-1) - 1)^2)) / I0(beta)
+	 */
+	static void getKaiserWindow(uint length, Real beta, Real* output){
+		Assert(output);
+		for (uint i = 0; i < length; ++i){
+			Real x = 2.0 * ((Real) i) / ((Real) (length - 1)) - 1.0;
+			output[i] = besselI0(beta * sqrt(fmax(1.0 - x*x, 0.0))) / besselI0(beta);
+		}
+	}
+	
+	static Real besselI0(Real x){
+		//Power series, converges quickly for the arguments used in windows
+		Real sum = 1.0;
+		Real term = 1.0;
+		for (uint k = 1; k < 100 && term > 1e-17*sum; ++k){
+			Real factor = x / (2.0 * k);
+			term *= factor*factor;
+			sum += term;
+		}
+		return sum;
+	}
 
 private:
 	WindowFunctions() {} //Holder class
 };
 
+class BicubicTable {
+	/*
+	Values of a smooth function f(x, y) sampled on a regular grid and read back with 
+	bicubic (Catmull-Rom) interpolation. The grid has one extra node on each side, 
+	linearly extrapolated from the edge, so that the kernel never reads outside it.
+	*/
+public:
+	BicubicTable() : numXPoints(0), numYPoints(0), stride(0) {}
+	
+	void setup(uint numXPoints_, uint numYPoints_, Real xMin_, Real xMax_, Real yMin_, Real yMax_);
+	void extrapolateEdges(); //Call once all the nodes have been set
+	
+	Real getNodeX(uint i) const { return xMin + ((Real) i)/xScale; }
+	Real getNodeY(uint j) const { return yMin + ((Real) j)/yScale; }
+	void setNode(uint i, uint j, Real value) { table[(i + 1)*stride + j + 1] = value; }
+	
+	uint getNumXPoints() const { return numXPoints; }
+	uint getNumYPoints() const { return numYPoints; }
+	bool isEmpty() const { return numXPoints == 0; }
+	
+	bool contains(Real x, Real y) const {
+		return x >= xMin && x <= xMax && y >= yMin && y <= yMax;
+	}
+	
+	Real interpolate(Real x, Real y) const {
+		Real wx[4];
+		Real wy[4];
+		const Real *row = getCell(x, y, wx, wy);
+		Real value = 0.0;
+		for (uint k = 0; k < 4; ++k) {
+			value += wx[k]*(wy[0]*row[0] + wy[1]*row[1] + wy[2]*row[2] + wy[3]*row[3]);
+			row += stride;
+		}
+		return value;
+	}
+	
+	Real interpolate(Real x, Real y, Real& dValuedy) const {
+		Real wx[4];
+		Real wy[4];
+		Real dwy[4];
+		const Real *row = getCell(x, y, wx, wy, dwy);
+		Real value = 0.0;
+		Real dValue = 0.0;
+		for (uint k = 0; k < 4; ++k) {
+			value += wx[k]*(wy[0]*row[0] + wy[1]*row[1] + wy[2]*row[2] + wy[3]*row[3]);
+			dValue += wx[k]*(dwy[0]*row[0] + dwy[1]*row[1] + dwy[2]*row[2] + dwy[3]*row[3]);
+			row += stride;
+		}
+		dValuedy = dValue*yScale;
+		return value;
+	}
+
+protected:
+	const Real* getCell(Real x, Real y, Real* wx, Real* wy, Real* dwy=NULL) const {
+		Real u = (x - xMin)*xScale;
+		Real v = (y - yMin)*yScale;
+		uint i = (uint) u;
+		uint j = (uint) v;
+		if (i > numXPoints - 2) {
+			i = numXPoints - 2;
+		}
+		if (j > numYPoints - 2) {
+			j = numYPoints - 2;
+		}
+		getCubicWeights(u - i, wx);
+		getCubicWeights(v - j, wy);
+		if (dwy) {
+			getCubicWeightDerivatives(v - j, dwy);
+		}
+		//Padded table, so node (i-1, j-1) is at index (i, j)
+		return &table[i*stride + j];
+	}
+	
+	static inline void getCubicWeights(Real t, Real* w){
+		//Catmull-Rom spline weights for the nodes at -1, 0, 1 and 2
+		Real t2 = t*t;
+		Real t3 = t2*t;
+		w[0] = 0.5*(-t3 + 2.0*t2 - t);
+		w[1] = 0.5*(3.0*t3 - 5.0*t2 + 2.0);
+		w[2] = 0.5*(-3.0*t3 + 4.0*t2 + t);
+		w[3] = 0.5*(t3 - t2);
+	}
+	static inline void getCubicWeightDerivatives(Real t, Real* dw){
+		Real t2 = t*t;
+		dw[0] = 0.5*(-3.0*t2 + 4.0*t - 1.0);
+		dw[1] = 0.5*(9.0*t2 - 10.0*t);
+		dw[2] = 0.5*(-9.0*t2 + 8.0*t + 1.0);
+		dw[3] = 0.5*(3.0*t2 - 2.0*t);
+	}
+
+protected:
+	uint numXPoints;
+	uint numYPoints;
+	Real xMin;
+	Real xMax;
+	Real yMin;
+	Real yMax;
+	Real xScale;
+	Real yScale;
+	uint stride;
+	vector<Real> table;
+};
+
 }
 
 #endif
\ No newline at end of file
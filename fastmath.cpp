@@ -0,0 +1,167 @@
+/************************************************************************************
+* 
+* Wavechild670 v0.1 
+* 
+* fastmath.cpp
+* 
+* By Peter Raffensperger 11 March 2014
+* 
+* Reference:
+* Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+* Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+* York, UK, September 17-21, 2012.
+* 
+* Note:
+* Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+* affiliated with the author.
+* 
+* License:
+* Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+* software in an academic context, we would appreciate it if you referenced the original
+* paper.
+* 
+************************************************************************************/
+
+
+
+#include "fastmath.h"
+
+namespace FastMath {
+
+bool useApproximations = false;
+
+const uint64_t exp2TableBits[64] = {
+	0x3FF0000000000000ULL, 0x3FEFEC9A3E778061ULL, 0x3FEFD9B0D3158574ULL, 0x3FEFC74518759BC8ULL,
+	0x3FEFB5586CF9890FULL, 0x3FEFA3EC32D3D1A2ULL, 0x3FEF9301D0125B51ULL, 0x3FEF829AAEA92DE0ULL,
+	0x3FEF72B83C7D517BULL, 0x3FEF635BEB6FCB75ULL, 0x3FEF54873168B9AAULL, 0x3FEF463B88628CD6ULL,
+	0x3FEF387A6E756238ULL, 0x3FEF2B4565E27CDDULL, 0x3FEF1E9DF51FDEE1ULL, 0x3FEF1285A6E4030BULL,
+	0x3FEF06FE0A31B715ULL, 0x3FEEFC08B26416FFULL, 0x3FEEF1A7373AA9CBULL, 0x3FEEE7DB34E59FF7ULL,
+	0x3FEEDEA64C123422ULL, 0x3FEED60A21F72E2AULL, 0x3FEECE086061892DULL, 0x3FEEC6A2B5C13CD0ULL,
+	0x3FEEBFDAD5362A27ULL, 0x3FEEB9B2769D2CA7ULL, 0x3FEEB42B569D4F82ULL, 0x3FEEAF4736B527DAULL,
+	0x3FEEAB07DD485429ULL, 0x3FEEA76F15AD2148ULL, 0x3FEEA47EB03A5585ULL, 0x3FEEA23882552225ULL,
+	0x3FEEA09E667F3BCDULL, 0x3FEE9FB23C651A2FULL, 0x3FEE9F75E8EC5F74ULL, 0x3FEE9FEB564267C9ULL,
+	0x3FEEA11473EB0187ULL, 0x3FEEA2F336CF4E62ULL, 0x3FEEA589994CCE13ULL, 0x3FEEA8D99B4492EDULL,
+	0x3FEEACE5422AA0DBULL, 0x3FEEB1AE99157736ULL, 0x3FEEB737B0CDC5E5ULL, 0x3FEEBD829FDE4E50ULL,
+	0x3FEEC49182A3F090ULL, 0x3FEECC667B5DE565ULL, 0x3FEED503B23E255DULL, 0x3FEEDE6B5579FDBFULL,
+	0x3FEEE89F995AD3ADULL, 0x3FEEF3A2B84F15FBULL, 0x3FEEFF76F2FB5E47ULL, 0x3FEF0C1E904BC1D2ULL,
+	0x3FEF199BDD85529CULL, 0x3FEF27F12E57D14BULL, 0x3FEF3720DCEF9069ULL, 0x3FEF472D4A07897CULL,
+	0x3FEF5818DCFBA487ULL, 0x3FEF69E603DB3285ULL, 0x3FEF7C97337B9B5FULL, 0x3FEF902EE78B3FF6ULL,
+	0x3FEFA4AFA2A490DAULL, 0x3FEFBA1BEE615A27ULL, 0x3FEFD0765B6E4540ULL, 0x3FEFE7C1819E90D8ULL
+};
+
+
+const Real logCentres[128] = {
+	0.689453125, 0.693359375, 0.697265625, 0.701171875,
+	0.705078125, 0.708984375, 0.712890625, 0.716796875,
+	0.720703125, 0.724609375, 0.728515625, 0.732421875,
+	0.736328125, 0.740234375, 0.744140625, 0.748046875,
+	0.751953125, 0.755859375, 0.759765625, 0.763671875,
+	0.767578125, 0.771484375, 0.775390625, 0.779296875,
+	0.783203125, 0.787109375, 0.791015625, 0.794921875,
+	0.798828125, 0.802734375, 0.806640625, 0.810546875,
+	0.814453125, 0.818359375, 0.822265625, 0.826171875,
+	0.830078125, 0.833984375, 0.837890625, 0.841796875,
+	0.845703125, 0.849609375, 0.853515625, 0.857421875,
+	0.861328125, 0.865234375, 0.869140625, 0.873046875,
+	0.876953125, 0.880859375, 0.884765625, 0.888671875,
+	0.892578125, 0.896484375, 0.900390625, 0.904296875,
+	0.908203125, 0.912109375, 0.916015625, 0.919921875,
+	0.923828125, 0.927734375, 0.931640625, 0.935546875,
+	0.939453125, 0.943359375, 0.947265625, 0.951171875,
+	0.955078125, 0.958984375, 0.962890625, 0.966796875,
+	0.970703125, 0.974609375, 0.978515625, 0.982421875,
+	0.986328125, 0.990234375, 0.994140625, 1.0,
+	1.0, 1.01171875, 1.01953125, 1.02734375,
+	1.03515625, 1.04296875, 1.05078125, 1.05859375,
+	1.06640625, 1.07421875, 1.08203125, 1.08984375,
+	1.09765625, 1.10546875, 1.11328125, 1.12109375,
+	1.12890625, 1.13671875, 1.14453125, 1.15234375,
+	1.16015625, 1.16796875, 1.17578125, 1.18359375,
+	1.19140625, 1.19921875, 1.20703125, 1.21484375,
+	1.22265625, 1.23046875, 1.23828125, 1.24609375,
+	1.25390625, 1.26171875, 1.26953125, 1.27734375,
+	1.28515625, 1.29296875, 1.30078125, 1.30859375,
+	1.31640625, 1.32421875, 1.33203125, 1.33984375,
+	1.34765625, 1.35546875, 1.36328125, 1.37109375
+};
+
+const Real logInverseCentres[128] = {
+	1.4504249291784703, 1.4422535211267606, 1.4341736694677871, 1.426183844011142,
+	1.4182825484764543, 1.4104683195592287, 1.4027397260273973, 1.3950953678474114,
+	1.3875338753387534, 1.3800539083557952, 1.3726541554959786, 1.3653333333333333,
+	1.3580901856763925, 1.3509234828496042, 1.3438320209973753, 1.3368146214099217,
+	1.3298701298701299, 1.322997416020672, 1.3161953727506426, 1.3094629156010231,
+	1.3027989821882953, 1.2962025316455696, 1.2896725440806045, 1.2832080200501252,
+	1.2768079800498753, 1.2704714640198511, 1.2641975308641975, 1.257985257985258,
+	1.2518337408312958, 1.245742092457421, 1.2397094430992737, 1.2337349397590363,
+	1.2278177458033572, 1.2219570405727924, 1.2161520190023754, 1.210401891252955,
+	1.204705882352941, 1.199063231850117, 1.1934731934731935, 1.1879350348027842,
+	1.1824480369515011, 1.1770114942528735, 1.17162471395881, 1.1662870159453302,
+	1.1609977324263039, 1.1557562076749435, 1.150561797752809, 1.145413870246085,
+	1.1403118040089086, 1.1352549889135255, 1.130242825607064, 1.1252747252747253,
+	1.1203501094091903, 1.1154684095860568, 1.1106290672451193, 1.1058315334773219,
+	1.1010752688172043, 1.0963597430406853, 1.091684434968017, 1.0870488322717622,
+	1.0824524312896406, 1.0778947368421052, 1.0733752620545074, 1.068893528183716,
+	1.0644490644490645, 1.060041407867495, 1.0556701030927835, 1.051334702258727,
+	1.047034764826176, 1.0427698574338085, 1.0385395537525355, 1.0343434343434343,
+	1.0301810865191148, 1.0260521042084167, 1.0219560878243512, 1.0178926441351888,
+	1.0138613861386139, 1.009861932938856, 1.005893909626719, 1.0,
+	1.0, 0.9884169884169884, 0.9808429118773946, 0.973384030418251,
+	0.9660377358490566, 0.9588014981273408, 0.9516728624535316, 0.9446494464944649,
+	0.9377289377289377, 0.9309090909090909, 0.924187725631769, 0.9175627240143369,
+	0.9110320284697508, 0.9045936395759717, 0.8982456140350877, 0.89198606271777,
+	0.8858131487889274, 0.8797250859106529, 0.8737201365187713, 0.8677966101694915,
+	0.8619528619528619, 0.8561872909698997, 0.8504983388704319, 0.8448844884488449,
+	0.839344262295082, 0.8338762214983714, 0.8284789644012945, 0.8231511254019293,
+	0.8178913738019169, 0.8126984126984127, 0.807570977917981, 0.8025078369905956,
+	0.7975077881619937, 0.7925696594427245, 0.7876923076923077, 0.7828746177370031,
+	0.7781155015197568, 0.7734138972809668, 0.7687687687687688, 0.764179104477612,
+	0.7596439169139466, 0.7551622418879056, 0.750733137829912, 0.7463556851311953,
+	0.7420289855072464, 0.7377521613832853, 0.7335243553008596, 0.7293447293447294
+};
+
+const Real logTable[128] = {
+	-0.37185656810621104, -0.366206835564092, -0.36058884325986873, -0.3550022365512289,
+	-0.3494466667066269, -0.343921790774657, -0.3384272714570163, -0.33296277698493754,
+	-0.3275279809989806, -0.32212256243207266, -0.31674620539569226, -0.31139859906909695,
+	-0.30607943759149703, -0.30078841995708144, -0.2955252499128068, -0.2902896358588618,
+	-0.28508129075172356, -0.27989993200972596, -0.27474528142106147, -0.269617065054142,
+	-0.26451501317024656, -0.2594388601383859, -0.2543883443523174, -0.24936320814964433,
+	-0.2443631977329386, -0.23938806309282482, -0.23443755793296864, -0.2295114395969128,
+	-0.22460946899670603, -0.21973141054327316, -0.21487703207847503, -0.21004610480880948,
+	-0.20523840324070633, -0.20045370511737004, -0.19569179135712636, -0.1909524459932298,
+	-0.18623545611509096, -0.18154061181088324, -0.1768677061114908, -0.17221653493576,
+	-0.16758689703701793, -0.1629785939508237, -0.15839142994391764, -0.15382521196433643,
+	-0.1492797495926618, -0.14475485499437216, -0.14025034287326757, -0.13576603042593896,
+	-0.1313017372972535, -0.12685728553682943, -0.12243249955647377, -0.11802720608855737,
+	-0.11364123414530308, -0.10927441497896263, -0.10492658204285926, -0.10059757095327371,
+	-0.09628721945215148, -0.09199536737061047, -0.08772185659322843, -0.08346653102309004,
+	-0.07922923654757481, -0.07500982100486657, -0.07080813415116657, -0.06662402762859256,
+	-0.06245735493374661, -0.058307971386935095, -0.054175734102024586, -0.050060501956918,
+	-0.045962135564635756, -0.04188049724498721, -0.03781545099681768, -0.033766862470817484,
+	-0.029734598942879057, -0.02571852928798912, -0.021718523954642986, -0.01773445493976858,
+	-0.013766195764147959, -0.009813621448324622, -0.005876608488985042, 0.0,
+	0.0, 0.011650617219975274, 0.019342962843130935, 0.026976587698202076,
+	0.034552381506659735, 0.04207121392068706, 0.04953393512227663, 0.056941376400138424,
+	0.06429435070539725, 0.07159365318700882, 0.07884006170777602, 0.08603433734180316,
+	0.0931772248541833, 0.10026945316367515, 0.10731173578908805, 0.11430477128005863,
+	0.12124924363286968, 0.12814582269193003, 0.13499516453750482, 0.14179791186025734,
+	0.14855469432313714, 0.15526612891112396, 0.16193282026931324, 0.16855536102980667,
+	0.17513433212784915, 0.18167030310763468, 0.188163832418183, 0.19461546769967167,
+	0.20102574606059073, 0.2073951943460706, 0.21372432939771813, 0.2200136583052821,
+	0.22626367865045338, 0.23247487874309405, 0.238647737850175, 0.24478272641769092,
+	0.25088030628580943, 0.2569409308975004, 0.26296504550088134, 0.26895308734550394,
+	0.2749054858727992, 0.2808226629008878, 0.2867050328039543, 0.29255300268637746,
+	0.2983669725517973, 0.3041473354672967, 0.3098944777228647, 0.31560877898630335
+};
+
+void setUseApproximations(bool useApproximationsNew){
+	useApproximations = useApproximationsNew;
+	LOG_INFO("Hot path math using " << (useApproximations ? "approximations" : "libm"));
+}
+
+bool getUseApproximations(){
+	return useApproximations;
+}
+
+}
@@ -0,0 +1,148 @@
+/************************************************************************************
+* 
+* Wavechild670 v0.1 
+* 
+* fastmath.h
+* 
+* By Peter Raffensperger 11 March 2014
+* 
+* Reference:
+* Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+* Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+* York, UK, September 17-21, 2012.
+* 
+* Note:
+* Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+* affiliated with the author.
+* 
+* License:
+* Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+* software in an academic context, we would appreciate it if you referenced the original
+* paper.
+* 
+************************************************************************************/
+
+
+#ifndef FASTMATH_H
+#define FASTMATH_H
+
+/*
+Approximate exp, log and log1p for the per sample hot path (the 6386 tube model and the
+sidechain amplifier). They inline, skip the special case handling of libm and only cover the
+arguments the models produce. The FastMath::exp etc. wrappers pick between these and libm at run
+time, libm is the default. --testFastMath reports the error and speed of each and the effect on
+rendered output.
+
+Maximum errors against libm, measured by --testFastMath over the domains given:
+	approxExp    x in [-700, 709]                   1 ulp
+	approxLog    x positive and normal              1 ulp
+	approxLog1p  x in (-1, 1e15]                    1.002 ulp, just over 1 near x = -0.86
+There's no pow: exp(y*log(x)) came out at 0.9-1.2x the speed of libm's pow, for up to 15 ulp of 
+error, so the tube model calls libm's. approxExp clamps its argument to [-700, 709], which also keeps the results clear of
+the subnormal range where the arithmetic gets slow. Other arguments outside these domains give
+meaningless results, and NaNs are not propagated.
+*/
+
+#include "Misc.h"
+#include <stdint.h>
+#include <string.h>
+
+namespace FastMath {
+
+extern bool useApproximations;
+extern const uint64_t exp2TableBits[64]; //2^(j/64) with j << 46 taken off, see approxExp
+extern const Real logCentres[128];
+extern const Real logInverseCentres[128]; //1/c
+extern const Real logTable[128]; //log(c)
+
+void setUseApproximations(bool useApproximationsNew);
+bool getUseApproximations();
+
+inline Real fromBits(uint64_t bits){
+	Real x;
+	memcpy(&x, &bits, sizeof(x));
+	return x;
+}
+inline uint64_t toBits(Real x){
+	uint64_t bits;
+	memcpy(&bits, &x, sizeof(bits));
+	return bits;
+}
+
+inline Real approxExp(Real x){
+	/*
+	x = (64*e + j)*ln(2)/64 + r with |r| <= ln(2)/128, so exp(x) = 2^e * 2^(j/64) * exp(r), and a
+	degree 5 polynomial is enough for exp(r). k = 64*e + j is read straight out of the bits of the
+	rounded value and adding k << 46 to the table entry puts e in the exponent.
+	*/
+	const Real shifter = 6755399441055744.0; //1.5*2^52, adding it rounds to an integer
+	const Real ln2Over64Hi = 0.010830424696905538; //ln(2)/64 to 32 bits, so k*ln2Over64Hi is exact
+	const Real ln2Over64Lo = -6.563929801064195e-13;
+	if (x > 709.0) {
+		x = 709.0;
+	}
+	if (x < -700.0) {
+		x = -700.0;
+	}
+	Real kShifted = x*92.33248261689366 + shifter;
+	uint64_t ki = toBits(kShifted) - toBits(shifter);
+	Real k = kShifted - shifter;
+	Real r = (x - k*ln2Over64Hi) - k*ln2Over64Lo;
+	Real t = fromBits(exp2TableBits[ki & 63] + (ki << 46));
+	Real r2 = r*r;
+	Real p = r + (r2*(0.5 + r*(1.0/6.0)) + (r2*r2)*((1.0/24.0) + r*(1.0/120.0)));
+	return t + t*p;
+}
+
+inline Real approxLog(Real x, Real correction){
+	/*
+	log(x + correction) for |correction| no more than about an ulp of x, which lets approxLog1p 
+	fold in the rounding error of 1 + x without a division.
+	
+	x = 2^k*z with z in [0.6875, 1.375), which is split into 128 intervals each with a centre c, so
+	log(x) = k*ln(2) + log(c) + log(1 + r) with r = (z - c)/c, |r| < 1/128. z - c is exact, and
+	c = 1 for the two intervals either side of 1 so that r doesn't cancel against log(c) there. A
+	degree 8 Taylor polynomial is enough for log(1 + r).
+	*/
+	const Real ln2Hi = 0.6931471805598903; //ln(2) to 42 bits, so k*ln2Hi is exact
+	const Real ln2Lo = 5.497923018708371e-14;
+	uint64_t bits = toBits(x);
+	uint64_t offsetBits = bits - 0x3FE6000000000000ULL;
+	uint i = (uint) ((offsetBits >> 45) & 127);
+	uint64_t exponentBits = offsetBits & 0xFFF0000000000000ULL;
+	Real k = (Real) (((int64_t) offsetBits) >> 52);
+	Real z = fromBits(bits - exponentBits);
+	Real correctionScaled = correction*fromBits(0x3FF0000000000000ULL - exponentBits); //correction*2^-k
+	Real r = (z - logCentres[i])*logInverseCentres[i] + correctionScaled*logInverseCentres[i];
+	Real r2 = r*r;
+	Real r4 = r2*r2;
+	Real p = r2*(-0.5 + r*(1.0/3.0)) + r4*((-0.25 + r*0.2) + r2*((-1.0/6.0) + r*(1.0/7.0)) + r4*(-0.125));
+	return (k*ln2Hi + logTable[i]) + (r + (p + k*ln2Lo));
+}
+
+inline Real approxLog(Real x){
+	return approxLog(x, 0.0);
+}
+
+inline Real approxLog1p(Real x){
+	//log(u) where u = 1 + x, corrected for the rounding error in u
+	if (fabs(x) < 1e-17) {
+		return x; //Also keeps the polynomial out of the (slow) subnormal range
+	}
+	Real u = 1.0 + x;
+	return approxLog(u, x - (u - 1.0));
+}
+
+inline Real exp(Real x){
+	return useApproximations ? approxExp(x) : ::exp(x);
+}
+inline Real log(Real x){
+	return useApproximations ? approxLog(x) : ::log(x);
+}
+inline Real log1p(Real x){
+	return useApproximations ? approxLog1p(x) : ::log1p(x);
+}
+
+}
+
+#endif
@@ -35,6 +35,7 @@ class BidirectionalUnitDelay;
 class BidirectionalUnitDelayInterface {
 public:
 	friend class BidirectionalUnitDelay;
+	BidirectionalUnitDelayInterface() : a(0.0), b(0.0) {}
 	void setA(Real a_){ a = a_; }
 	Real getB() { return b;}
 protected:
@@ -54,6 +55,25 @@ public:
 		interface0.b = interface1.a;
 		interface1.b = interface0.a;
 	}
+	
+	struct State {
+		Real a0;
+		Real b0;
+		Real a1;
+		Real b1;
+	};
+	void saveState(State& state) const {
+		state.a0 = interface0.a;
+		state.b0 = interface0.b;
+		state.a1 = interface1.a;
+		state.b1 = interface1.b;
+	}
+	void loadState(const State& state) {
+		interface0.a = state.a0;
+		interface0.b = state.b0;
+		interface1.a = state.a1;
+		interface1.b = state.b1;
+	}
 protected:
 	BidirectionalUnitDelayInterface interface0;
 	BidirectionalUnitDelayInterface interface1;
@@ -121,6 +121,7 @@ def GenerateTubeStageCircuit():
 	g.ConstructorItem('tube', 'tube(tube_)', 'WDFTubeInterface', parameter='tube_', reference=True)		
 	g.RValue('cathodeCapacitorConn', 'cathodeCapacitorConn = cathodeCapacitorConn_', parameter='cathodeCapacitorConn_', type='BidirectionalUnitDelayInterface*')
 	g.RValue('tubeR', 'tubeR = tubeSeriesConn2_3R')	
+	g.RCheck('tube.setPortResistance(tubeR)')
 	g.RCheck('LOG_INFO(" ")')
 	g.RCheck('LOG_INFO("outputParallelConn_3Gamma1=" << outputParallelConn_3Gamma1)')
 	g.RCheck('LOG_INFO("cathodeCapSeriesConn_3Gamma1=" << cathodeCapSeriesConn_3Gamma1)')
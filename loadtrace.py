@@ -0,0 +1,105 @@
+##########################################################################################
+# 
+# Wavechild670 v0.1 
+# 
+# loadtrace.py
+# 
+# By Peter Raffensperger 11 March 2014
+# 
+# Reference:
+# Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+# Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+# York, UK, September 17-21, 2012.
+# 
+# Note:
+# Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+# affiliated with the author.
+# 
+# License:
+# Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+# software in an academic context, we would appreciate it if you referenced the original
+# paper.
+# 
+##########################################################################################
+"""
+Loads the binary probe traces written by Wavechild670's --trace option (see tracewriter.h) into 
+numpy arrays. Samples the trace writer had to drop are NaN, so every probe stays in time.
+
+	import loadtrace
+	probes, sampleRate = loadtrace.LoadTrace('render.wc670trace')
+	VlevelCapA = probes['VlevelCapA']
+"""
+
+import struct
+import sys
+
+import numpy
+
+TRACE_MAGIC = 'WC670TRC'
+TRACE_VERSION = 1
+TRACE_RECORD_DEFINE = 1
+TRACE_RECORD_DATA = 2
+TRACE_RECORD_GAP = 3
+
+def LoadTrace(filename):
+	"""
+	Returns a dict of probe name to array, and the trace's sample rate. Probes with one channel are 
+	1D arrays, probes with several are (numFrames, numChannels).
+	"""
+	f = open(filename, 'rb')
+	data = f.read()
+	f.close()
+	
+	if data[0:8] != TRACE_MAGIC.encode('ascii'):
+		raise ValueError('%s is not a Wavechild670 trace' % filename)
+	version, sampleRate = struct.unpack_from('<Id', data, 8)
+	if version != TRACE_VERSION:
+		raise ValueError('%s is a version %d trace, expected %d' % (filename, version, TRACE_VERSION))
+	
+	names = {}
+	numChannels = {}
+	chunks = {}
+	position = 20
+	while position < len(data):
+		recordType, column = struct.unpack_from('<II', data, position)
+		position += 8
+		if recordType == TRACE_RECORD_DEFINE:
+			channels, nameLength = struct.unpack_from('<II', data, position)
+			position += 8
+			names[column] = data[position:position + nameLength].decode('ascii')
+			numChannels[column] = channels
+			chunks.setdefault(column, [])
+			position += nameLength
+		elif recordType == TRACE_RECORD_DATA:
+			count, = struct.unpack_from('<I', data, position)
+			position += 4
+			if column not in chunks:
+				raise ValueError('%s has data for undefined column %d' % (filename, column))
+			chunks[column].append(numpy.frombuffer(data, dtype='<f8', count=count, offset=position))
+			position += 8*count
+		elif recordType == TRACE_RECORD_GAP:
+			count, = struct.unpack_from('<I', data, position)
+			position += 4
+			if column not in chunks:
+				raise ValueError('%s has a gap for undefined column %d' % (filename, column))
+			chunks[column].append(numpy.nan*numpy.ones(count))
+		else:
+			raise ValueError('%s is corrupt at byte %d' % (filename, position - 8))
+	
+	probes = {}
+	for column in names:
+		if chunks[column]:
+			samples = numpy.concatenate(chunks[column])
+		else:
+			samples = numpy.zeros(0)
+		if numChannels[column] > 1:
+			numFrames = len(samples) // numChannels[column]
+			samples = samples[:numFrames*numChannels[column]].reshape((numFrames, numChannels[column]))
+		probes[names[column]] = samples
+	return probes, sampleRate
+
+if __name__ == '__main__':
+	probes, sampleRate = LoadTrace(sys.argv[1])
+	print('Sample rate %g' % sampleRate)
+	for name in sorted(probes):
+		print('%s: %s' % (name, probes[name].shape))
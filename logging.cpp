@@ -0,0 +1,207 @@
+/************************************************************************************
+* 
+* Wavechild670 v0.1 
+* 
+* logging.cpp
+* 
+* By Peter Raffensperger 11 March 2014
+* 
+* Reference:
+* Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+* Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+* York, UK, September 17-21, 2012.
+* 
+* Note:
+* Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+* affiliated with the author.
+* 
+* License:
+* Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+* software in an academic context, we would appreciate it if you referenced the original
+* paper.
+* 
+************************************************************************************/
+
+
+
+
+#include "logging.h"
+#include <unistd.h>
+#include <stdlib.h>
+
+#define LOG_IDLE_SLEEP_MICROSECONDS 1000
+
+void LogMessage::write(ostream& out) const {
+	for (uint i = 0; i < numArguments; ++i){
+		const Argument& argument = arguments[i];
+		switch (argument.type){
+			case LOG_ARGUMENT_TEXT:
+				out.write(text + argument.textOffset, argument.textLength);
+				break;
+			case LOG_ARGUMENT_INTEGER:
+				out << argument.integer;
+				break;
+			case LOG_ARGUMENT_UNSIGNED:
+				out << argument.unsignedInteger;
+				break;
+			case LOG_ARGUMENT_REAL:
+				out << argument.real;
+				break;
+		}
+	}
+	if (truncated){
+		out << "...";
+	}
+	if (numSuppressed > 0){
+		out << " (" << numSuppressed << " more from here suppressed)";
+	}
+	out << '\n';
+}
+
+Logger::Logger() : level(DEBUG_LOG_MESSAGE_LEVEL), maxMessagesPerSecond(LOG_DEFAULT_MESSAGES_PER_SECOND), running(false), 
+stopRequested(false), numDropped(0), coarseTime(0), numPosting(0), ring(0), head(0), tail(0), stopAtExit(false) {
+	pthread_mutex_init(&writeMutex, NULL);
+}
+
+Logger::~Logger(){
+	stop();
+	delete[] ring;
+	pthread_mutex_destroy(&writeMutex);
+}
+
+static void StopGlobalLogger(){
+	GLog().stop();
+}
+
+void Logger::start(){
+	if (running){
+		return;
+	}
+	if (!ring){
+		ring = new Slot[LOG_RING_LENGTH];
+	}
+	for (ulong i = 0; i < LOG_RING_LENGTH; ++i){
+		ring[i].sequence = i;
+	}
+	head = 0;
+	tail = 0;
+	stopRequested = false;
+	coarseTime = (uint) time(NULL);
+	__sync_synchronize();
+	if (pthread_create(&writerThread, NULL, writerThreadEntry, this) != 0){
+		cout << "ERROR: Couldn't start the log writer thread, logging synchronously" << endl;
+		return;
+	}
+	running = true;
+	if (this == &globalLogger && !stopAtExit){
+		//The writer thread has to finish before the process exits, from main() or exit() alike
+		stopAtExit = true;
+		atexit(StopGlobalLogger);
+	}
+}
+
+void Logger::stop(){
+	if (!running){
+		return;
+	}
+	//New messages are written synchronously from here on, but only once the ring is written out
+	pthread_mutex_lock(&writeMutex);
+	running = false;
+	__sync_synchronize();
+	stopRequested = true;
+	pthread_join(writerThread, NULL);
+	//A post() that saw the logger running may still be filling the slot it claimed
+	while (numPosting > 0 || tail != head){
+		if (!drain()){
+			usleep(LOG_IDLE_SLEEP_MICROSECONDS);
+		}
+	}
+	if (numDropped > 0){
+		cout << "WARNING: The log ring overflowed and " << numDropped << " messages were dropped" << endl;
+		numDropped = 0;
+	}
+	cout.flush();
+	pthread_mutex_unlock(&writeMutex);
+}
+
+void Logger::flush(){
+	if (!running){
+		cout.flush();
+		return;
+	}
+	ulong position = head;
+	while ((long) (position - tail) > 0 && running){
+		usleep(LOG_IDLE_SLEEP_MICROSECONDS);
+	}
+}
+
+void Logger::post(const LogMessage& message){
+	__sync_fetch_and_add(&numPosting, 1);
+	if (!running){
+		__sync_fetch_and_sub(&numPosting, 1);
+		pthread_mutex_lock(&writeMutex);
+		message.write(cout);
+		cout.flush();
+		pthread_mutex_unlock(&writeMutex);
+		return;
+	}
+	//Claim a position, then fill its slot and mark it ready. Any thread may post.
+	ulong position = head;
+	Slot* slot;
+	for (;;){
+		slot = ring + (position & (LOG_RING_LENGTH - 1));
+		long difference = (long) (slot->sequence - position);
+		if (difference == 0){
+			if (__sync_bool_compare_and_swap(&head, position, position + 1)){
+				break;
+			}
+		}
+		else if (difference < 0){
+			//The writer hasn't finished with this slot from the last time around
+			__sync_fetch_and_add(&numDropped, 1);
+			__sync_fetch_and_sub(&numPosting, 1);
+			return;
+		}
+		position = head;
+	}
+	slot->message = message;
+	__sync_synchronize(); //The message is in the slot before the writer can see it
+	slot->sequence = position + 1;
+	__sync_fetch_and_sub(&numPosting, 1);
+}
+
+void* Logger::writerThreadEntry(void* logger){
+	((Logger*) logger)->writerLoop();
+	return NULL;
+}
+
+void Logger::writerLoop(){
+	while (!stopRequested){
+		coarseTime = (uint) time(NULL);
+		if (!drain()){
+			usleep(LOG_IDLE_SLEEP_MICROSECONDS);
+		}
+	}
+}
+
+bool Logger::drain(){
+	bool wroteAnything = false;
+	for (;;){
+		Slot& slot = ring[tail & (LOG_RING_LENGTH - 1)];
+		if (slot.sequence != tail + 1){
+			break;
+		}
+		__sync_synchronize();
+		slot.message.write(cout);
+		__sync_synchronize(); //Finished with the message before the slot can be claimed again
+		slot.sequence = tail + LOG_RING_LENGTH;
+		tail++;
+		wroteAnything = true;
+	}
+	if (wroteAnything){
+		cout.flush();
+	}
+	return wroteAnything;
+}
+
+Logger globalLogger;
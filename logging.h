@@ -0,0 +1,231 @@
+/************************************************************************************
+* 
+* Wavechild670 v0.1 
+* 
+* logging.h
+* 
+* By Peter Raffensperger 11 March 2014
+* 
+* Reference:
+* Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+* Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+* York, UK, September 17-21, 2012.
+* 
+* Note:
+* Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+* affiliated with the author.
+* 
+* License:
+* Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+* software in an academic context, we would appreciate it if you referenced the original
+* paper.
+* 
+************************************************************************************/
+
+
+
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include "Misc.h"
+#include <time.h>
+#include <pthread.h>
+
+#define LOG_RING_LENGTH 256 //Messages, a power of two
+#define LOG_MAX_ARGUMENTS 16
+#define LOG_TEXT_LENGTH 256 //Characters of the strings in a message
+#define LOG_DEFAULT_MESSAGES_PER_SECOND 10 //From each LOG_ statement
+#define LOG_SITE_COUNT_BITS 12 //A LogSite counts up to 4095 messages a second, any higher limit is no limit
+
+/*
+The backend of the LOG_ macros in Misc.h. A message keeps its arguments as they are, strings copied 
+and numbers unformatted, and once the logger is start()ed it is posted into a lock-free ring for a 
+background thread to format and write to cout, so a LOG_ on the audio path costs a copy rather than 
+formatting, a write and a flush. Until then, and after stop(), messages are written as they are 
+posted, one thread at a time.
+
+Each LOG_ statement is its own LogSite, which passes at most getMaxMessagesPerSecond() messages a 
+second and counts the rest, noting the count on its next message that gets through. Messages are also 
+dropped, and counted, if the ring is full.
+*/
+
+class LogSite {
+	/*
+	Shared by every thread that runs the statement, so the second and the count in it are packed 
+	into one word and updated with compare and swap. The second comes from the logger's coarse 
+	clock, so that a statement that's being suppressed doesn't make a system call each time.
+	*/
+public:
+	LogSite() : window(0), numSuppressed(0) { }
+	inline bool admit();
+	ulong takeNumSuppressed() {
+		return __sync_fetch_and_and(&numSuppressed, 0);
+	}
+protected:
+	volatile uint window; //The second in the high bits, the messages admitted in it in the low LOG_SITE_COUNT_BITS
+	volatile ulong numSuppressed;
+};
+
+class LogMessage {
+public:
+	LogMessage(ulong numSuppressed_=0) : numArguments(0), textLength(0), truncated(false), numSuppressed(numSuppressed_) { }
+	
+	LogMessage& operator<<(const char* text) { return addText(text, strlen(text)); }
+	LogMessage& operator<<(const string& text) { return addText(text.data(), text.size()); }
+	LogMessage& operator<<(char c) { return addText(&c, 1); }
+	LogMessage& operator<<(bool x) { return addInteger(x); }
+	LogMessage& operator<<(int x) { return addInteger(x); }
+	LogMessage& operator<<(long x) { return addInteger(x); }
+	LogMessage& operator<<(unsigned int x) { return addUnsigned(x); }
+	LogMessage& operator<<(unsigned long x) { return addUnsigned(x); }
+	LogMessage& operator<<(double x) { return addReal(x); }
+	LogMessage& operator<<(float x) { return addReal(x); }
+	template <class T>
+	LogMessage& operator<<(const T& x) {
+		//Anything else is formatted straight away
+		ostringstream text;
+		text << x;
+		return *this << text.str();
+	}
+	
+	void write(ostream& out) const;
+	
+protected:
+	enum ArgumentType { LOG_ARGUMENT_TEXT, LOG_ARGUMENT_INTEGER, LOG_ARGUMENT_UNSIGNED, LOG_ARGUMENT_REAL };
+	struct Argument {
+		ArgumentType type;
+		union {
+			long integer;
+			unsigned long unsignedInteger;
+			double real;
+			uint textOffset;
+		};
+		uint textLength;
+	};
+	
+	Argument* addArgument(ArgumentType type) {
+		if (numArguments >= LOG_MAX_ARGUMENTS) {
+			truncated = true;
+			return 0;
+		}
+		Argument* argument = arguments + numArguments++;
+		argument->type = type;
+		return argument;
+	}
+	LogMessage& addText(const char* text, size_t length) {
+		if (textLength + length > LOG_TEXT_LENGTH) {
+			length = LOG_TEXT_LENGTH - textLength;
+			truncated = true;
+		}
+		Argument* argument = addArgument(LOG_ARGUMENT_TEXT);
+		if (argument) {
+			argument->textOffset = textLength;
+			argument->textLength = length;
+			memcpy(this->text + textLength, text, length);
+			textLength += length;
+		}
+		return *this;
+	}
+	LogMessage& addInteger(long x) {
+		Argument* argument = addArgument(LOG_ARGUMENT_INTEGER);
+		if (argument) {
+			argument->integer = x;
+		}
+		return *this;
+	}
+	LogMessage& addUnsigned(unsigned long x) {
+		Argument* argument = addArgument(LOG_ARGUMENT_UNSIGNED);
+		if (argument) {
+			argument->unsignedInteger = x;
+		}
+		return *this;
+	}
+	LogMessage& addReal(double x) {
+		Argument* argument = addArgument(LOG_ARGUMENT_REAL);
+		if (argument) {
+			argument->real = x;
+		}
+		return *this;
+	}
+	
+	uint numArguments;
+	Argument arguments[LOG_MAX_ARGUMENTS];
+	uint textLength;
+	char text[LOG_TEXT_LENGTH];
+	bool truncated;
+	ulong numSuppressed; //By the message's site since its last message
+};
+
+class Logger {
+public:
+	Logger();
+	virtual ~Logger();
+	
+	void setLevel(int level_) { level = level_; } //DBG_LOG_ levels, capped by DEBUG_LOG_MESSAGE_LEVEL
+	int getLevel() const { return level; }
+	void setMaxMessagesPerSecond(uint maxMessagesPerSecond_) { maxMessagesPerSecond = maxMessagesPerSecond_; }
+	uint getMaxMessagesPerSecond() const { return maxMessagesPerSecond; }
+	
+	void start(); //Formats and writes messages on a background thread from now on, until stop() or exit
+	void stop(); //Writes out every message posted so far, then writes them as they are posted again
+	void flush(); //Returns once every message posted so far is written
+	
+	void post(const LogMessage& message);
+	
+	bool isRunning() const { return running; }
+	ulong getNumDropped() const { return numDropped; }
+	//In seconds, only as fine as the writer thread's idle sleep while it's running
+	uint getCoarseTime() const { return running ? coarseTime : (uint) time(NULL); }
+	
+protected:
+	struct Slot {
+		volatile ulong sequence; //The slot's position in the ring, plus one once its message is ready
+		LogMessage message;
+	};
+	
+	static void* writerThreadEntry(void* logger);
+	void writerLoop();
+	bool drain(); //Returns true if there was anything to write
+	
+	volatile int level;
+	volatile uint maxMessagesPerSecond;
+	volatile bool running;
+	volatile bool stopRequested;
+	volatile ulong numDropped;
+	volatile uint coarseTime; //Kept by the writer thread
+	volatile uint numPosting; //Threads inside post(), which stop() waits for
+	Slot *ring;
+	volatile ulong head; //Next position to claim, by any thread
+	volatile ulong tail; //Next position to write, by the writer thread only
+	pthread_t writerThread;
+	pthread_mutex_t writeMutex; //Held by synchronous writes, and by stop() until the ring is written out
+	bool stopAtExit;
+};
+
+extern Logger globalLogger;
+
+inline Logger& GLog(){
+	return globalLogger;
+}
+
+bool LogSite::admit(){
+	const uint countMask = (1u << LOG_SITE_COUNT_BITS) - 1;
+	uint maxMessagesPerSecond = GLog().getMaxMessagesPerSecond();
+	if (maxMessagesPerSecond >= countMask) {
+		return true;
+	}
+	uint now = GLog().getCoarseTime() << LOG_SITE_COUNT_BITS;
+	for (;;){
+		uint old = window;
+		uint numThisSecond = (old & ~countMask) == now ? old & countMask : 0;
+		if (numThisSecond >= maxMessagesPerSecond) {
+			__sync_fetch_and_add(&numSuppressed, 1);
+			return false;
+		}
+		if (__sync_bool_compare_and_swap(&window, old, now | (numThisSecond + 1))) {
+			return true;
+		}
+	}
+}
+
+#endif
@@ -59,6 +59,9 @@
 */
 
 #include	<stdio.h>
+#include	<time.h>
+#include	<float.h>
+#include	<string.h>
 
 /* Include this header file to use functions from libsndfile. */
 #include	<sndfile.h>
@@ -73,6 +76,10 @@
 
 #include "Misc.h"
 #include "wavechild670.h"
+#include "wavechild670parallel.h"
+#include "wavechild670batch.h"
+#include "warmstatecache.h"
+#include "pipeline.h"
 #include "getopt_pp.h"
 #include "scope.h"
 
@@ -146,9 +153,1579 @@ void TestVariableMuAmplifier(){
 }
 
 
-void ComputeStaticGainCurve(Wavechild670Parameters& params, Real sampleRate, uint numGainPoints=10, Real minGain=-50, Real maxGain=10, bool quiet=false){
+Real TimeTriodeModel(TriodeModel& model, const Real* Vgk, const Real* Vak, uint numPoints, uint numPasses, Real& checksum){
+	clock_t start = clock();
+	for (uint pass = 0; pass < numPasses; ++pass){
+		for (uint i = 0; i < numPoints; ++i){
+			checksum += model.getIa(Vgk[i], Vak[i]);
+		}
+	}
+	return ((Real) (clock() - start)) / CLOCKS_PER_SEC;
+}
+
+void TestTriodeTableModel(){
+	cout << "Testing the table driven triode model..." << endl;
+	
+	uint numPoints = 100000;
+	uint numPasses = 20;
+	Real *Vgk = new Real[numPoints];
+	Real *Vak = new Real[numPoints];
+	srand(670);
+	for (uint i = 0; i < numPoints; ++i){
+		//Uniform over the operating range of the 670
+		Vgk[i] = TRIODE_TABLE_DEFAULT_VGK_MIN * ((Real) rand()) / RAND_MAX;
+		Vak[i] = 100.0 + 200.0 * ((Real) rand()) / RAND_MAX;
+	}
+	
+	TriodeRemoteCutoff6386 analyticModel;
+	Real checksum = 0.0;
+	Real analyticTime = TimeTriodeModel(analyticModel, Vgk, Vak, numPoints, numPasses, checksum);
+	cout << "Analytic model: " << 1e9*analyticTime/(numPoints*numPasses) << "ns per evaluation" << endl;
+	
+	uint resolutions[] = {32, 64, 128, 256, 512};
+	for (uint r = 0; r < sizeof(resolutions)/sizeof(resolutions[0]); ++r){
+		TriodeTableModel tableModel(analyticModel, resolutions[r], resolutions[r]);
+		Real tableTime = TimeTriodeModel(tableModel, Vgk, Vak, numPoints, numPasses, checksum);
+		cout << "============================" << endl;
+		cout << "Table resolution = " << resolutions[r] << "x" << resolutions[r] << endl;
+		cout << "Max error        = " << tableModel.getMaxError() << "A = " << 100.0*tableModel.getMaxRelativeError() << "% of full scale" << endl;
+		cout << "Speed            = " << 1e9*tableTime/(numPoints*numPasses) << "ns per evaluation (" << analyticTime/tableTime << "x analytic)" << endl;
+	}
+	cout << "Checksum = " << checksum << endl; //Keeps the timed loops from being optimised away
+	
+	delete[] Vgk;
+	delete[] Vak;
+}
+
+Real GetErrorInUlps(Real x, Real reference){
+	if (x == reference) {
+		return 0.0;
+	}
+	return fabs(x - reference)/(fabs(reference)*DBL_EPSILON);
+}
+
+void TestTriodeBatch(){
+	cout << "Testing batched triode model evaluation..." << endl;
+	
+	uint numPoints = 100000;
+	uint numPasses = 20;
+	Real *Vgk = new Real[numPoints];
+	Real *Vak = new Real[numPoints];
+	Real *Ia = new Real[numPoints];
+	Real *dIadVak = new Real[numPoints];
+	Real *IaReference = new Real[numPoints];
+	Real *dIadVakReference = new Real[numPoints];
+	Real *IaScalarKernel = new Real[numPoints];
+	srand(670);
+	for (uint i = 0; i < numPoints; ++i){
+		//Past the edges of the operating range, to cover the clipping
+		Vgk[i] = -100.0 + 110.0 * ((Real) rand()) / RAND_MAX;
+		Vak[i] = -20.0 + 440.0 * ((Real) rand()) / RAND_MAX;
+	}
+	
+	TriodeRemoteCutoff6386 model;
+	Real checksum = 0.0;
+	Real scalarTime = TimeTriodeModel(model, Vgk, Vak, numPoints, numPasses, checksum);
+	for (uint i = 0; i < numPoints; ++i){
+		IaReference[i] = model.getIaAndDerivative(Vgk[i], Vak[i], dIadVakReference[i]);
+	}
+	cout << "Scalar model (libm): " << 1e9*scalarTime/(numPoints*numPasses) << "ns per evaluation" << endl;
+	
+	TriodeKernels::InstructionSet bestInstructionSet = TriodeKernels::getBestInstructionSet();
+	for (int set = 0; set < TriodeKernels::NUM_INSTRUCTION_SETS; ++set){
+		TriodeKernels::InstructionSet instructionSet = (TriodeKernels::InstructionSet) set;
+		cout << "============================" << endl;
+		cout << "Instruction set = " << TriodeKernels::getInstructionSetName(instructionSet) << endl;
+		if (!TriodeKernels::isSupported(instructionSet)) {
+			cout << "Not supported" << endl;
+			continue;
+		}
+		TriodeKernels::setInstructionSet(instructionSet);
+		clock_t start = clock();
+		for (uint pass = 0; pass < numPasses; ++pass){
+			model.getIaBatch(Vgk, Vak, Ia, numPoints);
+			checksum += Ia[pass];
+		}
+		Real batchTime = ((Real) (clock() - start)) / CLOCKS_PER_SEC;
+		model.getIaAndDerivativeBatch(Vgk, Vak, Ia, dIadVak, numPoints);
+		if (instructionSet == TriodeKernels::INSTRUCTION_SET_SCALAR) {
+			memcpy(IaScalarKernel, Ia, numPoints*sizeof(Real));
+		}
+		Real maxIaError = 0.0;
+		Real maxdIadVakError = 0.0;
+		uint numDifferentFromScalarKernel = 0;
+		for (uint i = 0; i < numPoints; ++i){
+			maxIaError = fmax(maxIaError, GetErrorInUlps(Ia[i], IaReference[i]));
+			maxdIadVakError = fmax(maxdIadVakError, GetErrorInUlps(dIadVak[i], dIadVakReference[i]));
+			if (Ia[i] != IaScalarKernel[i]) {
+				++numDifferentFromScalarKernel;
+			}
+		}
+		cout << "Speed                     = " << 1e9*batchTime/(numPoints*numPasses) << "ns per evaluation (" << scalarTime/batchTime << "x scalar model)" << endl;
+		cout << "Max Ia error              = " << maxIaError << " ulp" << endl;
+		cout << "Max dIa/dVak error        = " << maxdIadVakError << " ulp" << endl;
+		cout << "Differences from scalar kernel = " << numDifferentFromScalarKernel << endl;
+	}
+	TriodeKernels::setInstructionSet(bestInstructionSet);
+	cout << "Checksum = " << checksum << endl;
+	
+	delete[] Vgk;
+	delete[] Vak;
+	delete[] Ia;
+	delete[] dIadVak;
+	delete[] IaReference;
+	delete[] dIadVakReference;
+	delete[] IaScalarKernel;
+}
+
+struct TubeSolverTestCase {
+	const char* name;
+	bool useAnalyticDerivative;
+	uint predictorOrder;
+	uint solutionTableResolution;
+	uint maxIterations;
+};
+
+void TestTubeSolver(){
+	cout << "Testing the tube solver..." << endl;
+	
+	Real sampleRate = 44100.0;
+	Real testFrequency = 1000.0;
+	Real testDuration = 1.0;
+	Real warmUpTime = 1.0;
+	uint testNumSamples = (uint) (testDuration * sampleRate);
+	Real *buffer = new Real[testNumSamples];
+	
+	Real inputAmplitude = BasicDSP::ConvertdBmToRMSVoltage(0.0)*sqrt(2.0);
+	BasicDSP::FillWithSineWave(buffer, testNumSamples, 1, inputAmplitude, testFrequency, sampleRate);
+	
+	const TubeSolverTestCase solvers[] = {
+		{"Newton, finite difference derivative", false, 0, 0, TUBE_SOLVER_DEFAULT_MAX_ITERATIONS},
+		{"Newton, analytic derivative", true, 0, 0, TUBE_SOLVER_DEFAULT_MAX_ITERATIONS},
+		{"Newton, analytic derivative, linear predictor", true, 1, 0, TUBE_SOLVER_DEFAULT_MAX_ITERATIONS},
+		{"Newton, analytic derivative, quadratic predictor", true, 2, 0, TUBE_SOLVER_DEFAULT_MAX_ITERATIONS},
+		{"Newton, analytic derivative, quadratic predictor, capped at 2 iterations", true, 2, 0, 2},
+		{"Solution table", true, TUBE_SOLVER_DEFAULT_PREDICTOR_ORDER, TRIODE_TABLE_DEFAULT_RESOLUTION, TUBE_SOLVER_DEFAULT_MAX_ITERATIONS}};
+	const uint numSolvers = sizeof(solvers)/sizeof(solvers[0]);
+	const uint referenceSolver = 1;
+	Real *output[numSolvers];
+	for (uint solver = 0; solver < numSolvers; ++solver){
+		VariableMuAmplifier amp(sampleRate, NULL, solvers[solver].solutionTableResolution);
+		amp.setUseAnalyticDerivative(solvers[solver].useAnalyticDerivative);
+		amp.setTubeSolverPredictorOrder(solvers[solver].predictorOrder);
+		amp.setTubeSolverLimits(TUBE_SOLVER_DEFAULT_TOLERANCE, solvers[solver].maxIterations);
+		for (uint i = 0; i < ((uint) warmUpTime*sampleRate); ++i){
+			amp.advanceAndGetOutputVoltage(0.0, 0.0);
+		}
+		amp.resetTubeSolverStatistics();
+		output[solver] = new Real[testNumSamples];
+		clock_t start = clock();
+		for (uint i = 0; i < testNumSamples; ++i){
+			output[solver][i] = amp.advanceAndGetOutputVoltage(buffer[i], 0.0);
+		}
+		Real timeTaken = ((Real) (clock() - start)) / CLOCKS_PER_SEC;
+		TubeSolverStatistics statistics = amp.getTubeSolverStatistics();
+		cout << "============================" << endl;
+		cout << solvers[solver].name << endl;
+		cout << "Tube solves                 = " << statistics.numSolves << endl;
+		cout << "Table lookups               = " << statistics.numTableLookups << endl;
+		cout << "Iterations per solve        = " << statistics.getIterationsPerSolve() << endl;
+		cout << "Model evaluations per solve = " << statistics.getModelEvaluationsPerSolve() << endl;
+		cout << "Bisection steps             = " << statistics.numBisectionSteps << endl;
+		cout << "Iteration cap hits          = " << statistics.numIterationCapHits << endl;
+		cout << "Iteration histogram         =";
+		for (uint i = 0; i < TUBE_SOLVER_HISTOGRAM_SIZE; ++i){
+			cout << " " << i << (i == TUBE_SOLVER_HISTOGRAM_SIZE - 1 ? "+:" : ":") << statistics.iterationHistogram[i];
+		}
+		cout << endl;
+		cout << "Time taken                  = " << timeTaken << "s" << endl;
+	}
+	cout << "============================" << endl;
+	cout << "Reference: " << solvers[referenceSolver].name << endl;
+	for (uint solver = 0; solver < numSolvers; ++solver){
+		Real maxDifference = 0.0;
+		for (uint i = 0; i < testNumSamples; ++i){
+			maxDifference = fmax(maxDifference, fabs(output[solver][i] - output[referenceSolver][i]));
+		}
+		cout << solvers[solver].name << ": max output difference = " << maxDifference << "V" << endl;
+	}
+	
+	for (uint solver = 0; solver < numSolvers; ++solver){
+		delete[] output[solver];
+	}
+	delete[] buffer;
+}
+
+#define TUBE_LOCKSTEP_TOLERANCE 1e-9 //Volts, the most the lockstep solver's output may differ from the scalar solver's
+
+void TestTubeLockstepSolver(){
+	cout << "Testing the lockstep tube solver..." << endl;
+	
+	Real sampleRate = 44100.0;
+	Real testDuration = 2.0;
+	ulong numFrames = (ulong) (testDuration * sampleRate);
+	Real *input = new Real[2*numFrames];
+	Real *output[2];
+	for (ulong i = 0; i < numFrames; ++i){
+		//Different levels and frequencies per channel so the four tubes don't move together
+		Real envelope = (i/11025) % 2 ? 1.5 : 0.05;
+		input[2*i] = envelope*sin(2.0*M_PI*440.0*i/sampleRate);
+		input[2*i + 1] = 0.7*envelope*sin(2.0*M_PI*1234.0*i/sampleRate);
+	}
+	
+	for (uint lockstep = 0; lockstep < 2; ++lockstep){
+		Wavechild670Parameters params(1.0, 0.5, 2, 0.1, 1.0, 0.5, 2, 0.1, false, false, true, 1.0, false);
+		params.useLockstepTubeSolver = lockstep;
+		Wavechild670 compressor(sampleRate, params);
+		compressor.warmUp();
+		output[lockstep] = new Real[2*numFrames];
+		clock_t start = clock();
+		compressor.process(input, output[lockstep], 2*numFrames);
+		Real timeTaken = ((Real) (clock() - start)) / CLOCKS_PER_SEC;
+		TubeSolverStatistics statistics = compressor.getTubeSolverStatistics();
+		cout << "============================" << endl;
+		if (lockstep) {
+			cout << "Lockstep solver (" << TriodeKernels::getInstructionSetName(TriodeKernels::getInstructionSet()) << " kernels)" << endl;
+		}
+		else {
+			cout << "Scalar solver" << endl;
+		}
+		cout << "Iterations per solve        = " << statistics.getIterationsPerSolve() << endl;
+		cout << "Model evaluations per solve = " << statistics.getModelEvaluationsPerSolve() << endl;
+		cout << "Time taken                  = " << timeTaken << "s (" << 1e9*timeTaken/numFrames << "ns per stereo frame)" << endl;
+	}
+	
+	Real maxDifference = 0.0;
+	for (ulong i = 0; i < 2*numFrames; ++i){
+		maxDifference = fmax(maxDifference, fabs(output[1][i] - output[0][i]));
+	}
+	cout << "============================" << endl;
+	cout << "Max output difference = " << maxDifference << "V, tolerance = " << TUBE_LOCKSTEP_TOLERANCE << "V: " << (maxDifference <= TUBE_LOCKSTEP_TOLERANCE ? "PASS" : "FAIL") << endl;
+	
+	delete[] input;
+	delete[] output[0];
+	delete[] output[1];
+}
+
+struct ApproxExp { Real operator()(Real x) const { return FastMath::approxExp(x); } };
+struct LibmExp { Real operator()(Real x) const { return exp(x); } };
+struct ApproxLog { Real operator()(Real x) const { return FastMath::approxLog(x); } };
+struct LibmLog { Real operator()(Real x) const { return log(x); } };
+struct ApproxLog1p { Real operator()(Real x) const { return FastMath::approxLog1p(x); } };
+struct LibmLog1p { Real operator()(Real x) const { return log1p(x); } };
+
+template <class Function>
+Real TimeFunction(const Function& function, const Real* x, uint numPoints, uint numPasses, uint64_t& checksum){
+	//The checksum only keeps the calls from being optimised away, adding up the bits keeps it finite
+	clock_t start = clock();
+	for (uint pass = 0; pass < numPasses; ++pass){
+		for (uint i = 0; i < numPoints; ++i){
+			checksum += FastMath::toBits(function(x[i]));
+		}
+	}
+	return ((Real) (clock() - start)) / CLOCKS_PER_SEC;
+}
+
+template <class Approximation, class Reference>
+void ReportFastMathFunction(const char* name, const Approximation& approximation, const Reference& reference, const Real* x, uint numPoints, uint64_t& checksum){
+	const uint numPasses = 20;
+	Real maxError = 0.0;
+	Real xAtMaxError = 0.0;
+	for (uint i = 0; i < numPoints; ++i){
+		Real error = GetErrorInUlps(approximation(x[i]), reference(x[i]));
+		if (error > maxError) {
+			maxError = error;
+			xAtMaxError = x[i];
+		}
+	}
+	Real approximationTime = TimeFunction(approximation, x, numPoints, numPasses, checksum);
+	Real referenceTime = TimeFunction(reference, x, numPoints, numPasses, checksum);
+	cout << "============================" << endl;
+	cout << name << endl;
+	cout << "Max error   = " << maxError << " ulp at x = " << xAtMaxError << endl;
+	cout << "libm        = " << 1e9*referenceTime/(numPoints*numPasses) << "ns per call" << endl;
+	cout << "Approximate = " << 1e9*approximationTime/(numPoints*numPasses) << "ns per call (" << referenceTime/approximationTime << "x libm)" << endl;
+}
+
+void FillUniform(Real* x, uint numPoints, Real minimum, Real maximum){
+	for (uint i = 0; i < numPoints; ++i){
+		x[i] = minimum + (maximum - minimum) * ((Real) rand()) / RAND_MAX;
+	}
+}
+
+void FillLogUniform(Real* x, uint numPoints, Real minimum, Real maximum){
+	for (uint i = 0; i < numPoints; ++i){
+		x[i] = exp(log(minimum) + (log(maximum) - log(minimum)) * ((Real) rand()) / RAND_MAX);
+	}
+}
+
+void TestFastMath(){
+	cout << "Testing the approximate math functions..." << endl;
+	
+	uint numPoints = 1000000;
+	Real *x = new Real[numPoints];
+	uint64_t checksum = 0;
+	srand(670);
+	
+	FillUniform(x, numPoints, -700.0, 709.0);
+	ReportFastMathFunction("exp, x in [-700, 709]", ApproxExp(), LibmExp(), x, numPoints, checksum);
+	FillUniform(x, numPoints, -20.0, 20.0);
+	ReportFastMathFunction("exp, x in [-20, 20] (sidechain and tube model)", ApproxExp(), LibmExp(), x, numPoints, checksum);
+	FillLogUniform(x, numPoints, 1e-300, 1e300);
+	ReportFastMathFunction("log, x in [1e-300, 1e300]", ApproxLog(), LibmLog(), x, numPoints, checksum);
+	FillLogUniform(x, numPoints, 1e-300, 1e15);
+	ReportFastMathFunction("log1p, x in [1e-300, 1e15]", ApproxLog1p(), LibmLog1p(), x, numPoints, checksum);
+	FillUniform(x, numPoints, -0.999, 1.0);
+	ReportFastMathFunction("log1p, x in [-0.999, 1]", ApproxLog1p(), LibmLog1p(), x, numPoints, checksum);
+	cout << "Checksum = " << hex << checksum << dec << endl;
+	delete[] x;
+	
+	//Effect on rendered output, for both tube solvers since the lockstep one uses its own vectorised kernels
+	Real sampleRate = 44100.0;
+	Real testDuration = 2.0;
+	ulong numFrames = (ulong) (testDuration * sampleRate);
+	Real *input = new Real[2*numFrames];
+	Real *libmOutput = new Real[2*numFrames];
+	Real *approximateOutput = new Real[2*numFrames];
+	for (ulong i = 0; i < numFrames; ++i){
+		Real envelope = (i/5000) % 2 ? 1.5 : 0.05;
+		input[2*i] = envelope*sin(2.0*M_PI*220.0*i/sampleRate);
+		input[2*i + 1] = envelope*sin(2.0*M_PI*330.0*i/sampleRate);
+	}
+	for (uint useLockstep = 0; useLockstep < 2; ++useLockstep){
+		Real renderTime[2];
+		renderTime[0] = renderTime[1] = 1e9;
+		for (uint repeat = 0; repeat < 6; ++repeat){
+			//Alternates between the two and keeps the fastest of each, the difference is small next to timing noise
+			uint useApproximations = repeat % 2;
+			FastMath::setUseApproximations(useApproximations);
+			Wavechild670Parameters params(1.0, 0.5, 2, 0.1, 1.0, 0.5, 2, 0.1, false, false, true, 1.0, false);
+			params.useLockstepTubeSolver = useLockstep;
+			Wavechild670 compressor(sampleRate, params);
+			compressor.warmUp();
+			clock_t start = clock();
+			compressor.process(input, useApproximations ? approximateOutput : libmOutput, 2*numFrames);
+			renderTime[useApproximations] = fmin(renderTime[useApproximations], ((Real) (clock() - start)) / CLOCKS_PER_SEC);
+		}
+		Real maxDifference = 0.0;
+		Real peak = 0.0;
+		for (ulong i = 0; i < 2*numFrames; ++i){
+			maxDifference = fmax(maxDifference, fabs(approximateOutput[i] - libmOutput[i]));
+			peak = fmax(peak, fabs(libmOutput[i]));
+		}
+		cout << "============================" << endl;
+		cout << "Render, " << (useLockstep ? "lockstep" : "scalar") << " tube solver" << endl;
+		cout << "libm                  = " << 1e6*renderTime[0]/numFrames << "us per stereo frame" << endl;
+		cout << "Approximate           = " << 1e6*renderTime[1]/numFrames << "us per stereo frame (" << renderTime[0]/renderTime[1] << "x libm)" << endl;
+		cout << "Max output difference = " << maxDifference << "V = " << 20.0*log10(maxDifference/peak) << "dB below peak" << endl;
+	}
+	FastMath::setUseApproximations(false);
+	
+	delete[] input;
+	delete[] libmOutput;
+	delete[] approximateOutput;
+}
+
+Real FitSine(const Real* x, ulong numSamples, uint stepSize, Real frequency, Real sampleRate, Real& residualRMS){
+	//Least squares fit of a*sin + b*cos + c, returns the amplitude of the sine and sets the RMS of what's left
+	Real ss = 0.0, sc = 0.0, cc = 0.0, s1 = 0.0, c1 = 0.0;
+	Real xs = 0.0, xc = 0.0, x1 = 0.0;
+	for (ulong i = 0; i < numSamples; ++i){
+		Real s = sin(2.0*M_PI*frequency*i/sampleRate);
+		Real c = cos(2.0*M_PI*frequency*i/sampleRate);
+		Real v = x[i*stepSize];
+		ss += s*s; sc += s*c; cc += c*c; s1 += s; c1 += c;
+		xs += v*s; xc += v*c; x1 += v;
+	}
+	Real n = numSamples;
+	//Cramer's rule on the normal equations
+	Real det = ss*(cc*n - c1*c1) - sc*(sc*n - c1*s1) + s1*(sc*c1 - cc*s1);
+	Real a = (xs*(cc*n - c1*c1) - sc*(xc*n - c1*x1) + s1*(xc*c1 - cc*x1))/det;
+	Real b = (ss*(xc*n - x1*c1) - xs*(sc*n - c1*s1) + s1*(sc*x1 - xc*s1))/det;
+	Real c = (ss*(cc*x1 - c1*xc) - sc*(sc*x1 - s1*xc) + xs*(sc*c1 - cc*s1))/det;
+	Real residualSquared = 0.0;
+	for (ulong i = 0; i < numSamples; ++i){
+		Real fit = a*sin(2.0*M_PI*frequency*i/sampleRate) + b*cos(2.0*M_PI*frequency*i/sampleRate) + c;
+		Real residual = x[i*stepSize] - fit;
+		residualSquared += residual*residual;
+	}
+	residualRMS = sqrt(residualSquared/n);
+	return sqrt(a*a + b*b);
+}
+
+void TestOversampling(){
+	cout << "Testing oversampling..." << endl;
+	
+	Real sampleRate = 44100.0;
+	ulong numFrames = (ulong) sampleRate;
+	ulong analysisStart = numFrames/2;
+	Real *input = new Real[2*numFrames];
+	Real *output = new Real[2*numFrames];
+	const uint factors[] = {1, 2, 4, 8};
+	const uint numFactors = sizeof(factors)/sizeof(factors[0]);
+	const Real maxPassbandDeviation = 0.1; //dB, a tenth of the level just noticeable difference
+	const Real maxRoundTripResidual = -80.0; //dB, the filters' stopband rejection
+	const Real minAliasReduction = 20.0; //dB below the aliasing at 1x, less than that isn't worth the cost
+	bool allPassed = true;
+	
+	//The up and down filters on their own
+	const Real testFrequencies[] = {1000.0, 10000.0, 18000.0, 20000.0};
+	for (uint f = 1; f < numFactors; ++f){
+		Oversampler oversampler(factors[f]);
+		cout << "============================" << endl;
+		cout << factors[f] << "x, round trip latency = " << oversampler.getLatency() << " samples" << endl;
+		for (uint t = 0; t < sizeof(testFrequencies)/sizeof(testFrequencies[0]); ++t){
+			Oversampler roundTrip(factors[f]);
+			Real oversampled[OVERSAMPLING_MAX_FACTOR];
+			for (ulong i = 0; i < numFrames; ++i){
+				roundTrip.upsample(sin(2.0*M_PI*testFrequencies[t]*i/sampleRate), oversampled);
+				output[i] = roundTrip.downsample(oversampled);
+			}
+			Real residualRMS;
+			Real amplitude = FitSine(output + analysisStart, numFrames - analysisStart, 1, testFrequencies[t], sampleRate, residualRMS);
+			Real gain = 20.0*log10(amplitude);
+			Real residual = 20.0*log10(residualRMS*sqrt(2.0)/amplitude);
+			bool passed = fabs(gain) <= maxPassbandDeviation && residual <= maxRoundTripResidual;
+			allPassed = allPassed && passed;
+			cout << "Round trip at " << testFrequencies[t] << "Hz: gain = " << gain << "dB, residual = " << residual << "dB: " << (passed ? "PASS" : "FAIL") << endl;
+		}
+	}
+	
+	//Aliasing from the tubes, a loud high tone has all of its harmonics above Nyquist so anything else left in band is aliasing
+	Real testFrequency = 15000.0;
+	Real inputAmplitude = BasicDSP::ConvertdBmToRMSVoltage(10.0)*sqrt(2.0);
+	for (ulong i = 0; i < numFrames; ++i){
+		input[2*i] = inputAmplitude*sin(2.0*M_PI*testFrequency*i/sampleRate);
+		input[2*i + 1] = input[2*i];
+	}
+	for (uint compressing = 0; compressing < 2; ++compressing){
+		//With an AC threshold of zero the sidechain never acts, which isolates the signal amplifiers
+		Real ACThreshold = compressing ? 0.5 : 0.0;
+		Real baseTime = 0.0;
+		Real baseAliasing = 0.0;
+		Real previousAliasing = 0.0;
+		for (uint f = 0; f < numFactors; ++f){
+			Wavechild670Parameters params(1.0, ACThreshold, 2, 0.1, 1.0, ACThreshold, 2, 0.1, false, false, true, 1.0, false);
+			params.oversamplingFactor = factors[f];
+			Wavechild670 compressor(sampleRate, params);
+			compressor.warmUp();
+			clock_t start = clock();
+			compressor.process(input, output, 2*numFrames);
+			Real time = ((Real) (clock() - start)) / CLOCKS_PER_SEC;
+			Real residualRMS;
+			Real amplitude = FitSine(output + 2*analysisStart, numFrames - analysisStart, 2, testFrequency, sampleRate, residualRMS);
+			Real aliasing = 20.0*log10(residualRMS*sqrt(2.0)/amplitude);
+			if (f == 0) {
+				baseTime = time;
+				baseAliasing = aliasing;
+			}
+			cout << "============================" << endl;
+			cout << "Compressor at " << factors[f] << "x, " << (compressing ? "compressing" : "sidechain off") << endl;
+			cout << "Aliasing and noise = " << aliasing << "dB relative to the " << testFrequency << "Hz tone";
+			if (compressing) {
+				//The gain reduction's own modulation of the tone is in the residual too, and it doesn't go away with oversampling
+				cout << ", not checked" << endl;
+			}
+			else if (f > 0) {
+				bool passed = aliasing <= baseAliasing - minAliasReduction && aliasing <= previousAliasing;
+				allPassed = allPassed && passed;
+				cout << ", " << baseAliasing - aliasing << "dB less than 1x: " << (passed ? "PASS" : "FAIL") << endl;
+			}
+			else {
+				cout << endl;
+			}
+			previousAliasing = aliasing;
+			cout << "Speed              = " << 1e6*time/numFrames << "us per stereo frame (" << time/baseTime << "x the cost of 1x)" << endl;
+		}
+	}
+	cout << (allPassed ? "All passed" : "FAILED") << endl;
+	
+	delete[] input;
+	delete[] output;
+}
+
+void TestStateSpace(){
+	cout << "Testing state space input circuits..." << endl;
+	
+	Real sampleRate = 44100.0;
+	uint numSamples = 1 << 18;
+	Real *input = new Real[numSamples];
+	Real *wdfOutput = new Real[numSamples];
+	Real *stateSpaceOutput = new Real[numSamples];
+	srand(1);
+	for (uint i = 0; i < numSamples; ++i){
+		//Tones and noise with a DC step, to exercise the slow transformer modes too
+		input[i] = sin(2.0*M_PI*60.0*i/sampleRate) + 0.5*sin(2.0*M_PI*7000.0*i/sampleRate) + 0.1*(2.0*rand()/RAND_MAX - 1.0) + (i > numSamples/3 ? 0.3 : 0.0);
+	}
+	
+	//The signal amplifier's input transformer, over blocks of several lengths
+	const uint blockLengths[] = {1, 7, 64, 256, 2048};
+	for (uint b = 0; b < sizeof(blockLengths)/sizeof(blockLengths[0]); ++b){
+		uint blockLength = blockLengths[b];
+		Real time[2];
+		Real maxDifference = 0.0;
+		Real peak = 0.0;
+		for (uint useStateSpace = 0; useStateSpace < 2; ++useStateSpace){
+			VariableMuAmplifier amplifier(sampleRate);
+			amplifier.setUseStateSpaceInputCircuit(useStateSpace);
+			Real *output = useStateSpace ? stateSpaceOutput : wdfOutput;
+			memcpy(output, input, numSamples*sizeof(Real));
+			clock_t start = clock();
+			for (uint i = 0; i < numSamples; i += blockLength){
+				amplifier.advanceInputCircuitBlock(output + i, std::min(blockLength, numSamples - i));
+			}
+			time[useStateSpace] = ((Real) (clock() - start)) / CLOCKS_PER_SEC;
+		}
+		for (uint i = 0; i < numSamples; ++i){
+			maxDifference = fmax(maxDifference, fabs(stateSpaceOutput[i] - wdfOutput[i]));
+			peak = fmax(peak, fabs(wdfOutput[i]));
+		}
+		cout << "============================" << endl;
+		cout << "Blocks of " << blockLength << " samples" << endl;
+		cout << "WDF                   = " << 1e9*time[0]/numSamples << "ns per sample" << endl;
+		cout << "State space           = " << 1e9*time[1]/numSamples << "ns per sample (" << time[0]/time[1] << "x faster)" << endl;
+		cout << "Max output difference = " << maxDifference << "V = " << 20.0*log10(maxDifference/peak) << "dB below peak" << endl;
+	}
+	
+	/*
+	Effect on rendered output. The filter is faster on its own, but a full render comes out the same 
+	speed within the noise (0.99-1.07x, best of 7 with the real-time build). The transformers aren't 
+	on the critical path: each frame waits on the tube solves, and out of order execution overlaps 
+	the transformers with them.
+	*/
+	Real testDuration = 2.0;
+	ulong numFrames = (ulong) (testDuration * sampleRate);
+	Real *renderInput = new Real[2*numFrames];
+	Real *wdfRender = new Real[2*numFrames];
+	Real *stateSpaceRender = new Real[2*numFrames];
+	for (ulong i = 0; i < numFrames; ++i){
+		Real envelope = (i/5000) % 2 ? 1.5 : 0.05;
+		renderInput[2*i] = envelope*sin(2.0*M_PI*220.0*i/sampleRate);
+		renderInput[2*i + 1] = envelope*sin(2.0*M_PI*330.0*i/sampleRate);
+	}
+	for (uint useFeedbackTopology = 0; useFeedbackTopology < 2; ++useFeedbackTopology){
+		Real renderTime[2];
+		renderTime[0] = renderTime[1] = 1e9;
+		for (uint repeat = 0; repeat < 4; ++repeat){
+			uint useStateSpace = repeat % 2;
+			Wavechild670Parameters params(1.0, 0.5, 2, 0.1, 1.0, 0.5, 2, 0.1, false, false, useFeedbackTopology, 1.0, false);
+			params.useStateSpaceInputCircuits = useStateSpace;
+			Wavechild670 compressor(sampleRate, params);
+			compressor.warmUp();
+			clock_t start = clock();
+			compressor.process(renderInput, useStateSpace ? stateSpaceRender : wdfRender, 2*numFrames);
+			renderTime[useStateSpace] = fmin(renderTime[useStateSpace], ((Real) (clock() - start)) / CLOCKS_PER_SEC);
+		}
+		Real maxDifference = 0.0;
+		Real peak = 0.0;
+		for (ulong i = 0; i < 2*numFrames; ++i){
+			maxDifference = fmax(maxDifference, fabs(stateSpaceRender[i] - wdfRender[i]));
+			peak = fmax(peak, fabs(wdfRender[i]));
+		}
+		cout << "============================" << endl;
+		cout << "Render, " << (useFeedbackTopology ? "feedback" : "feedforward") << endl;
+		cout << "WDF                   = " << 1e6*renderTime[0]/numFrames << "us per stereo frame" << endl;
+		cout << "State space           = " << 1e6*renderTime[1]/numFrames << "us per stereo frame (" << renderTime[0]/renderTime[1] << "x faster)" << endl;
+		cout << "Max output difference = " << maxDifference << "V = " << 20.0*log10(maxDifference/peak) << "dB below peak" << endl;
+	}
+	
+	delete[] input;
+	delete[] wdfOutput;
+	delete[] stateSpaceOutput;
+	delete[] renderInput;
+	delete[] wdfRender;
+	delete[] stateSpaceRender;
+}
+
+void Benchmark(const string& saveFilename, const string& compareFilename){
+	/*
+	Per frame cost of rendering with the default settings, for comparing builds. Each case is the 
+	best of 5 runs, since on a shared machine a single run can be 20% or more off. The results can 
+	be saved, and then another build compared against them, the checksums showing that both 
+	rendered the same thing.
+	
+	What the real-time build leaves out is small per sample: asserts are a comparison each, and 
+	scope probes that are switched off at run time only test a flag. With single runs that was 
+	lost in the noise, best of 5 it comes out at 1.1-1.35x faster than the debug build with its 
+	probes off, which is itself 1.05-1.2x faster than with them on.
+	*/
+	cout << "Benchmarking..." << endl;
+	cout << "DEBUG_MODE=" << DEBUG_MODE << endl;
+	cout << "USE_SCOPE=" << USE_SCOPE << endl;
+	
+	map<string, pair<Real, Real> > comparison; //Case to ns per frame and checksum
+	if (compareFilename != "") {
+		ifstream compareFile(compareFilename.c_str());
+		if (!compareFile) {
+			cout << "Couldn't read " << compareFilename << ", not comparing" << endl;
+		}
+		string name;
+		Real nsPerFrame, checksum;
+		while (compareFile >> name >> nsPerFrame >> checksum){
+			comparison[name] = make_pair(nsPerFrame, checksum);
+		}
+	}
+	ofstream saveFile;
+	if (saveFilename != "") {
+		saveFile.open(saveFilename.c_str());
+		saveFile.precision(17);
+	}
+	
+	Real sampleRate = 44100.0;
+	Real testDuration = 5.0;
+	ulong numFrames = (ulong) (testDuration * sampleRate);
+	Real *input = new Real[2*numFrames];
+	Real *output = new Real[2*numFrames];
+	for (ulong i = 0; i < numFrames; ++i){
+		Real envelope = (i/5000) % 2 ? 1.5 : 0.05;
+		input[2*i] = envelope*sin(2.0*M_PI*220.0*i/sampleRate);
+		input[2*i + 1] = envelope*sin(2.0*M_PI*330.0*i/sampleRate);
+	}
+	//With the scope compiled in, both with its probes switched on and switched off at run time
+	for (uint scopeSetting = 0; scopeSetting < (USE_SCOPE ? 2 : 1); ++scopeSetting){
+		bool scopeEnabled = USE_SCOPE && scopeSetting == 0;
+		GScope().setEnabled(scopeEnabled);
+		for (uint useFeedbackTopology = 0; useFeedbackTopology < 2; ++useFeedbackTopology){
+			Real renderTime = 1e9;
+			Real checksum = 0.0;
+			for (uint repeat = 0; repeat < 5; ++repeat){
+				Wavechild670Parameters params(1.0, 0.5, 2, 0.1, 1.0, 0.5, 2, 0.1, false, false, useFeedbackTopology, 1.0, false);
+				Wavechild670 compressor(sampleRate, params);
+				compressor.warmUp();
+				clock_t start = clock();
+				compressor.process(input, output, 2*numFrames);
+				renderTime = fmin(renderTime, ((Real) (clock() - start)) / CLOCKS_PER_SEC);
+			}
+			for (ulong i = 0; i < 2*numFrames; ++i){
+				checksum += output[i];
+			}
+			string name = string(useFeedbackTopology ? "feedback" : "feedforward") + (scopeEnabled ? "_scope_on" : "_scope_off");
+			Real nsPerFrame = 1e9*renderTime/numFrames;
+			cout << "============================" << endl;
+			cout << (useFeedbackTopology ? "Feedback" : "Feedforward") << ", scope probes " << (scopeEnabled ? "on" : "off") << endl;
+			cout << "Render   = " << nsPerFrame << "ns per stereo frame" << endl;
+			cout << "Checksum = " << checksum << endl;
+			if (comparison.count(name)) {
+				const pair<Real, Real>& other = comparison[name];
+				if (fabs(checksum - other.second) > 1e-9*fmax(1.0, fabs(checksum))) {
+					cout << "Checksum differs from " << compareFilename << " (" << other.second << "), not the same render" << endl;
+				}
+				else {
+					cout << "Against " << compareFilename << " = " << other.first << "ns per stereo frame (" << other.first/nsPerFrame << "x faster)" << endl;
+				}
+			}
+			if (saveFile.is_open()) {
+				saveFile << name << " " << nsPerFrame << " " << checksum << endl;
+			}
+		}
+	}
+	GScope().setEnabled(true);
+	
+	delete[] input;
+	delete[] output;
+}
+
+void TestTrace(){
+	//Streams the probes of a render to a trace file, then reads it back and checks it against the scope's copy
+	cout << "Testing trace streaming..." << endl;
+	string filename = "trace_test.wc670trace";
+	Real sampleRate = 44100.0;
+	ulong numFrames = (ulong) (5.0 * sampleRate);
+	Real *input = new Real[2*numFrames];
+	Real *output = new Real[2*numFrames];
+	for (ulong i = 0; i < numFrames; ++i){
+		Real envelope = (i/5000) % 2 ? 1.5 : 0.05;
+		input[2*i] = envelope*sin(2.0*M_PI*220.0*i/sampleRate);
+		input[2*i + 1] = envelope*sin(2.0*M_PI*330.0*i/sampleRate);
+		output[2*i] = output[2*i + 1] = 0.0;
+	}
+	
+	Wavechild670Parameters params(1.0, 0.5, 2, 0.1, 1.0, 0.5, 2, 0.1, false, false, true, 1.0, false);
+	Real renderTime[2];
+	ulong numWritten = 0, numDropped = 0;
+	for (uint pass = 0; pass < 3; ++pass){
+		//An untimed pass first, then without and with the trace
+		uint tracing = pass == 2 ? 1 : 0;
+		GScope().setEnabled(true);
+		GScope().setup(numFrames, sampleRate); //Room for the whole render, to compare with
+		Wavechild670 compressor(sampleRate, params);
+		compressor.warmUp();
+		GScope().reset();
+		if (tracing && !GScope().startTrace(filename, sampleRate)){
+			cout << "Couldn't start the trace" << endl;
+			exit(1);
+		}
+		clock_t start = clock();
+		compressor.process(input, output, 2*numFrames);
+		renderTime[tracing] = ((Real) (clock() - start)) / CLOCKS_PER_SEC;
+		if (tracing){
+			numDropped = GScope().stopTrace();
+		}
+	}
+	
+	//The trace holds every sample since it started, the scope the last numFrames of each probe
+	vector<TraceColumn> columns;
+	Real traceSampleRate;
+	if (!LoadTrace(filename, columns, traceSampleRate)){
+		cout << "Couldn't read the trace back" << endl;
+		exit(1);
+	}
+	numWritten = 0;
+	ulong numGapSamples = 0;
+	bool matches = traceSampleRate == sampleRate;
+	for (uint column = 0; column < columns.size(); ++column){
+		const TraceColumn& traced = columns[column];
+		const Probe* probe = GScope().findProbe(traced.name);
+		if (!probe){
+			cout << "The trace has a column \"" << traced.name << "\" with no probe of that name" << endl;
+			exit(1);
+		}
+		Real* scopeCopy = probe->getBufferAligned();
+		ulong length = numFrames*probe->getNumChannels();
+		ulong numTraced = traced.samples.size();
+		ulong numCompared = min(numTraced, length);
+		for (ulong i = 0; i < numCompared; ++i){
+			Real tracedSample = traced.samples[numTraced - numCompared + i];
+			matches = matches && (isnan(tracedSample) || tracedSample == scopeCopy[length - numCompared + i]);
+		}
+		for (ulong i = 0; i < numTraced; ++i){
+			if (isnan(traced.samples[i])){
+				numGapSamples++;
+			}
+			else {
+				numWritten++;
+			}
+		}
+		cout << traced.name << ": " << numTraced << " samples, " << traced.numChannels << " channels" << endl;
+		delete[] scopeCopy;
+	}
+	ulong numPushed = numWritten + numDropped;
+	
+	cout << "============================" << endl;
+	cout << "Probes traced         = " << columns.size() << endl;
+	cout << "Samples written       = " << numWritten << endl;
+	cout << "Samples dropped       = " << numDropped << " of " << numPushed << ", " << numGapSamples << " marked as gaps" << endl;
+	cout << "Trace matches scope   = " << (matches && numGapSamples == numDropped ? "yes" : "NO") << endl;
+	cout << "Render without trace  = " << 1e9*renderTime[0]/numFrames << "ns per stereo frame" << endl;
+	cout << "Render with trace     = " << 1e9*renderTime[1]/numFrames << "ns per stereo frame" << endl;
+	
+	remove(filename.c_str());
+	GScope().setup(SCOPE_DEFAULT_BUFFER_SIZE, SCOPE_DEFAULT_SAMPLERATE);
+	delete[] input;
+	delete[] output;
+}
+
+ScopeTriggerCondition ParseScopeTriggerCondition(const string& name){
+	const char* names[] = {"none", "rising", "falling", "crossing", "above", "nan", "event"};
+	for (uint i = 0; i < sizeof(names)/sizeof(names[0]); ++i){
+		if (name == names[i]){
+			return (ScopeTriggerCondition) i;
+		}
+	}
+	cout << "Unknown trigger condition " << name << endl;
+	exit(1);
+}
+
+void PrintScopeCaptures(){
+	for (uint i = 0; i < GScope().getNumCaptures(); ++i){
+		const ScopeCapture& capture = GScope().getCapture(i);
+		cout << "capture " << i << ": " << GScope().getProbeName(capture.source) << " = " << capture.sourceValue << " at its frame " << capture.sourceFrame << endl;
+	}
+}
+
+void TestScopeCapture(){
+	cout << "Testing triggered scope capture..." << endl;
+	//Synthetic probes first, where every captured sample is known: a sawtooth triggering on its way up through 0.5, 
+	//and a pair of channels, kept one frame in two, holding the frame index and its negative
+	uint bufferSize = 256;
+	uint postTriggerLength = 64;
+	uint maxCaptures = 3;
+	uint sawtoothPeriod = 1000;
+	GScope().setup(bufferSize, 44100.0);
+	ProbeHandle sawtooth = GScope().addProbe("TestSawtooth", 1);
+	ProbeHandle pair = GScope().addProbe("TestPair", 2);
+	ProbeHandle withNaN = GScope().addProbe("TestNaN", 1);
+	GScope().setDecimation("TestPair", 2);
+	GScope().setTrigger("TestSawtooth", SCOPE_TRIGGER_RISING, 0.5);
+	GScope().arm(postTriggerLength, maxCaptures);
+	for (uint n = 0; n < 10*sawtoothPeriod; ++n){
+		GScope()[sawtooth](((Real) (n % sawtoothPeriod))/sawtoothPeriod);
+		GScope()[pair](n);
+		GScope()[pair](-((Real) n));
+	}
+	GScope().disarm();
+	
+	bool sawtoothMatches = GScope().getNumCaptures() == maxCaptures;
+	bool pairMatches = sawtoothMatches;
+	for (uint c = 0; c < GScope().getNumCaptures(); ++c){
+		ulong triggerFrame = sawtoothPeriod/2 + c*sawtoothPeriod;
+		sawtoothMatches = sawtoothMatches && GScope().getCapture(c).source == sawtooth && GScope().getCapture(c).sourceFrame == triggerFrame + 1;
+		Real* captured = GScope().getCapturedSamples(c, "TestSawtooth");
+		for (uint i = 0; i < bufferSize; ++i){
+			ulong frame = triggerFrame + postTriggerLength + 1 + i - bufferSize;
+			sawtoothMatches = sawtoothMatches && captured[i] == ((Real) (frame % sawtoothPeriod))/sawtoothPeriod;
+		}
+		delete[] captured;
+		//The pair's last frame is its postTriggerLength-th kept frame from the trigger on
+		captured = GScope().getCapturedSamples(c, "TestPair");
+		ulong lastFrame = triggerFrame + triggerFrame % 2 + 2*(postTriggerLength - 1);
+		for (uint i = 0; i < bufferSize; ++i){
+			Real frame = lastFrame - 2*(bufferSize - 1 - i);
+			pairMatches = pairMatches && captured[2*i] == frame && captured[2*i + 1] == -frame;
+		}
+		delete[] captured;
+	}
+	
+	//NaN and magnitude triggers, holding off until each capture is done
+	GScope().setTrigger("TestSawtooth", SCOPE_TRIGGER_NONE);
+	GScope().setTrigger("TestNaN", SCOPE_TRIGGER_NAN);
+	GScope().setTrigger("TestPair", SCOPE_TRIGGER_ABOVE, 2000.0);
+	GScope().arm(postTriggerLength, 2);
+	for (uint n = 0; n < 3000; ++n){
+		GScope()[sawtooth](0.0);
+		GScope()[pair](n);
+		GScope()[pair](-((Real) n));
+		GScope()[withNaN](n == 100 ? NAN : 0.0);
+	}
+	GScope().disarm();
+	bool otherTriggersMatch = GScope().getNumCaptures() == 2 && 
+		GScope().getCapture(0).source == withNaN && GScope().getCapture(0).sourceFrame == 101 &&
+		GScope().getCapture(1).source == pair && GScope().getCapture(1).sourceValue == 2000.0;
+	
+	cout << "============================" << endl;
+	cout << "Sawtooth captures match = " << (sawtoothMatches ? "yes" : "NO") << endl;
+	cout << "Decimated pair matches  = " << (pairMatches ? "yes" : "NO") << endl;
+	cout << "NaN and above triggers  = " << (otherTriggersMatch ? "yes" : "NO") << endl;
+	GScope().setTrigger("TestNaN", SCOPE_TRIGGER_NONE);
+	GScope().setTrigger("TestPair", SCOPE_TRIGGER_NONE);
+	GScope().arm(0, 0); //Discards the captures
+	
+	//A render that drives the sidechain amplifier past its maximum output current
+	GScope().setup(SCOPE_DEFAULT_BUFFER_SIZE, 44100.0);
+	Real sampleRate = 44100.0;
+	ulong numFrames = (ulong) (2.0 * sampleRate);
+	Real *input = new Real[2*numFrames];
+	for (ulong i = 0; i < numFrames; ++i){
+		Real envelope = (i/20000) % 2 ? 10.0 : 0.05;
+		input[2*i] = input[2*i + 1] = envelope*sin(2.0*M_PI*100.0*i/sampleRate);
+	}
+	Wavechild670Parameters params(1.0, 0.5, 2, 0.1, 1.0, 0.5, 2, 0.1, false, false, false, 1.0, false);
+	Wavechild670 compressor(sampleRate, params);
+	compressor.warmUp();
+	GScope().setTrigger("currentOver", SCOPE_TRIGGER_EVENT);
+	GScope().arm(postTriggerLength, 4);
+	compressor.process(input, input, 2*numFrames);
+	GScope().disarm();
+	cout << "Sidechain current overs captured = " << GScope().getNumCaptures() << endl;
+	PrintScopeCaptures();
+	GScope().setTrigger("currentOver", SCOPE_TRIGGER_NONE);
+	GScope().arm(0, 0);
+	delete[] input;
+}
+
+struct LogSiteTestThread {
+	LogSite* site;
+	uint numCalls;
+	uint numAdmitted;
+};
+
+void* LogSiteTestThreadEntry(void* thread_){
+	LogSiteTestThread& thread = *((LogSiteTestThread*) thread_);
+	for (uint i = 0; i < thread.numCalls; ++i){
+		thread.numAdmitted += thread.site->admit();
+	}
+	return NULL;
+}
+
+void TestLogging(){
+	cout << "Testing logging..." << endl;
+	//One site from several threads at once: every call is either admitted or counted as suppressed
+	const uint numSiteThreads = 4;
+	LogSite sharedSite;
+	LogSiteTestThread siteThreads[numSiteThreads];
+	pthread_t siteThreadHandles[numSiteThreads];
+	bool siteThreadStarted[numSiteThreads];
+	Real siteStart = GetWallClockTime();
+	for (uint k = 0; k < numSiteThreads; ++k){
+		siteThreads[k].site = &sharedSite;
+		siteThreads[k].numCalls = 1000000;
+		siteThreads[k].numAdmitted = 0;
+		siteThreadStarted[k] = pthread_create(&siteThreadHandles[k], NULL, LogSiteTestThreadEntry, siteThreads + k) == 0;
+		if (!siteThreadStarted[k]) {
+			LogSiteTestThreadEntry(siteThreads + k);
+		}
+	}
+	ulong numSiteCalls = 0, numSiteAdmitted = 0;
+	for (uint k = 0; k < numSiteThreads; ++k){
+		if (siteThreadStarted[k]) {
+			pthread_join(siteThreadHandles[k], NULL);
+		}
+		numSiteCalls += siteThreads[k].numCalls;
+		numSiteAdmitted += siteThreads[k].numAdmitted;
+	}
+	Real siteTime = GetWallClockTime() - siteStart;
+	ulong numSiteSuppressed = sharedSite.takeNumSuppressed();
+	//Each second the calls spanned, including the partial ones at either end, admits at most its share
+	ulong maxSiteAdmitted = (ulong) (ceil(siteTime) + 1)*GLog().getMaxMessagesPerSecond();
+	bool sitePassed = numSiteAdmitted + numSiteSuppressed == numSiteCalls && numSiteAdmitted <= maxSiteAdmitted;
+	
+	//Rate limiting: one LOG_ statement in a tight loop
+	uint maxMessagesPerSecond = GLog().getMaxMessagesPerSecond();
+	uint numMessages = 100000;
+	clock_t start = clock();
+	for (uint i = 0; i < numMessages; ++i){
+		LOG_WARNING("Rate limited message " << i << " of " << numMessages);
+	}
+	Real suppressedTime = ((Real) (clock() - start)) / CLOCKS_PER_SEC;
+	GLog().flush();
+	
+	//Posting to the writer thread, with the rate limit lifted
+	uint numPosted = 32;
+	GLog().setMaxMessagesPerSecond(numMessages);
+	start = clock();
+	for (uint i = 0; i < numPosted; ++i){
+		LOG_WARNING("Posted message " << i << ", x=" << i*M_PI);
+	}
+	Real postTime = ((Real) (clock() - start)) / CLOCKS_PER_SEC;
+	GLog().flush();
+	GLog().setMaxMessagesPerSecond(maxMessagesPerSecond);
+	
+	//A render that clips most of its output samples
+	Real sampleRate = 44100.0;
+	ulong numFrames = (ulong) (5.0 * sampleRate);
+	Real *input = new Real[2*numFrames];
+	for (ulong i = 0; i < numFrames; ++i){
+		input[2*i] = sin(2.0*M_PI*220.0*i/sampleRate);
+		input[2*i + 1] = sin(2.0*M_PI*330.0*i/sampleRate);
+	}
+	Wavechild670Parameters params(1.0, 0.5, 2, 0.1, 1.0, 0.5, 2, 0.1, false, false, true, 20.0, true);
+	Wavechild670 compressor(sampleRate, params);
+	compressor.warmUp();
+	start = clock();
+	for (ulong i = 0; i < numFrames; i += BUFFER_LEN/2){
+		ulong numBufferFrames = min((ulong) BUFFER_LEN/2, numFrames - i);
+		compressor.process(input + 2*i, input + 2*i, 2*numBufferFrames);
+	}
+	Real renderTime = ((Real) (clock() - start)) / CLOCKS_PER_SEC;
+	GLog().flush();
+	
+	cout << "============================" << endl;
+	cout << "Logger running          = " << (GLog().isRunning() ? "yes, on its own thread" : "no, writing synchronously") << endl;
+	cout << "Rate limited statement  = " << 1e9*suppressedTime/numMessages << "ns per message, at most " << maxMessagesPerSecond << " a second written" << endl;
+	cout << "Posted message          = " << 1e9*postTime/numPosted << "ns per message" << endl;
+	cout << "Clipping render         = " << 1e9*renderTime/numFrames << "ns per stereo frame, " << compressor.getNumClippedSamples() << " samples clipped" << endl;
+	cout << "Messages dropped        = " << GLog().getNumDropped() << endl;
+	cout << "Shared site, " << numSiteThreads << " threads = " << numSiteAdmitted << " admitted (at most " << maxSiteAdmitted << ") + " << 
+		numSiteSuppressed << " suppressed of " << numSiteCalls << " calls: " << (sitePassed ? "PASS" : "FAIL") << endl;
+	delete[] input;
+}
+
+void TestSaveState(){
+	cout << "Testing state save and restore..." << endl;
+	
+	Real sampleRate = 44100.0;
+	ulong numFrames = (ulong) sampleRate;
+	ulong numSavedFrames = 12345; //Not a whole number of blocks or sidechain decimation periods
+	Real *input = new Real[2*numFrames];
+	Real *continuedOutput = new Real[2*numFrames];
+	Real *restoredOutput = new Real[2*numFrames];
+	for (ulong i = 0; i < numFrames; ++i){
+		Real envelope = (i/5000) % 2 ? 1.5 : 0.05;
+		input[2*i] = envelope*sin(2.0*M_PI*220.0*i/sampleRate);
+		input[2*i + 1] = envelope*sin(2.0*M_PI*330.0*i/sampleRate);
+	}
+	ulong numRemaining = 2*(numFrames - numSavedFrames);
+	bool allPassed = true;
+	for (uint useFeedbackTopology = 0; useFeedbackTopology < 2; ++useFeedbackTopology){
+		for (uint useFastPaths = 0; useFastPaths < 2; ++useFastPaths){
+			Wavechild670Parameters params(1.0, 0.5, 2, 0.1, 1.0, 0.5, 2, 0.1, false, false, useFeedbackTopology, 1.0, false);
+			if (useFastPaths) {
+				params.oversamplingFactor = 4;
+				params.sidechainDecimation = 4;
+				params.useLockstepTubeSolver = true;
+				params.useStateSpaceInputCircuits = true;
+			}
+			Wavechild670::State state;
+			Wavechild670 compressor(sampleRate, params);
+			compressor.warmUp();
+			compressor.process(input, continuedOutput, 2*numSavedFrames);
+			compressor.saveState(state);
+			compressor.process(input + 2*numSavedFrames, continuedOutput, numRemaining);
+			
+			//Into a fresh compressor, then back into the one it came from
+			Wavechild670 restoredCompressor(sampleRate, params);
+			restoredCompressor.loadState(state);
+			restoredCompressor.process(input + 2*numSavedFrames, restoredOutput, numRemaining);
+			bool freshMatches = memcmp(continuedOutput, restoredOutput, numRemaining*sizeof(Real)) == 0;
+			compressor.loadState(state);
+			compressor.process(input + 2*numSavedFrames, restoredOutput, numRemaining);
+			bool rewoundMatches = memcmp(continuedOutput, restoredOutput, numRemaining*sizeof(Real)) == 0;
+			allPassed = allPassed && freshMatches && rewoundMatches;
+			
+			uint numRepeats = 100000;
+			clock_t start = clock();
+			for (uint i = 0; i < numRepeats; ++i){
+				compressor.saveState(state);
+			}
+			Real saveTime = ((Real) (clock() - start)) / CLOCKS_PER_SEC;
+			start = clock();
+			for (uint i = 0; i < numRepeats; ++i){
+				compressor.loadState(state);
+			}
+			Real loadTime = ((Real) (clock() - start)) / CLOCKS_PER_SEC;
+			
+			cout << "============================" << endl;
+			cout << (useFeedbackTopology ? "Feedback" : "Feedforward") << ", " << (useFastPaths ? "4x oversampling, decimated sidechain, state space input circuits" : "defaults") << endl;
+			cout << "Restored into a new compressor = " << (freshMatches ? "bit identical" : "FAILED") << endl;
+			cout << "Restored into the same one     = " << (rewoundMatches ? "bit identical" : "FAILED") << endl;
+			cout << "saveState                      = " << 1e9*saveTime/numRepeats << "ns" << endl;
+			cout << "loadState                      = " << 1e9*loadTime/numRepeats << "ns" << endl;
+		}
+	}
+	cout << "============================" << endl;
+	cout << "sizeof(Wavechild670::State) = " << sizeof(Wavechild670::State) << " bytes" << endl;
+	cout << (allPassed ? "All passed" : "FAILED") << endl;
+	delete[] input;
+	delete[] continuedOutput;
+	delete[] restoredOutput;
+}
+
+void PrintRenderStatistics(const TubeSolverStatistics& solverStatistics, ulong numClippedSamples){
+	cout << "clipped samples: " << numClippedSamples << endl;
+	cout << "tube table lookups: " << solverStatistics.numTableLookups << ", tube solves: " << solverStatistics.numSolves << ", iterations per solve: " << solverStatistics.getIterationsPerSolve() << ", model evaluations per solve: " << solverStatistics.getModelEvaluationsPerSolve() << ", iteration cap hits: " << solverStatistics.numIterationCapHits << endl;
+}
+
+void TestParallelRender(){
+	cout << "Testing parallel rendering..." << endl;
+	GScope().setEnabled(false);
+	
+	Real sampleRate = 44100.0;
+	ulong numFrames = (ulong) (20.0 * sampleRate);
+	Real *input = new Real[2*numFrames];
+	Real *serialOutput = new Real[2*numFrames];
+	Real *parallelOutput = new Real[2*numFrames];
+	for (ulong i = 0; i < numFrames; ++i){
+		//Loud and quiet passages, so that the level capacitors are never settled for long
+		Real envelope = (i/30000) % 3 ? 0.1 : 1.5;
+		input[2*i] = envelope*sin(2.0*M_PI*220.0*i/sampleRate);
+		input[2*i + 1] = envelope*sin(2.0*M_PI*330.0*i/sampleRate);
+	}
+	Wavechild670Parameters params(1.0, 0.5, 2, 0.1, 1.0, 0.5, 2, 0.1, false, false, true, 1.0, false);
+	
+	Wavechild670 compressor(sampleRate, params);
+	compressor.warmUp();
+	Real start = GetWallClockTime();
+	for (ulong i = 0; i < numFrames; i += BUFFER_LEN/2){
+		ulong numBufferFrames = min((ulong) BUFFER_LEN/2, numFrames - i);
+		compressor.process(input + 2*i, serialOutput + 2*i, 2*numBufferFrames);
+	}
+	Real serialTime = GetWallClockTime() - start;
+	cout << "============================" << endl;
+	cout << "Serial render = " << serialTime << "s for " << numFrames/sampleRate << "s of audio" << endl;
+	
+	//The short overlap leaves some seams too far off, which have to be caught and rendered again
+	const Real overlapTimes[] = {0.5, WAVECHILD670_PARALLEL_DEFAULT_OVERLAP_TIME};
+	bool allPassed = true;
+	const uint threadCounts[] = {1, 2, 4, 8};
+	for (uint o = 0; o < sizeof(overlapTimes)/sizeof(overlapTimes[0]); ++o){
+		for (uint t = 0; t < sizeof(threadCounts)/sizeof(threadCounts[0]); ++t){
+			Wavechild670ParallelRenderer renderer(sampleRate, params, threadCounts[t], overlapTimes[o]);
+			renderer.warmUp();
+			start = GetWallClockTime();
+			renderer.process(input, parallelOutput, 2*numFrames);
+			Real parallelTime = GetWallClockTime() - start;
+			Real maxDeviation = 0.0;
+			for (ulong i = 0; i < 2*numFrames; ++i){
+				maxDeviation = fmax(maxDeviation, fabs(parallelOutput[i] - serialOutput[i]));
+			}
+			cout << "============================" << endl;
+			cout << threadCounts[t] << " threads, " << overlapTimes[o] << "s overlap" << endl;
+			cout << "Parallel render = " << parallelTime << "s (" << serialTime/parallelTime << "x faster)" << endl;
+			bool passed = maxDeviation <= WAVECHILD670_PARALLEL_DEFAULT_MAX_SEAM_DEVIATION;
+			allPassed = allPassed && passed;
+			cout << "Estimated       = " << renderer.getMaxSeamDeviation() << "V at the worst seam, " << renderer.getNumRerenderedChunks() << " chunks rendered again" << endl;
+			cout << "Max deviation   = " << maxDeviation << "V (" << BasicDSP::ConvertRMSVoltageTodBm(maxDeviation) << "dBm), tolerance = " << 
+				WAVECHILD670_PARALLEL_DEFAULT_MAX_SEAM_DEVIATION << "V: " << (passed ? "PASS" : "FAIL") << endl;
+		}
+	}
+	
+	cout << (allPassed ? "All passed" : "FAILED") << endl;
+	
+	delete[] input;
+	delete[] serialOutput;
+	delete[] parallelOutput;
+}
+
+#define BATCH_TOLERANCE 1e-8 //Volts, the most a batch lane's output may differ from its own Wavechild670 (its circuits run as state space realisations, which round differently)
+
+void TestBatch(){
+	cout << "Testing the batch engine..." << endl;
+	GScope().setEnabled(false);
+	
+	Real sampleRate = 44100.0;
+	ulong numFrames = (ulong) (5.0 * sampleRate);
+	//A spread of settings, so that each group holds lanes with different parameters
+	vector<Wavechild670Parameters> parameters;
+	for (uint lane = 0; lane < 12; ++lane){
+		uint timeConstantSelect = 1 + lane % 6;
+		Real ACThreshold = 0.3 + 0.1*(lane % 4);
+		Real DCThreshold = 0.05*(lane % 3);
+		bool sidechainLink = lane % 2 == 1;
+		bool isMidSide = lane % 5 == 2;
+		bool useFeedbackTopology = lane % 3 != 2;
+		bool hardClipOutput = lane % 4 == 2;
+		parameters.push_back(Wavechild670Parameters(1.0, ACThreshold, timeConstantSelect, DCThreshold, 0.8, ACThreshold, timeConstantSelect, DCThreshold, 
+			sidechainLink, isMidSide, useFeedbackTopology, 0.5 + 0.25*(lane % 2), hardClipOutput));
+	}
+	uint numLanes = parameters.size();
+	Real **input = new Real*[numLanes];
+	Real **scalarOutput = new Real*[numLanes];
+	Real **batchOutput = new Real*[numLanes];
+	Real **laneInput = new Real*[numLanes];
+	Real **laneOutput = new Real*[numLanes];
+	for (uint lane = 0; lane < numLanes; ++lane){
+		input[lane] = new Real[2*numFrames];
+		scalarOutput[lane] = new Real[2*numFrames];
+		batchOutput[lane] = new Real[2*numFrames];
+		for (ulong i = 0; i < numFrames; ++i){
+			//Loud and quiet passages at a different rate in each lane, so the lanes' gains keep moving apart
+			Real envelope = (i/(20000 + 1000*lane)) % 3 ? 0.1 : 1.5;
+			input[lane][2*i] = envelope*sin(2.0*M_PI*(110.0 + 20.0*lane)*i/sampleRate);
+			input[lane][2*i + 1] = envelope*sin(2.0*M_PI*(165.0 + 30.0*lane)*i/sampleRate);
+		}
+	}
+	
+	//The hard clipped lanes clip in the loud passages, which checks the batch counts them the same way
+	vector<ulong> scalarClippedSamples(numLanes);
+	Real start = GetWallClockTime();
+	for (uint lane = 0; lane < numLanes; ++lane){
+		Wavechild670 compressor(sampleRate, parameters[lane]);
+		compressor.warmUp();
+		for (ulong i = 0; i < numFrames; i += BUFFER_LEN/2){
+			ulong numBufferFrames = min((ulong) BUFFER_LEN/2, numFrames - i);
+			compressor.process(input[lane] + 2*i, scalarOutput[lane] + 2*i, 2*numBufferFrames);
+		}
+		scalarClippedSamples[lane] = compressor.getNumClippedSamples();
+	}
+	Real scalarTime = GetWallClockTime() - start;
+	cout << "============================" << endl;
+	cout << "Wavechild670 per lane = " << 1e9*scalarTime/(numLanes*numFrames) << "ns per lane frame" << endl;
+	
+	bool allPassed = true;
+	TriodeKernels::InstructionSet bestInstructionSet = TriodeKernels::getBestInstructionSet();
+	for (int set = 0; set < TriodeKernels::NUM_INSTRUCTION_SETS; ++set){
+		TriodeKernels::InstructionSet instructionSet = (TriodeKernels::InstructionSet) set;
+		cout << "============================" << endl;
+		cout << "Instruction set = " << TriodeKernels::getInstructionSetName(instructionSet) << endl;
+		if (!TriodeKernels::isSupported(instructionSet)) {
+			cout << "Not supported" << endl;
+			continue;
+		}
+		TriodeKernels::setInstructionSet(instructionSet);
+		Wavechild670Batch batch(sampleRate, parameters);
+		batch.warmUp();
+		start = GetWallClockTime();
+		for (ulong i = 0; i < numFrames; i += BUFFER_LEN/2){
+			ulong numBufferFrames = min((ulong) BUFFER_LEN/2, numFrames - i);
+			for (uint lane = 0; lane < numLanes; ++lane){
+				laneInput[lane] = input[lane] + 2*i;
+				laneOutput[lane] = batchOutput[lane] + 2*i;
+			}
+			batch.process(laneInput, laneOutput, 2*numBufferFrames);
+		}
+		Real batchTime = GetWallClockTime() - start;
+		Real maxDeviation = 0.0;
+		uint numClipCountMismatches = 0;
+		for (uint lane = 0; lane < numLanes; ++lane){
+			for (ulong i = 0; i < 2*numFrames; ++i){
+				maxDeviation = fmax(maxDeviation, fabs(batchOutput[lane][i] - scalarOutput[lane][i]));
+			}
+			if (batch.getNumClippedSamples(lane) != scalarClippedSamples[lane]) {
+				++numClipCountMismatches;
+			}
+		}
+		bool passed = maxDeviation <= BATCH_TOLERANCE && numClipCountMismatches == 0;
+		allPassed = allPassed && passed;
+		cout << "Speed         = " << 1e9*batchTime/(numLanes*numFrames) << "ns per lane frame (" << scalarTime/batchTime << "x Wavechild670)" << endl;
+		cout << "Clip counts   = " << numClipCountMismatches << " lanes different" << endl;
+		cout << "Max deviation = " << maxDeviation << "V, tolerance = " << BATCH_TOLERANCE << "V: " << (passed ? "PASS" : "FAIL") << endl;
+	}
+	TriodeKernels::setInstructionSet(bestInstructionSet);
+	
+	cout << (allPassed ? "All passed" : "FAILED") << endl;
+	
+	for (uint lane = 0; lane < numLanes; ++lane){
+		delete[] input[lane];
+		delete[] scalarOutput[lane];
+		delete[] batchOutput[lane];
+	}
+	delete[] input;
+	delete[] scalarOutput;
+	delete[] batchOutput;
+	delete[] laneInput;
+	delete[] laneOutput;
+}
+
+void TestWarmStateCache(const string& directory){
+	cout << "Testing the warm state cache in " << directory << "..." << endl;
+	
+	Real sampleRate = 44100.0;
+	ulong numFrames = (ulong) (0.1 * sampleRate); //A short clip, where warming up is most of the cost
+	Real *input = new Real[2*numFrames];
+	Real *warmedOutput = new Real[2*numFrames];
+	Real *cachedOutput = new Real[2*numFrames];
+	for (ulong i = 0; i < numFrames; ++i){
+		input[2*i] = 1.5*sin(2.0*M_PI*220.0*i/sampleRate);
+		input[2*i + 1] = 1.5*sin(2.0*M_PI*330.0*i/sampleRate);
+	}
+	bool allPassed = true;
+	WarmStateCache cache(directory);
+	for (uint useFeedbackTopology = 0; useFeedbackTopology < 2; ++useFeedbackTopology){
+		Wavechild670Parameters params(1.0, 0.5, 2, 0.1, 1.0, 0.5, 2, 0.1, false, false, useFeedbackTopology, 1.0, false);
+		params.oversamplingFactor = 2;
+		
+		Real start = GetWallClockTime();
+		Wavechild670 warmedCompressor(sampleRate, params);
+		warmedCompressor.warmUp();
+		Real warmUpTime = GetWallClockTime() - start;
+		warmedCompressor.process(input, warmedOutput, 2*numFrames);
+		
+		//The first one fills the cache unless an earlier run already has
+		start = GetWallClockTime();
+		Wavechild670 firstCompressor(sampleRate, params);
+		bool firstWasCached = cache.warmUp(firstCompressor, sampleRate, params);
+		Real firstTime = GetWallClockTime() - start;
+		start = GetWallClockTime();
+		Wavechild670 cachedCompressor(sampleRate, params);
+		bool wasCached = cache.warmUp(cachedCompressor, sampleRate, params);
+		Real cachedTime = GetWallClockTime() - start;
+		cachedCompressor.process(input, cachedOutput, 2*numFrames);
+		bool matches = memcmp(warmedOutput, cachedOutput, 2*numFrames*sizeof(Real)) == 0;
+		allPassed = allPassed && wasCached && matches;
+		
+		cout << "============================" << endl;
+		cout << (useFeedbackTopology ? "Feedback" : "Feedforward") << ", 2x oversampling" << endl;
+		cout << "Construct and warmUp()       = " << 1e3*warmUpTime << "ms" << endl;
+		cout << "First from the cache         = " << 1e3*firstTime << "ms, " << (firstWasCached ? "hit" : "miss") << endl;
+		cout << "Then from the cache          = " << 1e3*cachedTime << "ms, " << (wasCached ? "hit" : "FAILED, miss") << " (" << warmUpTime/cachedTime << "x faster)" << endl;
+		cout << "Output against warmUp()      = " << (matches ? "bit identical" : "FAILED") << endl;
+	}
+	cout << "============================" << endl;
+	cout << "Hits = " << cache.getNumHits() << ", misses = " << cache.getNumMisses() << endl;
+	cout << (allPassed ? "All passed" : "FAILED") << endl;
+	delete[] input;
+	delete[] warmedOutput;
+	delete[] cachedOutput;
+}
+
+Real MaxStateDifference(const TubeStageCircuit::State& x, const TubeStageCircuit::State& y){
+	//Relative to y, or absolute for the elements of y that are below 1. The stage's state is all Reals
+	const Real* xs = (const Real*) &x;
+	const Real* ys = (const Real*) &y;
+	Real maxDifference = 0.0;
+	for (uint i = 0; i < sizeof(TubeStageCircuit::State)/sizeof(Real); ++i){
+		maxDifference = fmax(maxDifference, fabs(xs[i] - ys[i])/fmax(fabs(ys[i]), 1.0));
+	}
+	return maxDifference;
+}
+
+void TestOperatingPoint(){
+	cout << "Testing the DC operating point solver..." << endl;
+	
+	Real sampleRate = 44100.0;
+	ulong numFrames = (ulong) (0.5 * sampleRate);
+	Real *input = new Real[2*numFrames];
+	Real *settledOutput = new Real[2*numFrames];
+	Real *output = new Real[2*numFrames];
+	for (ulong i = 0; i < numFrames; ++i){
+		//Loud renders are very sensitive to their starting state, this one is only lightly compressed
+		input[2*i] = 0.3*sin(2.0*M_PI*220.0*i/sampleRate);
+		input[2*i + 1] = 0.3*sin(2.0*M_PI*330.0*i/sampleRate);
+	}
+	const uint factors[] = {1, 4};
+	for (uint f = 0; f < sizeof(factors)/sizeof(factors[0]); ++f){
+		Wavechild670Parameters params(1.0, 0.5, 2, 0.1, 1.0, 0.5, 2, 0.1, false, false, true, 1.0, false);
+		params.oversamplingFactor = factors[f];
+		Wavechild670::State settledState;
+		Wavechild670::State state;
+		
+		//A long warm up as the reference
+		Wavechild670 settledCompressor(sampleRate, params);
+		Real start = GetWallClockTime();
+		settledCompressor.warmUp(20.0);
+		Real settleTime = GetWallClockTime() - start;
+		settledCompressor.saveState(settledState);
+		settledCompressor.process(input, settledOutput, 2*numFrames);
+		
+		Wavechild670 compressor(sampleRate, params);
+		start = GetWallClockTime();
+		compressor.warmUp();
+		Real warmUpTime = GetWallClockTime() - start;
+		compressor.saveState(state);
+		Real warmUpStateDifference = MaxStateDifference(state.signalAmplifierA.tubeAmpPush, settledState.signalAmplifierA.tubeAmpPush);
+		compressor.process(input, output, 2*numFrames);
+		Real warmUpDeviation = 0.0;
+		for (ulong i = 0; i < 2*numFrames; ++i){
+			warmUpDeviation = fmax(warmUpDeviation, fabs(output[i] - settledOutput[i]));
+		}
+		
+		uint numRepeats = 100;
+		start = GetWallClockTime();
+		for (uint i = 0; i < numRepeats; ++i){
+			compressor.solveOperatingPoint();
+		}
+		Real solveTime = (GetWallClockTime() - start)/numRepeats;
+		compressor.saveState(state);
+		Real solvedStateDifference = MaxStateDifference(state.signalAmplifierA.tubeAmpPush, settledState.signalAmplifierA.tubeAmpPush);
+		compressor.process(input, output, 2*numFrames);
+		Real solvedDeviation = 0.0;
+		for (ulong i = 0; i < 2*numFrames; ++i){
+			solvedDeviation = fmax(solvedDeviation, fabs(output[i] - settledOutput[i]));
+		}
+		
+		//How far the solved state drifts over a second of silence
+		Wavechild670::State driftedState;
+		compressor.solveOperatingPoint();
+		compressor.saveState(state);
+		memset(output, 0, 2*numFrames*sizeof(Real));
+		compressor.process(output, output, 2*numFrames);
+		compressor.process(output, output, 2*numFrames);
+		compressor.saveState(driftedState);
+		Real drift = MaxStateDifference(state.signalAmplifierA.tubeAmpPush, driftedState.signalAmplifierA.tubeAmpPush);
+		
+		cout << "============================" << endl;
+		cout << factors[f] << "x oversampling, tube stage states against a 20s warm up (" << settleTime << "s)" << endl;
+		cout << "0.5s warmUp()         = " << 1e3*warmUpTime << "ms, state difference " << warmUpStateDifference << ", output deviation " << warmUpDeviation << "V" << endl;
+		cout << "solveOperatingPoint() = " << 1e6*solveTime << "us, state difference " << solvedStateDifference << ", output deviation " << solvedDeviation << "V" << endl;
+		cout << "Drift over 1s of silence from the solved state = " << drift << " (relative)" << endl;
+	}
+	delete[] input;
+	delete[] settledOutput;
+	delete[] output;
+}
+
+class MemoryPipelineSource : public PipelineSource {
+public:
+	MemoryPipelineSource(const Real* samples_, ulong numSamples_) : samples(samples_), numSamples(numSamples_), position(0) {}
+	virtual uint read(Real* buffer, uint maxSamples){
+		uint numRead = (uint) min((ulong) maxSamples, numSamples - position);
+		memcpy(buffer, samples + position, numRead*sizeof(Real));
+		position += numRead;
+		return numRead;
+	}
+protected:
+	const Real* samples;
+	ulong numSamples;
+	ulong position;
+};
+
+class MemoryPipelineSink : public PipelineSink {
+	//Sleeps for a while on every block, like a slow encoder or disk, if given a latency
+public:
+	MemoryPipelineSink(Real* samples_, uint latencyMicroseconds_=0) : samples(samples_), position(0), latencyMicroseconds(latencyMicroseconds_) {}
+	virtual void write(const Real* buffer, uint numSamples){
+		memcpy(samples + position, buffer, numSamples*sizeof(Real));
+		position += numSamples;
+		if (latencyMicroseconds > 0) {
+			usleep(latencyMicroseconds);
+		}
+	}
+protected:
+	Real* samples;
+	ulong position;
+	uint latencyMicroseconds;
+};
+
+class SndfilePipelineSource : public PipelineSource {
+public:
+	SndfilePipelineSource(SNDFILE* file_) : file(file_) {}
+	virtual uint read(Real* samples, uint maxSamples){
+		return (uint) sf_read_double(file, samples, maxSamples);
+	}
+protected:
+	SNDFILE* file;
+};
+
+class SndfilePipelineSink : public PipelineSink {
+public:
+	SndfilePipelineSink(SNDFILE* file_) : file(file_) {}
+	virtual void write(const Real* samples, uint numSamples){
+		sf_write_double(file, samples, numSamples);
+	}
+protected:
+	SNDFILE* file;
+};
+
+void PrintPipelineStatistics(const Wavechild670Pipeline& pipeline){
+	for (uint stage = 0; stage < PIPELINE_NUM_STAGES; ++stage){
+		const PipelineStageStatistics& statistics = pipeline.getStatistics((PipelineStage) stage);
+		cout << "pipeline " << Wavechild670Pipeline::getStageName((PipelineStage) stage) << ": utilization " << pipeline.getUtilization((PipelineStage) stage) 
+			<< ", busy " << statistics.busyTime << "s, waiting " << statistics.waitTime << "s, " << statistics.numBlocks << " blocks" << endl;
+	}
+}
+
+void TestPipeline(){
+	cout << "Testing the read/process/write pipeline..." << endl;
+	
+	Real sampleRate = 44100.0;
+	ulong numFrames = (ulong) (5.0 * sampleRate);
+	Real *input = new Real[2*numFrames];
+	Real *serialOutput = new Real[2*numFrames];
+	Real *pipelineOutput = new Real[2*numFrames];
+	for (ulong i = 0; i < numFrames; ++i){
+		Real envelope = (i/5000) % 2 ? 1.5 : 0.05;
+		input[2*i] = envelope*sin(2.0*M_PI*220.0*i/sampleRate);
+		input[2*i + 1] = envelope*sin(2.0*M_PI*330.0*i/sampleRate);
+	}
+	Wavechild670Parameters params(1.0, 0.5, 2, 0.1, 1.0, 0.5, 2, 0.1, false, false, true, 1.0, false);
+	
+	const uint blockSizes[] = {256, PIPELINE_DEFAULT_BLOCK_SIZE, 8192};
+	const uint depths[] = {2, PIPELINE_DEFAULT_DEPTH};
+	const uint sinkLatencies[] = {0, 1000}; //Microseconds per block
+	bool allPassed = true;
+	for (uint l = 0; l < sizeof(sinkLatencies)/sizeof(sinkLatencies[0]); ++l){
+		for (uint b = 0; b < sizeof(blockSizes)/sizeof(blockSizes[0]); ++b){
+			for (uint d = 0; d < sizeof(depths)/sizeof(depths[0]); ++d){
+				//Serially, the way main() renders without the pipeline
+				Wavechild670 serialCompressor(sampleRate, params);
+				serialCompressor.warmUp();
+				MemoryPipelineSink serialSink(serialOutput, sinkLatencies[l]);
+				Real start = GetWallClockTime();
+				for (ulong i = 0; i < 2*numFrames; i += blockSizes[b]){
+					uint numSamples = (uint) min((ulong) blockSizes[b], 2*numFrames - i);
+					serialCompressor.process(input + i, serialOutput + i, numSamples);
+					serialSink.write(serialOutput + i, numSamples);
+				}
+				Real serialTime = GetWallClockTime() - start;
+				
+				Wavechild670 compressor(sampleRate, params);
+				compressor.warmUp();
+				Wavechild670Pipeline pipeline(compressor, blockSizes[b], depths[d]);
+				MemoryPipelineSource source(input, 2*numFrames);
+				MemoryPipelineSink sink(pipelineOutput, sinkLatencies[l]);
+				pipeline.run(source, sink);
+				bool matches = memcmp(serialOutput, pipelineOutput, 2*numFrames*sizeof(Real)) == 0;
+				allPassed = allPassed && matches;
+				
+				cout << "============================" << endl;
+				cout << "Block size " << blockSizes[b] << ", depth " << depths[d] << ", " << sinkLatencies[l] << "us sink latency per block" << endl;
+				cout << "Serial   = " << serialTime << "s" << endl;
+				cout << "Pipeline = " << pipeline.getRunTime() << "s (" << serialTime/pipeline.getRunTime() << "x faster), output " << (matches ? "bit identical" : "FAILED") << endl;
+				PrintPipelineStatistics(pipeline);
+			}
+		}
+	}
+	cout << "============================" << endl;
+	cout << (allPassed ? "All passed" : "FAILED") << endl;
+	delete[] input;
+	delete[] serialOutput;
+	delete[] pipelineOutput;
+}
+
+class SidechainOnlyWavechild670 : public Wavechild670 {
+	//Exposes the sidechain so that its cost can be timed without the signal amplifiers
+public:
+	SidechainOnlyWavechild670(Real sampleRate_, Wavechild670Parameters& parameters) : Wavechild670(sampleRate_, parameters) {}
+	void advanceSidechainOnly(Real VinSidechainA, Real VinSidechainB) {
+		advanceSidechain(VinSidechainA, VinSidechainB);
+	}
+	Real getVlevelCapA() const {
+		return VlevelCapA;
+	}
+};
+
+Real MeasureStaticGain(Wavechild670Parameters& params, Real sampleRate, Real inputGainIndBm, Real* buffer, uint numFrames){
+	//Steady state gain in dB of a 1kHz tone, measured over the second half of the buffer
+	Real inputAmplitude = BasicDSP::ConvertdBmToRMSVoltage(inputGainIndBm)*sqrt(2.0);
+	for (uint channelIndex = 0; channelIndex < 2; ++channelIndex){
+		BasicDSP::FillWithSineWave(buffer+channelIndex, numFrames, 2, inputAmplitude, 1000.0, sampleRate);
+	}
+	Real inputRMS = BasicDSP::CalculateRMS(buffer+numFrames, numFrames/2, 2);
+	Wavechild670 compressor(sampleRate, params);
+	compressor.warmUp(1.0);
+	compressor.process(buffer, buffer, 2*numFrames);
+	Real outputRMS = BasicDSP::CalculateRMS(buffer+numFrames, numFrames/2, 2);
+	return BasicDSP::ConvertRMSVoltageTodBm(outputRMS) - BasicDSP::ConvertRMSVoltageTodBm(inputRMS);
+}
+
+void TestSidechainDecimation(){
+	cout << "Testing sidechain decimation..." << endl;
+	
+	Real sampleRate = 44100.0;
+	uint numFrames = (uint) sampleRate;
+	Real *buffer = new Real[2*numFrames];
+	const uint decimations[] = {1, 2, 4, 8, 16, 32};
+	const uint numDecimations = sizeof(decimations)/sizeof(decimations[0]);
+	const Real testGainsIndBm[] = {-30.0, -20.0, -10.0, -5.0, 0.0, 5.0, 10.0};
+	const uint numTestGains = sizeof(testGainsIndBm)/sizeof(testGainsIndBm[0]);
+	Real referenceGains[2][numTestGains];
+	Real baseSidechainTime = 0.0;
+	Real baseRenderTime = 0.0;
+	bool allPassed = true;
+	
+	for (uint d = 0; d < numDecimations; ++d){
+		cout << "============================" << endl;
+		cout << "Sidechain decimation " << decimations[d] << ", control rate = " << sampleRate/decimations[d] << "Hz" << endl;
+		//Static gain curve against the undecimated sidechain, for both topologies
+		for (uint useFeedbackTopology = 0; useFeedbackTopology < 2; ++useFeedbackTopology){
+			if (useFeedbackTopology && decimations[d] > WAVECHILD670_MAX_FEEDBACK_SIDECHAIN_DECIMATION) {
+				cout << "Static gain curve, feedback: capped at decimation " << WAVECHILD670_MAX_FEEDBACK_SIDECHAIN_DECIMATION << ", not tested again" << endl;
+				continue;
+			}
+			Real maxDeviation = 0.0;
+			for (uint g = 0; g < numTestGains; ++g){
+				Wavechild670Parameters params(1.0, 0.5, 2, 0.1, 1.0, 0.5, 2, 0.1, false, false, useFeedbackTopology, 1.0, false);
+				params.sidechainDecimation = decimations[d];
+				Real gain = MeasureStaticGain(params, sampleRate, testGainsIndBm[g], buffer, numFrames);
+				if (d == 0) {
+					referenceGains[useFeedbackTopology][g] = gain;
+				}
+				maxDeviation = fmax(maxDeviation, fabs(gain - referenceGains[useFeedbackTopology][g]));
+			}
+			bool passed = maxDeviation <= WAVECHILD670_SIDECHAIN_DECIMATION_TOLERANCE;
+			allPassed = allPassed && passed;
+			cout << "Static gain curve, " << (useFeedbackTopology ? "feedback" : "feedforward") << ": max deviation = " << maxDeviation << "dB, tolerance = " << 
+				WAVECHILD670_SIDECHAIN_DECIMATION_TOLERANCE << "dB: " << (passed ? "PASS" : "FAIL") << endl;
+		}
+		
+		//Cost of the sidechain on its own and of a whole render, feedforward so that every decimation applies
+		Wavechild670Parameters params(1.0, 0.5, 2, 0.1, 1.0, 0.5, 2, 0.1, false, false, false, 1.0, false);
+		params.sidechainDecimation = decimations[d];
+		BasicDSP::FillWithSineWave(buffer, numFrames, 2, 1.0, 1000.0, sampleRate);
+		BasicDSP::FillWithSineWave(buffer+1, numFrames, 2, 1.0, 1500.0, sampleRate);
+		SidechainOnlyWavechild670 sidechain(sampleRate, params);
+		Real checksum = 0.0;
+		clock_t start = clock();
+		for (uint i = 0; i < numFrames; ++i){
+			sidechain.advanceSidechainOnly(buffer[2*i], buffer[2*i + 1]);
+			checksum += sidechain.getVlevelCapA();
+		}
+		Real sidechainTime = ((Real) (clock() - start)) / CLOCKS_PER_SEC;
+		Wavechild670 compressor(sampleRate, params);
+		start = clock();
+		compressor.process(buffer, buffer, 2*numFrames);
+		Real renderTime = ((Real) (clock() - start)) / CLOCKS_PER_SEC;
+		if (d == 0) {
+			baseSidechainTime = sidechainTime;
+			baseRenderTime = renderTime;
+		}
+		cout << "Sidechain = " << 1e6*sidechainTime/numFrames << "us per stereo frame (" << baseSidechainTime/sidechainTime << "x faster), checksum = " << checksum << endl;
+		cout << "Render    = " << 1e6*renderTime/numFrames << "us per stereo frame (" << baseRenderTime/renderTime << "x faster)" << endl;
+	}
+	
+	delete[] buffer;
+	cout << "============================" << endl;
+	cout << (allPassed ? "All passed" : "FAILED") << endl;
+	if (!allPassed){
+		exit(1);
+	}
+}
+
+void ComputeStaticGainCurve(Wavechild670Parameters& params, Real sampleRate, uint numGainPoints=10, Real minGain=-50, Real maxGain=10, bool quiet=false, WarmStateCache* warmStateCache=NULL){
 	cout << "Calculating static gain curve..." << endl;
-	LOG_WARNING("No oversampling!");
+	if (params.oversamplingFactor == 1) {
+		LOG_WARNING("No oversampling!");
+	}
 	
 	Real testFrequency = 1000.0;
 	Real testDuration = 1.0;
@@ -180,7 +1757,12 @@ void ComputeStaticGainCurve(Wavechild670Parameters& params, Real sampleRate, uin
 		}
 		Real inputGainLeft = BasicDSP::CalculateRMS(buffer+(testNumSamples*numChannels/2), testNumSamples/2, numChannels);
 		Wavechild670 compressor(sampleRate, params);
-		compressor.warmUp(compressorWarmUpTime);
+		if (warmStateCache){
+			warmStateCache->warmUp(compressor, sampleRate, params, compressorWarmUpTime);
+		}
+		else {
+			compressor.warmUp(compressorWarmUpTime);
+		}
     	compressor.process(buffer, buffer, bufferLength);	
 		Real outputGainLeft = BasicDSP::CalculateRMS(buffer+(testNumSamples*numChannels/2), testNumSamples/2, numChannels);
 		Real inputAmplitudeM = BasicDSP::ConvertRMSVoltageTodBm(inputGainLeft);
@@ -237,6 +1819,57 @@ int main (int argc, char** argv) {
 	
 	Real outputGain = 1.0;
 	bool hardClipOutput = true;
+	
+	uint tubeTableResolution = 0;
+	uint tubeSolutionTableResolution = 0;
+	uint tubeSolverPredictorOrder = TUBE_SOLVER_DEFAULT_PREDICTOR_ORDER;
+	Real tubeSolverTolerance = TUBE_SOLVER_DEFAULT_TOLERANCE;
+	uint tubeSolverMaxIterations = TUBE_SOLVER_DEFAULT_MAX_ITERATIONS;
+	bool lockstepTubeSolver = false;
+	bool testTubeTable = false;
+	bool testTubeBatch = false;
+	bool testTubeLockstep = false;
+	bool testTubeSolver = false;
+	bool useFastMath = false;
+	bool testFastMath = false;
+	uint oversamplingFactor = 1;
+	bool testOversampling = false;
+	uint sidechainDecimation = 1;
+	bool testSidechainDecimation = false;
+	bool stateSpaceInputCircuits = false;
+	bool testStateSpace = false;
+	bool benchmark = false;
+	string benchmarkSaveFilename = "";
+	string benchmarkCompareFilename = "";
+	bool scopeOff = false;
+	string traceFilename = "";
+	bool testTrace = false;
+	string captureTrigger = "";
+	string captureCondition = "rising";
+	Real captureThreshold = 0.0;
+	uint capturePostTrigger = SCOPE_DEFAULT_BUFFER_SIZE/2;
+	uint maxCaptures = 8;
+	uint scopeDecimation = 1;
+	bool testScopeCapture = false;
+	int logLevel = DEBUG_LOG_MESSAGE_LEVEL;
+	uint logMessagesPerSecond = LOG_DEFAULT_MESSAGES_PER_SECOND;
+	bool syncLogging = false;
+	bool testLogging = false;
+	bool testSaveState = false;
+	uint numThreads = 1;
+	Real parallelOverlap = WAVECHILD670_PARALLEL_DEFAULT_OVERLAP_TIME;
+	Real parallelCrossfade = WAVECHILD670_PARALLEL_DEFAULT_CROSSFADE_TIME;
+	Real parallelMaxSeamDeviation = WAVECHILD670_PARALLEL_DEFAULT_MAX_SEAM_DEVIATION;
+	bool testParallelRender = false;
+	bool testBatch = false;
+	string warmStateCacheDirectory = "";
+	bool testWarmStateCache = false;
+	bool dcOperatingPoint = false;
+	bool testOperatingPoint = false;
+	bool usePipeline = false;
+	uint pipelineBlockSize = PIPELINE_DEFAULT_BLOCK_SIZE;
+	uint pipelineDepth = PIPELINE_DEFAULT_DEPTH;
+	bool testPipeline = false;
 
 	Real sampleRateOverride = 44100.0;	
 
@@ -281,6 +1914,170 @@ int main (int argc, char** argv) {
 	ops >> GetOpt::Option('x', "minGain", minGain);
 	ops >> GetOpt::Option('x', "maxGain", maxGain);	
 	
+	ops >> GetOpt::Option('x', "tubeTableResolution", tubeTableResolution);
+	ops >> GetOpt::Option('x', "tubeSolutionTableResolution", tubeSolutionTableResolution);
+	ops >> GetOpt::Option('x', "tubeSolverPredictorOrder", tubeSolverPredictorOrder);
+	ops >> GetOpt::Option('x', "tubeSolverTolerance", tubeSolverTolerance);
+	ops >> GetOpt::Option('x', "tubeSolverMaxIterations", tubeSolverMaxIterations);
+	ops >> GetOpt::OptionPresent('x', "lockstepTubeSolver", lockstepTubeSolver);
+	ops >> GetOpt::OptionPresent('x', "testTubeTable", testTubeTable);
+	ops >> GetOpt::OptionPresent('x', "testTubeBatch", testTubeBatch);
+	ops >> GetOpt::OptionPresent('x', "testTubeLockstep", testTubeLockstep);
+	
+	ops >> GetOpt::OptionPresent('x', "testTubeSolver", testTubeSolver);
+	ops >> GetOpt::OptionPresent('x', "fastMath", useFastMath);
+	ops >> GetOpt::OptionPresent('x', "testFastMath", testFastMath);
+	ops >> GetOpt::Option('x', "oversampling", oversamplingFactor);
+	ops >> GetOpt::OptionPresent('x', "testOversampling", testOversampling);
+	ops >> GetOpt::Option('x', "sidechainDecimation", sidechainDecimation);
+	ops >> GetOpt::OptionPresent('x', "testSidechainDecimation", testSidechainDecimation);
+	ops >> GetOpt::OptionPresent('x', "stateSpaceInputCircuits", stateSpaceInputCircuits);
+	ops >> GetOpt::OptionPresent('x', "testStateSpace", testStateSpace);
+	ops >> GetOpt::OptionPresent('x', "benchmark", benchmark);
+	ops >> GetOpt::Option('x', "benchmarkSave", benchmarkSaveFilename);
+	ops >> GetOpt::Option('x', "benchmarkCompare", benchmarkCompareFilename);
+	ops >> GetOpt::OptionPresent('x', "scopeOff", scopeOff);
+	ops >> GetOpt::Option('x', "trace", traceFilename);
+	ops >> GetOpt::OptionPresent('x', "testTrace", testTrace);
+	ops >> GetOpt::Option('x', "captureTrigger", captureTrigger);
+	ops >> GetOpt::Option('x', "captureCondition", captureCondition);
+	ops >> GetOpt::Option('x', "captureThreshold", captureThreshold);
+	ops >> GetOpt::Option('x', "capturePostTrigger", capturePostTrigger);
+	ops >> GetOpt::Option('x', "maxCaptures", maxCaptures);
+	ops >> GetOpt::Option('x', "scopeDecimation", scopeDecimation);
+	ops >> GetOpt::OptionPresent('x', "testScopeCapture", testScopeCapture);
+	ops >> GetOpt::Option('x', "logLevel", logLevel);
+	ops >> GetOpt::Option('x', "logMessagesPerSecond", logMessagesPerSecond);
+	ops >> GetOpt::OptionPresent('x', "syncLogging", syncLogging);
+	ops >> GetOpt::OptionPresent('x', "testLogging", testLogging);
+	ops >> GetOpt::OptionPresent('x', "testSaveState", testSaveState);
+	ops >> GetOpt::Option('x', "threads", numThreads);
+	ops >> GetOpt::Option('x', "parallelOverlap", parallelOverlap);
+	ops >> GetOpt::Option('x', "parallelCrossfade", parallelCrossfade);
+	ops >> GetOpt::Option('x', "parallelMaxSeamDeviation", parallelMaxSeamDeviation);
+	ops >> GetOpt::OptionPresent('x', "testParallelRender", testParallelRender);
+	ops >> GetOpt::OptionPresent('x', "testBatch", testBatch);
+	ops >> GetOpt::Option('x', "warmStateCache", warmStateCacheDirectory);
+	ops >> GetOpt::OptionPresent('x', "testWarmStateCache", testWarmStateCache);
+	ops >> GetOpt::OptionPresent('x', "dcOperatingPoint", dcOperatingPoint);
+	ops >> GetOpt::OptionPresent('x', "testOperatingPoint", testOperatingPoint);
+	ops >> GetOpt::OptionPresent('x', "pipeline", usePipeline);
+	ops >> GetOpt::Option('x', "pipelineBlockSize", pipelineBlockSize);
+	ops >> GetOpt::Option('x', "pipelineDepth", pipelineDepth);
+	ops >> GetOpt::OptionPresent('x', "testPipeline", testPipeline);
+	
+	GLog().setLevel(logLevel);
+	GLog().setMaxMessagesPerSecond(logMessagesPerSecond);
+	if (!syncLogging){
+		GLog().start();
+	}
+	
+	if (testTubeTable){
+		TestTriodeTableModel();
+		exit(0);
+	}
+	if (testTubeBatch){
+		TestTriodeBatch();
+		exit(0);
+	}
+	if (testTubeLockstep){
+		TestTubeLockstepSolver();
+		exit(0);
+	}
+	if (testTubeSolver){
+		TestTubeSolver();
+		exit(0);
+	}
+	if (testFastMath){
+		TestFastMath();
+		exit(0);
+	}
+	if (testOversampling){
+		TestOversampling();
+		exit(0);
+	}
+	if (testSidechainDecimation){
+		TestSidechainDecimation();
+		exit(0);
+	}
+	if (testStateSpace){
+		TestStateSpace();
+		exit(0);
+	}
+	if (benchmark){
+		Benchmark(benchmarkSaveFilename, benchmarkCompareFilename);
+		exit(0);
+	}
+	if (testTrace){
+		TestTrace();
+		exit(0);
+	}
+	if (testScopeCapture){
+		TestScopeCapture();
+		exit(0);
+	}
+	if (testLogging){
+		TestLogging();
+		exit(0);
+	}
+	if (testSaveState){
+		TestSaveState();
+		exit(0);
+	}
+	if (testParallelRender){
+		TestParallelRender();
+		exit(0);
+	}
+	if (testBatch){
+		TestBatch();
+		exit(0);
+	}
+	if (testPipeline){
+		TestPipeline();
+		exit(0);
+	}
+	if (testOperatingPoint){
+		TestOperatingPoint();
+		exit(0);
+	}
+	if (testWarmStateCache){
+		TestWarmStateCache(warmStateCacheDirectory != "" ? warmStateCacheDirectory : "/tmp/wavechild670-warmstate-test");
+		exit(0);
+	}
+	FastMath::setUseApproximations(useFastMath);
+	GScope().setEnabled(!scopeOff);
+	if (!Oversampler::isValidFactor(oversamplingFactor)) {
+		cout << "Oversampling must be 1, 2, 4 or 8" << endl;
+		return 1;
+	}
+	if (sidechainDecimation < 1) {
+		cout << "Sidechain decimation must be at least 1" << endl;
+		return 1;
+	}
+	if (useFeedbackTopology && sidechainDecimation > WAVECHILD670_MAX_FEEDBACK_SIDECHAIN_DECIMATION) {
+		LOG_WARNING("Sidechain decimation " << sidechainDecimation << " is too coarse for the feedback topology, using " << WAVECHILD670_MAX_FEEDBACK_SIDECHAIN_DECIMATION);
+	}
+	if (scopeDecimation < 1 || capturePostTrigger > SCOPE_DEFAULT_BUFFER_SIZE) {
+		cout << "Scope decimation must be at least 1, and the post trigger length at most " << SCOPE_DEFAULT_BUFFER_SIZE << endl;
+		return 1;
+	}
+	if (numThreads < 1 || parallelCrossfade > parallelOverlap) {
+		cout << "There must be at least 1 thread, and the parallel crossfade can't be longer than the overlap" << endl;
+		return 1;
+	}
+	if (pipelineBlockSize < 2 || pipelineBlockSize % 2 != 0 || pipelineDepth < 2) {
+		cout << "The pipeline block size must be a positive even number of samples, and its depth at least 2" << endl;
+		return 1;
+	}
+	if (numThreads > 1 && (traceFilename != "" || captureTrigger != "")) {
+		cout << "The scope can't trace or capture a render on more than one thread" << endl;
+		return 1;
+	}
+	if (numThreads > 1 && usePipeline) {
+		cout << "The pipeline processes on a single thread, it can't be used with more than one" << endl;
+		return 1;
+	}
+	
 	cout << "Processing audio with Wavechild670!" << endl;	
 	cout << "inputFilename=" << inputFilename << endl; 
 	cout << "outputFilename=" << outputFilename << endl; 
@@ -301,17 +2098,70 @@ int main (int argc, char** argv) {
 	
 	cout << "sampleRateOverride=" << sampleRateOverride << endl; 
 	cout << "outputGain=" << outputGain << endl; 	
+	cout << "tubeTableResolution=" << tubeTableResolution << endl; 	
+	cout << "tubeSolutionTableResolution=" << tubeSolutionTableResolution << endl; 	
+	cout << "tubeSolverPredictorOrder=" << tubeSolverPredictorOrder << endl; 	
+	cout << "tubeSolverTolerance=" << tubeSolverTolerance << endl; 	
+	cout << "tubeSolverMaxIterations=" << tubeSolverMaxIterations << endl; 	
+	cout << "lockstepTubeSolver=" << lockstepTubeSolver << endl; 	
+	cout << "useFastMath=" << useFastMath << endl; 	
+	cout << "oversamplingFactor=" << oversamplingFactor << endl; 	
+	cout << "sidechainDecimation=" << sidechainDecimation << endl; 	
+	cout << "stateSpaceInputCircuits=" << stateSpaceInputCircuits << endl; 	
+	cout << "scopeOff=" << scopeOff << endl; 	
+	cout << "traceFilename=" << traceFilename << endl; 	
+	cout << "captureTrigger=" << captureTrigger << endl; 	
+	cout << "captureCondition=" << captureCondition << endl; 	
+	cout << "captureThreshold=" << captureThreshold << endl; 	
+	cout << "capturePostTrigger=" << capturePostTrigger << endl; 	
+	cout << "maxCaptures=" << maxCaptures << endl; 	
+	cout << "scopeDecimation=" << scopeDecimation << endl; 	
+	cout << "logLevel=" << logLevel << endl; 	
+	cout << "logMessagesPerSecond=" << logMessagesPerSecond << endl; 	
+	cout << "syncLogging=" << syncLogging << endl; 	
+	cout << "numThreads=" << numThreads << endl; 	
+	cout << "parallelOverlap=" << parallelOverlap << endl; 	
+	cout << "parallelCrossfade=" << parallelCrossfade << endl; 	
+	cout << "parallelMaxSeamDeviation=" << parallelMaxSeamDeviation << endl; 	
+	cout << "warmStateCacheDirectory=" << warmStateCacheDirectory << endl; 	
+	cout << "dcOperatingPoint=" << dcOperatingPoint << endl; 	
+	cout << "usePipeline=" << usePipeline << endl; 	
+	cout << "pipelineBlockSize=" << pipelineBlockSize << endl; 	
+	cout << "pipelineDepth=" << pipelineDepth << endl; 	
 
 	Wavechild670Parameters params(inputLevelA, ACThresholdA, timeConstantSelectA, DCThresholdA, 
 									inputLevelB, ACThresholdB, timeConstantSelectB, DCThresholdB, 
 									sidechainLink, isMidSide, useFeedbackTopology, outputGain,
 									hardClipOutput);
+	params.tubeTableResolution = tubeTableResolution;
+	params.tubeSolutionTableResolution = tubeSolutionTableResolution;
+	params.tubeSolverPredictorOrder = tubeSolverPredictorOrder;
+	params.tubeSolverTolerance = tubeSolverTolerance;
+	params.tubeSolverMaxIterations = tubeSolverMaxIterations;
+	params.useLockstepTubeSolver = lockstepTubeSolver;
+	params.oversamplingFactor = oversamplingFactor;
+	params.sidechainDecimation = sidechainDecimation;
+	params.useStateSpaceInputCircuits = stateSpaceInputCircuits;
+	WarmStateCache* warmStateCache = warmStateCacheDirectory != "" ? new WarmStateCache(warmStateCacheDirectory) : NULL;
 	
 	if (computeStaticGainCurve){
-		ComputeStaticGainCurve(params, sampleRateOverride, numGainPoints, minGain, maxGain, computeStaticGainCurveQuiet);
+		ComputeStaticGainCurve(params, sampleRateOverride, numGainPoints, minGain, maxGain, computeStaticGainCurveQuiet, warmStateCache);
 		exit(0);
 	}
 	
+	Wavechild670 compressor(sampleRateOverride, params);
+	if (dcOperatingPoint){
+		compressor.solveOperatingPoint();
+	}
+	else if (warmStateCache){
+		warmStateCache->warmUp(compressor, sampleRateOverride, params);
+	}
+	else {
+		compressor.warmUp();
+	}
+	delete warmStateCache; //Only needed to warm up
+	cout << "latency=" << compressor.getLatency() << " samples, not compensated" << endl;
+	
 	/* This is a buffer of double precision floating point values
     ** which will hold our data while we process it.
     */
@@ -351,6 +2201,7 @@ int main (int argc, char** argv) {
         puts (sf_strerror (NULL)) ;
         return  1 ;
         } ;
+    ulong numInputFrames = sfinfo.frames;
 
     if (sfinfo.channels > MAX_CHANNELS)
     {   printf ("Not able to process more than %d channels\n", MAX_CHANNELS) ;
@@ -363,25 +2214,78 @@ int main (int argc, char** argv) {
         return  1 ;
         } ;
 
-	Wavechild670 compressor(sampleRateOverride, params);
-	compressor.warmUp();
+	if (numThreads > 1){
+		//The whole file at once, so that it can be cut into a chunk per thread
+		Assert(sfinfo.channels == 2);
+		GScope().setEnabled(false);
+		ulong numSamples = 2*numInputFrames;
+		Real *input = new Real[numSamples];
+		Real *output = new Real[numSamples];
+		numSamples = sf_read_double(infile, input, numSamples);
+		Wavechild670ParallelRenderer renderer(sampleRateOverride, params, numThreads, parallelOverlap, parallelCrossfade, parallelMaxSeamDeviation);
+		Wavechild670::State warmState;
+		compressor.saveState(warmState);
+		renderer.setWarmState(warmState);
+		Real startTime = GetWallClockTime();
+		renderer.process(input, output, numSamples);
+		cout << "time taken: " << GetWallClockTime() - startTime << endl;
+		sf_write_double(outfile, output, numSamples);
+		for (uint k = 0; k < renderer.getNumSeams(); ++k){
+			Real deviation = renderer.getSeamDeviation(k);
+			cout << "seam at " << renderer.getSeamTime(k) << "s: estimated deviation " << deviation << "V (" << 
+				BasicDSP::ConvertRMSVoltageTodBm(deviation) << "dBm)" << (renderer.wasSeamRerendered(k) ? ", rendered again" : "") << endl;
+		}
+		PrintRenderStatistics(renderer.getTubeSolverStatistics(), renderer.getNumClippedSamples());
+		delete[] input;
+		delete[] output;
+		sf_close(infile);
+		sf_close(outfile);
+		return 0;
+	}
+
+	GScope().setDecimation(scopeDecimation);
+	if (captureTrigger != ""){
+		GScope().setTrigger(captureTrigger, ParseScopeTriggerCondition(captureCondition), captureThreshold);
+		GScope().arm(capturePostTrigger, maxCaptures);
+	}
 
     /* While there are.frames in the input file, read them, process
     ** them and write them to the output file.
     */
     
+	if (traceFilename != "" && !GScope().startTrace(traceFilename, sampleRateOverride)){
+		return 1;
+	}
 	time_t starttime1 = time (NULL);
     
     Assert(sfinfo.channels == 2);
+	if (usePipeline){
+		SndfilePipelineSource source(infile);
+		SndfilePipelineSink sink(outfile);
+		Wavechild670Pipeline pipeline(compressor, pipelineBlockSize, pipelineDepth);
+		pipeline.run(source, sink);
+		PrintPipelineStatistics(pipeline);
+	}
+	else {
     while ((readcount = sf_read_double (infile, data, BUFFER_LEN)))
     {   
         //cout << "Processing " << readcount << " frames." << endl;
     	compressor.process (data, data, readcount) ;
         sf_write_double (outfile, data, readcount) ;
         } ;
+	}
 
 	time_t stoptime1 = time (NULL);
 	cout << "time taken: " << stoptime1 - starttime1 << endl;
+	if (traceFilename != ""){
+		cout << "trace samples dropped: " << GScope().stopTrace() << endl;
+	}
+	if (captureTrigger != ""){
+		GScope().disarm();
+		cout << "scope captures: " << GScope().getNumCaptures() << endl;
+		PrintScopeCaptures();
+	}
+	PrintRenderStatistics(compressor.getTubeSolverStatistics(), compressor.getNumClippedSamples());
 
 
     /* Close input and output files. */
@@ -0,0 +1,70 @@
+/************************************************************************************
+* 
+* Wavechild670 v0.1 
+* 
+* operatingpoint.cpp
+* 
+* By Peter Raffensperger 11 March 2014
+* 
+* Reference:
+* Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+* Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+* York, UK, September 17-21, 2012.
+* 
+* Note:
+* Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+* affiliated with the author.
+* 
+* License:
+* Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+* software in an academic context, we would appreciate it if you referenced the original
+* paper.
+* 
+************************************************************************************/
+
+
+
+
+#include "operatingpoint.h"
+
+bool SolveLinearSystem(Real M[OPERATING_POINT_MAX_STATES][OPERATING_POINT_MAX_STATES], Real* y[], uint numRhs, uint n){
+	//Gaussian elimination with partial pivoting
+	for (uint k = 0; k < n; ++k){
+		uint pivot = k;
+		for (uint i = k + 1; i < n; ++i){
+			if (fabs(M[i][k]) > fabs(M[pivot][k])) {
+				pivot = i;
+			}
+		}
+		if (M[pivot][k] == 0.0) {
+			return false;
+		}
+		if (pivot != k) {
+			for (uint j = 0; j < n; ++j){
+				swap(M[k][j], M[pivot][j]);
+			}
+			for (uint r = 0; r < numRhs; ++r){
+				swap(y[r][k], y[r][pivot]);
+			}
+		}
+		for (uint i = k + 1; i < n; ++i){
+			Real factor = M[i][k]/M[k][k];
+			for (uint j = k; j < n; ++j){
+				M[i][j] -= factor*M[k][j];
+			}
+			for (uint r = 0; r < numRhs; ++r){
+				y[r][i] -= factor*y[r][k];
+			}
+		}
+	}
+	for (int i = ((int) n) - 1; i >= 0; --i){
+		for (uint r = 0; r < numRhs; ++r){
+			Real sum = y[r][i];
+			for (uint j = i + 1; j < n; ++j){
+				sum -= M[i][j]*y[r][j];
+			}
+			y[r][i] = sum/M[i][i];
+		}
+	}
+	return true;
+}
@@ -0,0 +1,163 @@
+/************************************************************************************
+* 
+* Wavechild670 v0.1 
+* 
+* operatingpoint.h
+* 
+* By Peter Raffensperger 11 March 2014
+* 
+* Reference:
+* Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+* Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+* York, UK, September 17-21, 2012.
+* 
+* Note:
+* Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+* affiliated with the author.
+* 
+* License:
+* Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+* software in an academic context, we would appreciate it if you referenced the original
+* paper.
+* 
+************************************************************************************/
+
+
+
+
+#ifndef OPERATINGPOINT_H
+#define OPERATINGPOINT_H
+
+#include "Misc.h"
+#include "tubemodel.h"
+
+#define OPERATING_POINT_MAX_STATES 8
+#define OPERATING_POINT_TOLERANCE 1e-10 //Relative change in the tube's reflected wave at which the solve stops
+#define OPERATING_POINT_MAX_ITERATIONS 50
+
+//Solves M x = y in place for each of numRhs right hand sides, M is n by n and is overwritten
+bool SolveLinearSystem(Real M[OPERATING_POINT_MAX_STATES][OPERATING_POINT_MAX_STATES], Real* y[], uint numRhs, uint n);
+
+/*
+The quiescent state of a tube stage with a steady gate voltage, which running the circuit from rest 
+only approaches, solved for directly and installed in the circuit and its tube.
+
+Apart from the tube, the circuit is affine in its state x and the tube's reflected wave b:
+	x[n+1] = A x[n] + B b + c
+	a      = C x[n] + d
+where a is the wave incident on the tube. A, B, C, c and d come from running the circuit one sample 
+from unit states, like StateSpaceFilter::fromCircuit(). At rest x = A x + B b + c, so 
+x(b) = (I - A)^-1 (B b + c), which leaves one scalar equation, b = tube.getB(a(b), Vk(b)), solved 
+by the secant method with the tube's own solver so that the operating point is the one the time 
+domain simulation settles to. The tube's predictor history is set to the solution too.
+
+The circuit needs getState()/setState(), the getTubeIncidentWave()/setTubeReflectedWave() split 
+of advance(), getTubePortResistance(), getVcathode() and getTube(). Gives Vak, or returns false and 
+leaves the circuit and its tube as they were if the solve fails.
+*/
+
+template <class TubeCircuit>
+bool SolveOperatingPoint(TubeCircuit& circuit, Real Vgate, Real& Vak){
+	WDFTubeInterface& tube = circuit.getTube();
+	vector<Real> initialState = circuit.getState();
+	WDFTubeInterface::State initialTubeState;
+	tube.saveState(initialTubeState);
+	uint numStates = initialState.size();
+	Assert(numStates <= OPERATING_POINT_MAX_STATES);
+	Real M[OPERATING_POINT_MAX_STATES][OPERATING_POINT_MAX_STATES]; //I - A
+	Real x0[OPERATING_POINT_MAX_STATES]; //c, then (I - A)^-1 c
+	Real x1[OPERATING_POINT_MAX_STATES]; //B, then (I - A)^-1 B
+	Real C[OPERATING_POINT_MAX_STATES];
+	
+	vector<Real> state(numStates, 0.0);
+	circuit.setState(state);
+	Real d = circuit.getTubeIncidentWave();
+	circuit.setTubeReflectedWave(0.0);
+	vector<Real> c = circuit.getState();
+	for (uint j = 0; j < numStates; ++j){
+		state.assign(numStates, 0.0);
+		state[j] = 1.0;
+		circuit.setState(state);
+		C[j] = circuit.getTubeIncidentWave() - d;
+		circuit.setTubeReflectedWave(0.0);
+		vector<Real> column = circuit.getState();
+		for (uint i = 0; i < numStates; ++i){
+			M[i][j] = (i == j ? 1.0 : 0.0) - (column[i] - c[i]);
+		}
+	}
+	state.assign(numStates, 0.0);
+	circuit.setState(state);
+	circuit.getTubeIncidentWave();
+	circuit.setTubeReflectedWave(1.0);
+	vector<Real> B = circuit.getState();
+	for (uint i = 0; i < numStates; ++i){
+		x0[i] = c[i];
+		x1[i] = B[i] - c[i];
+	}
+	Real* rhs[2] = {x0, x1};
+	if (!SolveLinearSystem(M, rhs, 2, numStates)) {
+		LOG_WARNING("The operating point's linear system is singular");
+		circuit.setState(initialState);
+		return false;
+	}
+	
+	//a and Vk are affine in b as well, Vk is one of the states so it has no constant part of its own
+	Real a0 = d;
+	Real a1 = 0.0;
+	for (uint j = 0; j < numStates; ++j){
+		a0 += C[j]*x0[j];
+		a1 += C[j]*x1[j];
+	}
+	for (uint i = 0; i < numStates; ++i){
+		state[i] = x0[i];
+	}
+	circuit.setState(state);
+	Real Vk0 = circuit.getVcathode();
+	for (uint i = 0; i < numStates; ++i){
+		state[i] = x1[i];
+	}
+	circuit.setState(state);
+	Real Vk1 = circuit.getVcathode();
+	
+	Real r0 = circuit.getTubePortResistance();
+	Real bPrevious = 0.0;
+	Real GPrevious = tube.getB(a0, r0, Vgate, Vk0) - bPrevious;
+	Real b = bPrevious + GPrevious;
+	uint iteration = 0;
+	for (; iteration < OPERATING_POINT_MAX_ITERATIONS; ++iteration){
+		Real G = tube.getB(a0 + a1*b, r0, Vgate, Vk0 + Vk1*b) - b;
+		if (G == GPrevious) {
+			break;
+		}
+		Real bNext = b - G*(b - bPrevious)/(G - GPrevious);
+		bPrevious = b;
+		GPrevious = G;
+		b = bNext;
+		if (fabs(b - bPrevious) <= OPERATING_POINT_TOLERANCE*(1.0 + fabs(b))) {
+			break;
+		}
+	}
+	if (iteration == OPERATING_POINT_MAX_ITERATIONS || !isfinite(b)) {
+		LOG_WARNING("The operating point solve didn't converge, b=" << b);
+		circuit.setState(initialState);
+		tube.loadState(initialTubeState);
+		tube.resetStatistics();
+		return false;
+	}
+	
+	for (uint i = 0; i < numStates; ++i){
+		state[i] = x0[i] + x1[i]*b;
+	}
+	circuit.setState(state);
+	Vak = 0.5*(a0 + a1*b + b);
+	WDFTubeInterface::State tubeState;
+	tubeState.VakGuess = Vak;
+	for (uint i = 0; i < TUBE_SOLVER_PREDICTOR_HISTORY; ++i){
+		tubeState.VakHistory[i] = Vak;
+	}
+	tube.loadState(tubeState);
+	tube.resetStatistics();
+	return true;
+}
+
+#endif
@@ -0,0 +1,196 @@
+/************************************************************************************
+* 
+* Wavechild670 v0.1 
+* 
+* oversampling.cpp
+* 
+* By Peter Raffensperger 11 March 2014
+* 
+* Reference:
+* Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+* Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+* York, UK, September 17-21, 2012.
+* 
+* Note:
+* Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+* affiliated with the author.
+* 
+* License:
+* Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+* software in an academic context, we would appreciate it if you referenced the original
+* paper.
+* 
+************************************************************************************/
+
+
+
+#include "oversampling.h"
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static inline Real dotProduct(const Real* a, const Real* b, uint n){
+#ifdef __SSE2__
+	//n is always even here
+	__m128d sum0 = _mm_setzero_pd();
+	__m128d sum1 = _mm_setzero_pd();
+	uint i = 0;
+	for (; i + 4 <= n; i += 4){
+		sum0 = _mm_add_pd(sum0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+		sum1 = _mm_add_pd(sum1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+	}
+	for (; i < n; i += 2){
+		sum0 = _mm_add_pd(sum0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+	}
+	sum0 = _mm_add_pd(sum0, sum1);
+	Real sums[2];
+	_mm_storeu_pd(sums, sum0);
+	return sums[0] + sums[1];
+#else
+	Real sum = 0.0;
+	for (uint i = 0; i < n; ++i){
+		sum += a[i]*b[i];
+	}
+	return sum;
+#endif
+}
+
+HalfbandUpsampler::HalfbandUpsampler(uint halfLength_) : halfLength(halfLength_), 
+	coefficients(Oversampler::designHalfbandFilter(halfLength_)), history(4*halfLength_, 0.0), position(0) {
+	for (uint i = 0; i < coefficients.size(); ++i){
+		coefficients[i] *= 2.0; //Makes up for the zeros stuffed between the input samples
+	}
+}
+
+void HalfbandUpsampler::process(Real x, Real& y0, Real& y1){
+	uint length = 2*halfLength;
+	position = position + 1 < length ? position + 1 : 0;
+	history[position] = x;
+	history[position + length] = x;
+	const Real* window = &history[position + 1]; //Oldest first, the newest sample is window[length - 1]
+	y0 = dotProduct(&coefficients[0], window, length); //The filter is symmetric, so it doesn't matter which way round it's applied
+	y1 = window[halfLength]; //Centre tap, x delayed by K - 1
+}
+
+void HalfbandUpsampler::saveState(State& state) const {
+	memcpy(state.history, &history[0], history.size()*sizeof(Real));
+	state.position = position;
+}
+
+void HalfbandUpsampler::loadState(const State& state){
+	memcpy(&history[0], state.history, history.size()*sizeof(Real));
+	position = state.position;
+}
+
+HalfbandDownsampler::HalfbandDownsampler(uint halfLength_) : halfLength(halfLength_), 
+	coefficients(Oversampler::designHalfbandFilter(halfLength_)), history(4*halfLength_, 0.0), 
+	oddDelay(halfLength_, 0.0), position(0), oddPosition(0) {
+}
+
+Real HalfbandDownsampler::process(Real x0, Real x1){
+	uint length = 2*halfLength;
+	position = position + 1 < length ? position + 1 : 0;
+	history[position] = x0;
+	history[position + length] = x0;
+	Real y = dotProduct(&coefficients[0], &history[position + 1], length);
+	y += 0.5*oddDelay[oddPosition];
+	oddDelay[oddPosition] = x1;
+	oddPosition = oddPosition + 1 < halfLength ? oddPosition + 1 : 0;
+	return y;
+}
+
+void HalfbandDownsampler::saveState(State& state) const {
+	memcpy(state.history, &history[0], history.size()*sizeof(Real));
+	memcpy(state.oddDelay, &oddDelay[0], oddDelay.size()*sizeof(Real));
+	state.position = position;
+	state.oddPosition = oddPosition;
+}
+
+void HalfbandDownsampler::loadState(const State& state){
+	memcpy(&history[0], state.history, history.size()*sizeof(Real));
+	memcpy(&oddDelay[0], state.oddDelay, oddDelay.size()*sizeof(Real));
+	position = state.position;
+	oddPosition = state.oddPosition;
+}
+
+Oversampler::Oversampler(uint factor_) : factor(factor_) {
+	Assert(isValidFactor(factor));
+	for (uint stageFactor = 2; stageFactor <= factor; stageFactor *= 2){
+		uint halfLength = stageFactor == 2 ? OVERSAMPLING_FIRST_STAGE_HALF_LENGTH : OVERSAMPLING_LATER_STAGE_HALF_LENGTH;
+		upsamplers.push_back(HalfbandUpsampler(halfLength));
+		downsamplers.push_back(HalfbandDownsampler(halfLength));
+	}
+}
+
+void Oversampler::upsample(Real x, Real* y){
+	Assert(y);
+	Real input[OVERSAMPLING_MAX_FACTOR];
+	y[0] = x;
+	uint numSamples = 1;
+	for (uint stage = 0; stage < upsamplers.size(); ++stage){
+		memcpy(input, y, numSamples*sizeof(Real));
+		for (uint i = 0; i < numSamples; ++i){
+			upsamplers[stage].process(input[i], y[2*i], y[2*i + 1]);
+		}
+		numSamples *= 2;
+	}
+}
+
+Real Oversampler::downsample(const Real* x){
+	Assert(x);
+	Real buffer[OVERSAMPLING_MAX_FACTOR];
+	memcpy(buffer, x, factor*sizeof(Real));
+	uint numSamples = factor;
+	for (int stage = ((int) downsamplers.size()) - 1; stage >= 0; --stage){
+		numSamples /= 2;
+		for (uint i = 0; i < numSamples; ++i){
+			buffer[i] = downsamplers[stage].process(buffer[2*i], buffer[2*i + 1]);
+		}
+	}
+	return buffer[0];
+}
+
+void Oversampler::saveState(State& state) const {
+	for (uint stage = 0; stage < upsamplers.size(); ++stage){
+		upsamplers[stage].saveState(state.upsamplers[stage]);
+		downsamplers[stage].saveState(state.downsamplers[stage]);
+	}
+}
+
+void Oversampler::loadState(const State& state){
+	for (uint stage = 0; stage < upsamplers.size(); ++stage){
+		upsamplers[stage].loadState(state.upsamplers[stage]);
+		downsamplers[stage].loadState(state.downsamplers[stage]);
+	}
+}
+
+Real Oversampler::getLatency() const {
+	Real latency = 0.0;
+	Real stageRate = 1.0; //Of each stage's lower rate, relative to the outer rate
+	for (uint stage = 0; stage < upsamplers.size(); ++stage){
+		latency += (upsamplers[stage].getLatency() + downsamplers[stage].getLatency())/stageRate;
+		stageRate *= 2.0;
+	}
+	return latency;
+}
+
+vector<Real> Oversampler::designHalfbandFilter(uint halfLength){
+	//Windowed sinc with its cutoff at a quarter of the sample rate, only the even taps are returned
+	uint numTaps = 4*halfLength - 1;
+	int centre = 2*halfLength - 1;
+	vector<Real> window(numTaps);
+	BasicDSP::WindowFunctions::getKaiserWindow(numTaps, OVERSAMPLING_KAISER_BETA, &window[0]);
+	vector<Real> coefficients(2*halfLength);
+	Real sum = 0.0;
+	for (uint i = 0; i < coefficients.size(); ++i){
+		Real t = 0.5*(2*((int) i) - centre);
+		coefficients[i] = 0.5*sin(M_PI*t)/(M_PI*t)*window[2*i];
+		sum += coefficients[i];
+	}
+	for (uint i = 0; i < coefficients.size(); ++i){
+		coefficients[i] *= 0.5/sum; //So that with the centre tap of 1/2 the DC gain is exactly one
+	}
+	return coefficients;
+}
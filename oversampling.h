@@ -0,0 +1,117 @@
+/************************************************************************************
+* 
+* Wavechild670 v0.1 
+* 
+* oversampling.h
+* 
+* By Peter Raffensperger 11 March 2014
+* 
+* Reference:
+* Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+* Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+* York, UK, September 17-21, 2012.
+* 
+* Note:
+* Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+* affiliated with the author.
+* 
+* License:
+* Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+* software in an academic context, we would appreciate it if you referenced the original
+* paper.
+* 
+************************************************************************************/
+
+
+#ifndef OVERSAMPLING_H
+#define OVERSAMPLING_H
+
+#include "Misc.h"
+#include "basicdsp.h"
+
+#define OVERSAMPLING_MAX_FACTOR 8
+#define OVERSAMPLING_MAX_STAGES 3 //log2(OVERSAMPLING_MAX_FACTOR)
+#define OVERSAMPLING_FIRST_STAGE_HALF_LENGTH 24 //The half-band filter between 1x and 2x has 4*24 - 1 taps
+#define OVERSAMPLING_LATER_STAGE_HALF_LENGTH 8 //Later stages only have to keep out of the first stage's band
+#define OVERSAMPLING_KAISER_BETA 8.0 //About 80dB of stopband rejection
+
+/*
+Polyphase half-band interpolation and decimation by two. A half-band filter with 4K - 1 taps has 
+every second tap zero apart from the centre one, which is 1/2, so each phase is either a plain 
+delay or a symmetric FIR with 2K taps. The histories are mirrored so that the FIR always reads 
+one contiguous window, which the dot product runs over two lanes at a time with SSE2.
+*/
+
+class HalfbandUpsampler {
+public:
+	HalfbandUpsampler(uint halfLength);
+	void process(Real x, Real& y0, Real& y1); //One sample in, two out in time order
+	Real getLatency() const { return halfLength - 0.5; } //In input samples
+	
+	struct State {
+		Real history[4*OVERSAMPLING_FIRST_STAGE_HALF_LENGTH]; //Only the first 4K are used
+		uint position;
+	};
+	void saveState(State& state) const;
+	void loadState(const State& state);
+protected:
+	uint halfLength; //K
+	vector<Real> coefficients; //Even taps of the filter times two, 2K of them
+	vector<Real> history; //Mirrored, 2*2K
+	uint position;
+};
+
+class HalfbandDownsampler {
+public:
+	HalfbandDownsampler(uint halfLength);
+	Real process(Real x0, Real x1); //Two samples in time order, one out
+	Real getLatency() const { return halfLength - 0.5; } //In output samples
+	
+	struct State {
+		Real history[4*OVERSAMPLING_FIRST_STAGE_HALF_LENGTH]; //Only the first 4K are used
+		Real oddDelay[OVERSAMPLING_FIRST_STAGE_HALF_LENGTH]; //Only the first K are used
+		uint position;
+		uint oddPosition;
+	};
+	void saveState(State& state) const;
+	void loadState(const State& state);
+protected:
+	uint halfLength; //K
+	vector<Real> coefficients; //Even taps of the filter, 2K of them
+	vector<Real> history; //Mirrored, 2*2K, of the first sample of each pair
+	vector<Real> oddDelay; //The second sample of each pair only goes through the centre tap, K samples later
+	uint position;
+	uint oddPosition;
+};
+
+class Oversampler {
+	/*
+	Cascaded half-band stages for 2x, 4x or 8x oversampling. upsample() turns each sample into 
+	factor samples at the higher rate, downsample() takes factor samples back down to one.
+	*/
+public:
+	Oversampler(uint factor_);
+	uint getFactor() const { return factor; }
+	void upsample(Real x, Real* y);
+	Real downsample(const Real* x);
+	Real getLatency() const; //Of an upsample() then downsample() round trip, in samples at the lower rate
+	
+	static bool isValidFactor(uint factor) { return factor == 1 || factor == 2 || factor == 4 || factor == 8; }
+	//The even taps (the ones off the centre that aren't zero) of a Kaiser windowed half-band filter
+	static vector<Real> designHalfbandFilter(uint halfLength);
+	
+	struct State {
+		//Only valid for an Oversampler with the same factor
+		HalfbandUpsampler::State upsamplers[OVERSAMPLING_MAX_STAGES];
+		HalfbandDownsampler::State downsamplers[OVERSAMPLING_MAX_STAGES];
+	};
+	void saveState(State& state) const;
+	void loadState(const State& state);
+	
+protected:
+	uint factor;
+	vector<HalfbandUpsampler> upsamplers; //Stage 0 goes between 1x and 2x
+	vector<HalfbandDownsampler> downsamplers;
+};
+
+#endif
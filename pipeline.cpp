@@ -0,0 +1,223 @@
+/************************************************************************************
+* 
+* Wavechild670 v0.1 
+* 
+* pipeline.cpp
+* 
+* By Peter Raffensperger 11 March 2014
+* 
+* Reference:
+* Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+* Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+* York, UK, September 17-21, 2012.
+* 
+* Note:
+* Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+* affiliated with the author.
+* 
+* License:
+* Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+* software in an academic context, we would appreciate it if you referenced the original
+* paper.
+* 
+************************************************************************************/
+
+
+
+
+#include "pipeline.h"
+#include <unistd.h>
+#include <sched.h>
+
+BlockRing::BlockRing(uint blockSize_, uint depth_) : blockSize(blockSize_), depth(depth_), head(0), tail(0) {
+	Assert(blockSize > 0 && blockSize % 2 == 0); //Whole stereo frames
+	Assert(depth >= 2);
+	blocks = new Real[blockSize*depth];
+	lengths = new uint[depth];
+}
+
+BlockRing::~BlockRing(){
+	delete[] blocks;
+	delete[] lengths;
+}
+
+void BlockRing::wait(uint& numWaits){
+	if (numWaits++ < PIPELINE_SPIN_COUNT){
+		sched_yield();
+	}
+	else {
+		usleep(PIPELINE_WAIT_SLEEP_MICROSECONDS);
+	}
+}
+
+Real* BlockRing::beginWrite(){
+	uint numWaits = 0;
+	while (head - tail >= depth){
+		wait(numWaits);
+	}
+	__sync_synchronize(); //Done with the block before it is written over
+	return blocks + (head % depth)*blockSize;
+}
+
+void BlockRing::endWrite(uint length){
+	Assert(length <= blockSize);
+	lengths[head % depth] = length;
+	__sync_synchronize(); //The block before the head that hands it over
+	head = head + 1;
+}
+
+const Real* BlockRing::beginRead(uint& length){
+	uint numWaits = 0;
+	while (head == tail){
+		wait(numWaits);
+	}
+	__sync_synchronize();
+	length = lengths[tail % depth];
+	return blocks + (tail % depth)*blockSize;
+}
+
+void BlockRing::endRead(){
+	__sync_synchronize();
+	tail = tail + 1;
+}
+
+Wavechild670Pipeline::Wavechild670Pipeline(Wavechild670& compressor_, uint blockSize, uint depth) : compressor(compressor_), 
+	inputRing(blockSize, depth), outputRing(blockSize, depth), source(NULL), sink(NULL), runTime(0.0) {
+}
+
+void Wavechild670Pipeline::run(PipelineSource& source_, PipelineSink& sink_){
+	source = &source_;
+	sink = &sink_;
+	for (uint stage = 0; stage < PIPELINE_NUM_STAGES; ++stage){
+		statistics[stage] = PipelineStageStatistics();
+	}
+	Real start = GetWallClockTime();
+	pthread_t threads[PIPELINE_NUM_STAGES];
+	void* (*entries[PIPELINE_NUM_STAGES])(void*) = {readerThreadEntry, processorThreadEntry, writerThreadEntry};
+	BlockRing* stageInputs[PIPELINE_NUM_STAGES] = {NULL, &inputRing, &outputRing};
+	//Downstream first, so nothing has been read from the source if a stage won't start
+	uint firstStarted = PIPELINE_NUM_STAGES;
+	while (firstStarted > 0) {
+		if (pthread_create(&threads[firstStarted - 1], NULL, entries[firstStarted - 1], this) != 0) {
+			LOG_ERROR("Couldn't start the pipeline's " << getStageName((PipelineStage) (firstStarted - 1)) << " thread, processing on this one instead");
+			break;
+		}
+		--firstStarted;
+	}
+	if (firstStarted > 0 && firstStarted < PIPELINE_NUM_STAGES) {
+		endStream(*stageInputs[firstStarted]); //Lets the stages that did start finish
+	}
+	for (uint stage = firstStarted; stage < PIPELINE_NUM_STAGES; ++stage){
+		pthread_join(threads[stage], NULL);
+	}
+	if (firstStarted > 0) {
+		serialLoop();
+	}
+	runTime = GetWallClockTime() - start;
+}
+
+const char* Wavechild670Pipeline::getStageName(PipelineStage stage){
+	const char* names[PIPELINE_NUM_STAGES] = {"read", "process", "write"};
+	Assert(stage < PIPELINE_NUM_STAGES);
+	return names[stage];
+}
+
+void* Wavechild670Pipeline::readerThreadEntry(void* pipeline){
+	((Wavechild670Pipeline*) pipeline)->readerLoop();
+	return NULL;
+}
+
+void* Wavechild670Pipeline::processorThreadEntry(void* pipeline){
+	((Wavechild670Pipeline*) pipeline)->processorLoop();
+	return NULL;
+}
+
+void* Wavechild670Pipeline::writerThreadEntry(void* pipeline){
+	((Wavechild670Pipeline*) pipeline)->writerLoop();
+	return NULL;
+}
+
+void Wavechild670Pipeline::readerLoop(){
+	PipelineStageStatistics& stats = statistics[PIPELINE_READ];
+	uint length = 0;
+	do {
+		Real t0 = GetWallClockTime();
+		Real* block = inputRing.beginWrite();
+		Real t1 = GetWallClockTime();
+		length = source->read(block, inputRing.getBlockSize());
+		length -= length % 2; //Whole frames
+		inputRing.endWrite(length);
+		stats.waitTime += t1 - t0;
+		stats.busyTime += GetWallClockTime() - t1;
+		stats.numBlocks += length > 0;
+	} while (length > 0);
+}
+
+void Wavechild670Pipeline::processorLoop(){
+	PipelineStageStatistics& stats = statistics[PIPELINE_PROCESS];
+	uint length = 0;
+	do {
+		Real t0 = GetWallClockTime();
+		const Real* input = inputRing.beginRead(length);
+		Real* output = outputRing.beginWrite();
+		Real t1 = GetWallClockTime();
+		if (length > 0) {
+			compressor.process((Real*) input, output, length);
+		}
+		inputRing.endRead();
+		outputRing.endWrite(length);
+		stats.waitTime += t1 - t0;
+		stats.busyTime += GetWallClockTime() - t1;
+		stats.numBlocks += length > 0;
+	} while (length > 0);
+}
+
+void Wavechild670Pipeline::writerLoop(){
+	PipelineStageStatistics& stats = statistics[PIPELINE_WRITE];
+	uint length = 0;
+	do {
+		Real t0 = GetWallClockTime();
+		const Real* block = outputRing.beginRead(length);
+		Real t1 = GetWallClockTime();
+		if (length > 0) {
+			sink->write(block, length);
+		}
+		outputRing.endRead();
+		stats.waitTime += t1 - t0;
+		stats.busyTime += GetWallClockTime() - t1;
+		stats.numBlocks += length > 0;
+	} while (length > 0);
+}
+
+void Wavechild670Pipeline::endStream(BlockRing& ring){
+	ring.beginWrite();
+	ring.endWrite(0);
+}
+
+void Wavechild670Pipeline::serialLoop(){
+	uint blockSize = inputRing.getBlockSize();
+	Real* input = new Real[blockSize];
+	Real* output = new Real[blockSize];
+	uint length = 0;
+	do {
+		Real t0 = GetWallClockTime();
+		length = source->read(input, blockSize);
+		length -= length % 2; //Whole frames
+		Real t1 = GetWallClockTime();
+		if (length > 0) {
+			compressor.process(input, output, length);
+		}
+		Real t2 = GetWallClockTime();
+		if (length > 0) {
+			sink->write(output, length);
+		}
+		statistics[PIPELINE_READ].busyTime += t1 - t0;
+		statistics[PIPELINE_PROCESS].busyTime += t2 - t1;
+		statistics[PIPELINE_WRITE].busyTime += GetWallClockTime() - t2;
+		for (uint stage = 0; stage < PIPELINE_NUM_STAGES; ++stage){
+			statistics[stage].numBlocks += length > 0;
+		}
+	} while (length > 0);
+	delete[] input;
+	delete[] output;
+}
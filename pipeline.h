@@ -0,0 +1,139 @@
+/************************************************************************************
+* 
+* Wavechild670 v0.1 
+* 
+* pipeline.h
+* 
+* By Peter Raffensperger 11 March 2014
+* 
+* Reference:
+* Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+* Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+* York, UK, September 17-21, 2012.
+* 
+* Note:
+* Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+* affiliated with the author.
+* 
+* License:
+* Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+* software in an academic context, we would appreciate it if you referenced the original
+* paper.
+* 
+************************************************************************************/
+
+
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "Misc.h"
+#include "wavechild670.h"
+#include <pthread.h>
+
+#define PIPELINE_DEFAULT_BLOCK_SIZE 1024 //Samples, interleaved stereo
+#define PIPELINE_DEFAULT_DEPTH 8 //Blocks in each ring
+#define PIPELINE_SPIN_COUNT 64 //Yields before a waiting stage starts to sleep
+#define PIPELINE_WAIT_SLEEP_MICROSECONDS 100
+
+/*
+A single producer, single consumer ring of fixed size blocks of samples. The producer fills the 
+block from beginWrite() and hands it over with endWrite(), the consumer takes it with beginRead() 
+and gives it back with endRead(). Both wait, yielding then sleeping, while the ring is full or 
+empty. A block of length 0 ends the stream.
+*/
+
+class BlockRing {
+public:
+	BlockRing(uint blockSize_, uint depth_);
+	virtual ~BlockRing();
+	
+	Real* beginWrite(); //Producer only
+	void endWrite(uint length);
+	const Real* beginRead(uint& length); //Consumer only
+	void endRead();
+	uint getBlockSize() const { return blockSize; }
+
+protected:
+	static void wait(uint& numWaits);
+	
+	uint blockSize;
+	uint depth;
+	Real* blocks;
+	uint* lengths;
+	volatile uint head; //Blocks handed over, written only by the producer
+	volatile uint tail; //Blocks given back, written only by the consumer
+
+private:
+	BlockRing(const BlockRing& other) {}
+};
+
+//Where the samples come from and go to, each only called from its own stage's thread
+class PipelineSource {
+public:
+	virtual ~PipelineSource() {}
+	virtual uint read(Real* samples, uint maxSamples) = 0; //Returns the number read, 0 at the end
+};
+
+class PipelineSink {
+public:
+	virtual ~PipelineSink() {}
+	virtual void write(const Real* samples, uint numSamples) = 0;
+};
+
+enum PipelineStage {
+	PIPELINE_READ,
+	PIPELINE_PROCESS,
+	PIPELINE_WRITE,
+	PIPELINE_NUM_STAGES
+};
+
+struct PipelineStageStatistics {
+	Real busyTime; //Seconds spent on the stage's own work
+	Real waitTime; //Seconds spent waiting for the stage before or after it
+	ulong numBlocks;
+	
+	PipelineStageStatistics() : busyTime(0.0), waitTime(0.0), numBlocks(0) {}
+};
+
+class Wavechild670Pipeline {
+	/*
+	Renders from a source to a sink with reading, processing and writing each on its own thread, 
+	connected by two BlockRings, so that decoding and encoding overlap with the DSP rather than 
+	adding to it. The statistics show each stage's utilization, its busy time as a fraction of 
+	the run, and the stage closest to 1 is the bottleneck.
+	
+	The compressor is only used from the processing thread. If a stage's thread can't be started, 
+	the ones that did are sent the end of the stream and the whole run happens on the calling 
+	thread instead.
+	*/
+public:
+	Wavechild670Pipeline(Wavechild670& compressor_, uint blockSize=PIPELINE_DEFAULT_BLOCK_SIZE, uint depth=PIPELINE_DEFAULT_DEPTH);
+	
+	void run(PipelineSource& source, PipelineSink& sink); //Returns once the sink has everything
+	
+	const PipelineStageStatistics& getStatistics(PipelineStage stage) const { return statistics[stage]; }
+	Real getUtilization(PipelineStage stage) const { return runTime > 0.0 ? statistics[stage].busyTime/runTime : 0.0; }
+	Real getRunTime() const { return runTime; }
+	static const char* getStageName(PipelineStage stage);
+
+protected:
+	static void* readerThreadEntry(void* pipeline);
+	static void* processorThreadEntry(void* pipeline);
+	static void* writerThreadEntry(void* pipeline);
+	void readerLoop();
+	void processorLoop();
+	void writerLoop();
+	static void endStream(BlockRing& ring);
+	void serialLoop(); //All three stages in turn on the calling thread
+	
+	Wavechild670& compressor;
+	BlockRing inputRing;
+	BlockRing outputRing;
+	PipelineSource* source;
+	PipelineSink* sink;
+	PipelineStageStatistics statistics[PIPELINE_NUM_STAGES];
+	Real runTime;
+};
+
+#endif
@@ -49,7 +49,3 @@ gnuplot_ctrl* MultiLinePlot(double* x, vector<double*> ys, uint numSamples, vect
 
 Scope globalScope;
 
-Scope& GScope(){
-	return globalScope;
-}
-
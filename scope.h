@@ -30,161 +30,465 @@
 #include "Misc.h"
 #include <stdarg.h>
 #include "basicdsp.h"
+#include "tracewriter.h"
 
 #include "gnuplot_i.h"
 
 //Control use of the global scope object. Disable use of the global scope for best performance, but it may be useful in debugging.
-#define USE_SCOPE
+//The real-time build defines USE_SCOPE as 0.
+#ifndef USE_SCOPE
+#define USE_SCOPE 1
+#endif
 
-#ifdef USE_SCOPE
-#define SCOPE(channel, value) GScope()[channel](value)
+#if USE_SCOPE
+//Each SCOPE() looks its probe up by name once, the first time it runs, and keeps the handle
+#define SCOPE(channel, value) do { static const ProbeHandle scopeProbeHandle = GScope().getHandle(channel); GScope()[scopeProbeHandle](value); } while (0)
 #define SCOPE_PROBE(name, numChannels) GScope().addProbe(name, numChannels)
 #define SCOPE_RESET() LOG_INFO("GScope reset!"); GScope().reset()
+//Something happened, for a SCOPE_TRIGGER_EVENT trigger
+#define SCOPE_EVENT(name) do { static const ProbeHandle scopeEventHandle = GScope().getEventHandle(name); GScope()[scopeEventHandle].event(); } while (0)
 #else
 #define SCOPE(channel, value)
+#define SCOPE_EVENT(name)
 #define SCOPE_RESET()
 #define SCOPE_PROBE(name, numChannels)
 #endif
 
 #define SCOPE_DEFAULT_BUFFER_SIZE 1024
 #define SCOPE_DEFAULT_SAMPLERATE 44100.0
+#define SCOPE_ALIGNMENT 64 //Bytes, each probe's ring buffer starts on its own cache line
 
 gnuplot_ctrl* MultiLinePlot(double* x, vector<double*> ys, uint numSamples, vector<string> labels, string title);
 
+typedef uint ProbeHandle;
+
+class Scope;
+
+enum ScopeTriggerCondition {
+	SCOPE_TRIGGER_NONE,
+	SCOPE_TRIGGER_RISING, //Crosses the threshold upwards
+	SCOPE_TRIGGER_FALLING,
+	SCOPE_TRIGGER_CROSSING, //Either way
+	SCOPE_TRIGGER_ABOVE, //Magnitude at or above the threshold, such as a clipped output
+	SCOPE_TRIGGER_NAN,
+	SCOPE_TRIGGER_EVENT //Each SCOPE_EVENT()
+};
+
 class Probe {
+	/*
+	One named probe. Its ring buffer is a slice of the Scope's storage, which the Scope lays out 
+	again whenever a probe is added or the buffer size changes. Samples of a probe with several 
+	channels are interleaved. A probe with a decimation of N keeps one frame in N, for the ring 
+	buffer, captures and the trace, but checks its trigger on every sample. Event probes have no 
+	channels and keep no samples.
+	*/
 public:
-	Probe(string name_="", uint bufferSize_=SCOPE_DEFAULT_BUFFER_SIZE, uint numChannels_=1) : 
-	name(name_), bufferSize(bufferSize_), buffer(0), nextSampleIndex(0), numChannels(numChannels_) { }
-	
-	virtual ~Probe() { Confirm(buffer == 0); }
-	
-	virtual void setup() { 
-		buffer = new Real[bufferSize*numChannels]; 
-		nextSampleIndex = 0;
-		for (uint i = 0; i < bufferSize*numChannels; ++i){
-			buffer[i] = 0.0;
-		}
-	}
-	
-	virtual void cleanup() { 
-		//cout << "Cleaning up " << name << "!" << endl;
-		delete[] buffer; 
-		buffer = 0;
-	}
-
-	virtual void reset(){
-		cleanup();
-		setup();
-	}
+	Probe(string name_="", uint numChannels_=1, bool enabled_=true, ProbeHandle handle_=0, Scope* scope_=0) : 
+	name(name_), numChannels(numChannels_), enabled(enabled_), buffer(0), length(0), nextSampleIndex(0), 
+	handle(handle_), scope(scope_), trace(0), traceFrameKept(false), channel(0), decimation(1), decimationPhase(0), 
+	numFrames(0), numFramesWhenArmed(0), triggerCondition(SCOPE_TRIGGER_NONE), triggerThreshold(0.0), captureSamplesRemaining(0) { }
 
 	void operator() (const Real sample) {
-		saveSample(sample);
+		if (enabled) {
+			saveSample(sample);
+		}
 	}
 
 	void operator() (const Real* buf, uint numSamples) {
-		//cout << name << " Snatching buffer of length " << numSamples << " nextSampleIndex = " << nextSampleIndex << endl;
-		for (uint i = 0; i < numSamples; ++i){
-			saveSample(buf[i]);
+		if (enabled) {
+			for (uint i = 0; i < numSamples; ++i){
+				saveSample(buf[i]);
+			}
 		}
 	}
 
-	virtual void saveSample(const Real sample){
-		Assert(buffer);
-		buffer[nextSampleIndex++] = sample;
-		if (nextSampleIndex >= bufferSize*numChannels){
-			nextSampleIndex = 0;
+	inline void saveSample(const Real sample); //After Scope, which it triggers
+	inline void event();
+	
+	void traceSample(const Real sample){
+		//Whole frames only, so that a multichannel column stays interleaved when samples are dropped
+		if (channel == 0){
+			traceFrameKept = trace->reserve(handle, numChannels);
+		}
+		if (traceFrameKept){
+			trace->push(handle, sample);
 		}
 	}
-
-	virtual Real* getBufferAlignedOneChannel(uint channel) const{
-		/*for (uint i = 0; i < bufferSize*numChannels; ++i){
-			cout << "i=" << i << " " << name << "=" << buffer[i] << endl;
+	
+	void setTrace(TraceWriter* trace_){
+		//Streams every sample kept from now on to the trace as well, or stops if trace_ is null. Event 
+		//probes get an empty column too, so that the trace's columns stay indexed by handle
+		trace = trace_;
+		if (trace){
+			trace->defineColumn(handle, name, numChannels);
 		}
-		Real *bufOneChannel = BasicDSP::Deinterleave(buffer+channel, bufferSize, numChannels);
-		for (uint i = 0; i < bufferSize; ++i){
-			cout << "i=" << i << " " << name << "Deinterleaved" << channel << "=" << bufOneChannel[i] << endl;
+	}
+
+	void attach(Real* buffer_, uint length_){
+		buffer = buffer_;
+		length = length_;
+		nextSampleIndex = 0;
+		captureSamplesRemaining = 0;
+	}
+	void reset(){
+		for (uint i = 0; i < length; ++i){
+			buffer[i] = 0.0;
 		}
-		return bufOneChannel;*/
+		nextSampleIndex = 0;
+	}
+
+	Real* getBufferAlignedOneChannel(uint channel) const{
 		Real *bufAligned = getBufferAligned();
-		Real *bufAlignedOneChannel = BasicDSP::Deinterleave(bufAligned+channel, bufferSize, numChannels);
-		//cout << "Deleting bufAligned" << endl;
+		Real *bufAlignedOneChannel = BasicDSP::Deinterleave(bufAligned+channel, length/numChannels, numChannels);
 		delete[] bufAligned;
 		return bufAlignedOneChannel;
-		
 	}
 	
-	virtual Real* getBufferAligned() const{
-		Real *bufAligned = new Real[bufferSize*numChannels];
-		for (uint i = nextSampleIndex; i < bufferSize*numChannels; ++i){
-			//cout << "i=" << i << " i - nextSampleIndex=" << i - nextSampleIndex << endl;
-			bufAligned[i - nextSampleIndex] = buffer[i];
+	Real* getBufferAligned() const{
+		Real *bufAligned = new Real[length];
+		copyBufferAligned(bufAligned);
+		return bufAligned;
+	}
+	void copyBufferAligned(Real* destination) const{
+		//Oldest sample first
+		for (uint i = nextSampleIndex; i < length; ++i){
+			destination[i - nextSampleIndex] = buffer[i];
 		}		
 		for (uint i = 0; i < nextSampleIndex; ++i){
-			//cout << "i=" << i << " i + nextSampleIndex=" << i + nextSampleIndex << endl;
-			bufAligned[i + bufferSize*numChannels - nextSampleIndex] = buffer[i];
+			destination[i + length - nextSampleIndex] = buffer[i];
 		}		
-		return bufAligned;
 	}
+	
+	void setTrigger(ScopeTriggerCondition condition, Real threshold){
+		triggerCondition = condition;
+		triggerThreshold = threshold;
+		previousSamples.assign(numChannels, NAN); //No crossing from before the trigger was set
+	}
+	ScopeTriggerCondition getTriggerCondition() const { return triggerCondition; }
+	
+	void setDecimation(uint decimation_){
+		Assert(decimation_ >= 1);
+		decimation = decimation_;
+		decimationPhase = 0;
+	}
+	uint getDecimation() const { return decimation; }
+	
+	void beginCapture(uint postTriggerLength){
+		//Keeps postTriggerLength more frames, after finishing the frame under way, before the capture
+		captureSamplesRemaining = postTriggerLength*numChannels;
+		if (channel != 0 && decimationPhase == 0){
+			captureSamplesRemaining += numChannels - channel;
+		}
+	}
+	bool isCapturing() const { return captureSamplesRemaining > 0; }
+	void markArmed() { numFramesWhenArmed = numFrames; }
+	bool isActiveSinceArmed() const { return numFrames > numFramesWhenArmed; }
+	void endCapture() { captureSamplesRemaining = 0; }
 
-	virtual uint getNumChannels() const{
-		return numChannels;
+	const string& getName() const { return name; }
+	uint getNumChannels() const { return numChannels; }
+	void setNumChannels(uint numChannels_) { 
+		numChannels = numChannels_; 
+		channel = 0;
+		previousSamples.assign(numChannels, NAN);
+		setTrace(trace);
 	}
+	uint getLength() const { return length; }
+	Real* getBuffer() const { return buffer; }
+	ulong getNumFrames() const { return numFrames; } //Seen, including those decimated away
+	bool isEnabled() const { return enabled; }
+	void setEnabled(bool enabled_) { enabled = enabled_; }
 	
 protected:
-	uint bufferSize;
-	uint nextSampleIndex;
-	
-	Real *buffer;
+	bool isTriggeredBy(const Real sample){
+		Real previousSample = previousSamples[channel];
+		previousSamples[channel] = sample;
+		switch (triggerCondition){
+			case SCOPE_TRIGGER_RISING:
+				return previousSample < triggerThreshold && sample >= triggerThreshold;
+			case SCOPE_TRIGGER_FALLING:
+				return previousSample > triggerThreshold && sample <= triggerThreshold;
+			case SCOPE_TRIGGER_CROSSING:
+				return (previousSample < triggerThreshold && sample >= triggerThreshold) || (previousSample > triggerThreshold && sample <= triggerThreshold);
+			case SCOPE_TRIGGER_ABOVE:
+				return fabs(sample) >= triggerThreshold;
+			case SCOPE_TRIGGER_NAN:
+				return isnan(sample);
+			default:
+				return false;
+		}
+	}
+
 	string name;
 	uint numChannels;
+	bool enabled;
+	Real *buffer;
+	uint length; //bufferSize*numChannels
+	uint nextSampleIndex;
+	ProbeHandle handle; //Also the trace column
+	Scope *scope;
+	TraceWriter *trace;
+	bool traceFrameKept;
+	uint channel; //Of the next sample
+	uint decimation;
+	uint decimationPhase; //Of the next frame, kept when 0
+	ulong numFrames;
+	ulong numFramesWhenArmed;
+	ScopeTriggerCondition triggerCondition;
+	Real triggerThreshold;
+	vector<Real> previousSamples; //Per channel, for crossings
+	uint captureSamplesRemaining; //Samples to keep before this probe's part of a capture is taken
 };
 
-typedef map<string, Probe> ProbeMap;
+struct ScopeCapture {
+	ProbeHandle source; //The probe that triggered it
+	ulong sourceFrame; //The source's frame count at the trigger
+	Real sourceValue;
+};
 
 class Scope {
+	/*
+	Probes are registered by name, up front with addProbe() or by the first SCOPE() that uses them, 
+	and are then addressed by the handle that returns. Their ring buffers live in one flat, cache 
+	aligned block. Every probe can be switched off at run time, which leaves a SCOPE() costing a 
+	test and a branch, so the scope can stay compiled in and be switched on to debug a render.
+	startTrace() also streams every enabled probe's samples to a file, for renders too long for the 
+	ring buffers.
+	
+	Once arm()ed, a probe's trigger condition starts a capture: each enabled probe keeps 
+	postTriggerLength more frames, and its ring buffer, holding those and the bufferSize - 
+	postTriggerLength frames before them, is then copied aside. Probes that haven't been used since 
+	arm() are copied as they are, rather than holding the capture up. The scope rearms until it has 
+	maxCaptures captures, all in storage allocated by arm(), so capture can be left armed through a 
+	long render and keeps only the moments around the events.
+	*/
 public:
 	Scope(uint bufferSize_=SCOPE_DEFAULT_BUFFER_SIZE, Real sampleRate_=SCOPE_DEFAULT_SAMPLERATE): 
-	bufferSize(bufferSize_), sampleRate(sampleRate_){
+	sampleRate(sampleRate_), bufferSize(bufferSize_), enabledByDefault(true), storage(0), alignedStorage(0), storageLength(0), 
+	trace(0), captureState(SCOPE_CAPTURE_IDLE), postTriggerLength(0), maxCaptures(0), captureStorage(0), numProbesCapturing(0) {
 		
 	}
 	
 	virtual void setup(uint bufferSize_, Real sampleRate_){
 		sampleRate = sampleRate_;
 		bufferSize = bufferSize_;
+		layOutProbes();
 	}
 	
 	virtual ~Scope() {
+		stopTrace();
 		for (uint i = 0; i < graphs.size(); ++i){
 			gnuplot_close(graphs[i]);
 		}
-		ProbeMap::const_iterator end = probes.end(); 
-		for (ProbeMap::iterator it = probes.begin(); it != end; ++it) {
-			it->second.cleanup();
-		}		
+		delete[] storage;
+		delete[] captureStorage;
 	}
 	
 	virtual void reset(){
-		ProbeMap::const_iterator end = probes.end(); 
-		for (ProbeMap::iterator it = probes.begin(); it != end; ++it) {
-			it->second.reset();
-		}				
+		for (uint i = 0; i < probes.size(); ++i){
+			probes[i].reset();
+		}
+	}
+	
+	virtual ProbeHandle addProbe(string name, uint numChannels=1){
+		//Adds the probe, or changes its number of channels if it's already there
+		map<string, ProbeHandle>::const_iterator it = handles.find(name);
+		ProbeHandle handle;
+		if (it == handles.end()){
+			handle = probes.size();
+			probes.push_back(Probe(name, numChannels, enabledByDefault, handle, this));
+			probes[handle].setTrace(trace);
+			handles[name] = handle;
+		}
+		else {
+			handle = it->second;
+			probes[handle].setNumChannels(numChannels);
+		}
+		layOutProbes();
+		return handle;
+	}
+	
+	ProbeHandle getHandle(const string& name){
+		map<string, ProbeHandle>::const_iterator it = handles.find(name);
+		if (it == handles.end()){
+			return addProbe(name);
+		}
+		return it->second;
+	}
+	
+	ProbeHandle getEventHandle(const string& name){
+		map<string, ProbeHandle>::const_iterator it = handles.find(name);
+		if (it == handles.end()){
+			return addProbe(name, 0);
+		}
+		return it->second;
+	}
+	
+	Probe* findProbe(const string& name){
+		//Null if there's no such probe; unlike operator[], this never adds one, which would clear the buffers
+		map<string, ProbeHandle>::const_iterator it = handles.find(name);
+		if (it == handles.end()){
+			return 0;
+		}
+		return &probes[it->second];
 	}
 	
-	virtual void addProbe(string name, uint numChannels=1){
-		probes[name] = Probe(name, bufferSize, numChannels);
-		probes[name].setup();
+	Probe& operator[](ProbeHandle handle) {
+		Assert(handle < probes.size());
+		return probes[handle];
 	}
 	
-	Probe& operator[](const string key) {
-		ProbeMap::const_iterator end = probes.end(); 
-    	if (probes.find(key) == end){
-			addProbe(key);
-    	}
-    	return probes[key];
+	Probe& operator[](const string& key) {
+		return probes[getHandle(key)];
 	}
 	
 	virtual void saveSample(string probeName, Real sample){
-		probes[probeName].saveSample(sample);
+		(*this)[probeName].saveSample(sample);
+	}
+	
+	void setEnabled(bool enabled){
+		//All probes, including ones added later
+		enabledByDefault = enabled;
+		for (uint i = 0; i < probes.size(); ++i){
+			probes[i].setEnabled(enabled);
+		}
+	}
+	void setEnabled(const string& name, bool enabled){
+		(*this)[name].setEnabled(enabled);
+	}
+	
+	void setDecimation(uint decimation){
+		//All probes there now
+		for (uint i = 0; i < probes.size(); ++i){
+			probes[i].setDecimation(decimation);
+		}
+	}
+	void setDecimation(const string& name, uint decimation){
+		(*this)[name].setDecimation(decimation);
+	}
+	
+	void setTrigger(const string& name, ScopeTriggerCondition condition, Real threshold=0.0){
+		if (condition == SCOPE_TRIGGER_EVENT){
+			probes[getEventHandle(name)].setTrigger(condition, threshold);
+		}
+		else {
+			(*this)[name].setTrigger(condition, threshold);
+		}
+	}
+	
+	void arm(uint postTriggerLength_, uint maxCaptures_){
+		//Discards any earlier captures, so arm(0, 0) frees them
+		Assert(postTriggerLength_ <= bufferSize);
+		postTriggerLength = postTriggerLength_;
+		maxCaptures = maxCaptures_;
+		for (uint i = 0; i < probes.size(); ++i){
+			probes[i].endCapture();
+			probes[i].markArmed();
+		}
+		captures.clear();
+		captures.reserve(maxCaptures);
+		delete[] captureStorage;
+		captureStorage = new Real[maxCaptures*storageLength];
+		captureState = maxCaptures > 0 ? SCOPE_CAPTURE_ARMED : SCOPE_CAPTURE_IDLE;
+	}
+	void disarm(){
+		//Takes what there is of a capture under way, and keeps the captures
+		if (captureState == SCOPE_CAPTURE_CAPTURING){
+			for (uint i = 0; i < probes.size(); ++i){
+				if (probes[i].isCapturing()){
+					probes[i].endCapture();
+					copyIntoCapture(i);
+				}
+			}
+		}
+		captureState = SCOPE_CAPTURE_IDLE;
+	}
+	bool isArmed() const { return captureState == SCOPE_CAPTURE_ARMED; }
+	
+	void trigger(ProbeHandle source, Real value){
+		if (captureState != SCOPE_CAPTURE_ARMED){
+			return;
+		}
+		ScopeCapture capture;
+		capture.source = source;
+		capture.sourceFrame = probes[source].getNumFrames();
+		capture.sourceValue = value;
+		captures.push_back(capture); //Within the capacity reserved by arm()
+		captureState = SCOPE_CAPTURE_CAPTURING;
+		numProbesCapturing = 0;
+		for (uint i = 0; i < probes.size(); ++i){
+			if (!probes[i].isEnabled() || probes[i].getNumChannels() == 0){
+				continue;
+			}
+			if (probes[i].isActiveSinceArmed()){
+				probes[i].beginCapture(postTriggerLength);
+			}
+			if (probes[i].isCapturing()){
+				numProbesCapturing++;
+			}
+			else {
+				copyIntoCapture(i);
+			}
+		}
+		if (numProbesCapturing == 0){
+			finishCapture();
+		}
+	}
+	void captureProbe(ProbeHandle handle){
+		//The probe has kept its post trigger frames
+		copyIntoCapture(handle);
+		Assert(numProbesCapturing > 0);
+		if (--numProbesCapturing == 0){
+			finishCapture();
+		}
+	}
+	
+	uint getNumCaptures() const { return captures.size(); }
+	const ScopeCapture& getCapture(uint capture) const { return captures[capture]; }
+	const string& getProbeName(ProbeHandle handle) const { return probes[handle].getName(); }
+	Real* getCapturedSamples(uint capture, const string& name){
+		//Oldest sample first, like Probe::getBufferAligned()
+		Assert(capture < captures.size());
+		Assert(handles.count(name));
+		const Probe& probe = probes[handles[name]];
+		Real *samples = new Real[probe.getLength()];
+		const Real *captured = getCaptureSlot(capture, probe);
+		for (uint i = 0; i < probe.getLength(); ++i){
+			samples[i] = captured[i];
+		}
+		return samples;
+	}
+
+	bool startTrace(const string& filename, Real traceSampleRate){
+		//Streams all the probes, including ones added later, to a trace file until stopTrace()
+		stopTrace();
+		trace = new TraceWriter();
+		if (!trace->open(filename, traceSampleRate)){
+			delete trace;
+			trace = 0;
+			return false;
+		}
+		for (uint i = 0; i < probes.size(); ++i){
+			probes[i].setTrace(trace);
+		}
+		return true;
+	}
+	ulong stopTrace(){
+		//Returns the number of samples the trace writer couldn't keep up with
+		if (!trace){
+			return 0;
+		}
+		for (uint i = 0; i < probes.size(); ++i){
+			probes[i].setTrace(0);
+		}
+		trace->close();
+		ulong numDropped = trace->getNumDropped();
+		if (numDropped > 0){
+			LOG_WARNING("The trace writer fell behind and dropped " << numDropped << " samples");
+		}
+		delete trace;
+		trace = 0;
+		return numDropped;
 	}
 
 	virtual void showGraph(string title, uint numTraces, ...){
@@ -197,7 +501,25 @@ public:
 			probeNameRestrictions.push_back(string(probeName));
 		}
 		va_end(args);
-		
+		plot(title, probeNameRestrictions, -1);
+	}
+	
+	virtual void showCapture(uint capture, string title, uint numTraces, ...){
+		va_list args;
+		vector<string> probeNameRestrictions;
+
+		va_start(args, numTraces); 
+		for (uint i = 0; i < numTraces; ++i) {
+			string probeName = va_arg(args, const char*);
+			probeNameRestrictions.push_back(string(probeName));
+		}
+		va_end(args);
+		plot(title, probeNameRestrictions, capture);
+	}
+	
+protected:
+	void plot(string title, const vector<string>& probeNameRestrictions, int capture){
+		//The live ring buffers, or a capture
 		Real *x = new Real[bufferSize];
 		Real dt = 1.0 / sampleRate;
 		for (uint i = 0; i < bufferSize; ++i){
@@ -206,23 +528,28 @@ public:
 		//cout << "Max x value " << x[bufferSize-1] << endl;
 		vector<string> channelNames;
 		vector<Real*> ys;
-		ProbeMap::const_iterator end = probes.end(); 
-		for (ProbeMap::const_iterator it = probes.begin(); it != end; ++it) {
-			for (uint i = 0; i < probeNameRestrictions.size(); ++i){
-				if (probeNameRestrictions[i] == it->first){
-					if(it->second.getNumChannels() > 1){
-						for (uint channelIndex = 0; channelIndex < it->second.getNumChannels(); ++channelIndex){
-							stringstream name;
-							name << it->first << channelIndex;
-							channelNames.push_back(name.str());
-							ys.push_back(it->second.getBufferAlignedOneChannel(channelIndex));
-						}
-					}
-					else{
-						channelNames.push_back(it->first);
-						ys.push_back(it->second.getBufferAligned());
-					}
+		for (uint i = 0; i < probeNameRestrictions.size(); ++i){
+			map<string, ProbeHandle>::const_iterator it = handles.find(probeNameRestrictions[i]);
+			if (it == handles.end()){
+				continue;
+			}
+			const Probe& probe = probes[it->second];
+			if (probe.getNumChannels() == 0){
+				continue;
+			}
+			Real *samples = capture < 0 ? probe.getBufferAligned() : getCapturedSamples(capture, probe.getName());
+			if(probe.getNumChannels() > 1){
+				for (uint channelIndex = 0; channelIndex < probe.getNumChannels(); ++channelIndex){
+					stringstream name;
+					name << probe.getName() << channelIndex;
+					channelNames.push_back(name.str());
+					ys.push_back(BasicDSP::Deinterleave(samples + channelIndex, bufferSize, probe.getNumChannels()));
 				}
+				delete[] samples;
+			}
+			else{
+				channelNames.push_back(probe.getName());
+				ys.push_back(samples);
 			}
 		}		
 		
@@ -236,14 +563,114 @@ public:
 		graphs.push_back(g);
 	}
 	
-protected:
+	Real* getCaptureSlot(uint capture, const Probe& probe){
+		//Captures are laid out like the ring buffers
+		return captureStorage + capture*storageLength + (probe.getBuffer() - alignedStorage);
+	}
+	void copyIntoCapture(ProbeHandle handle){
+		probes[handle].copyBufferAligned(getCaptureSlot(captures.size() - 1, probes[handle]));
+	}
+	void finishCapture(){
+		captureState = captures.size() < maxCaptures ? SCOPE_CAPTURE_ARMED : SCOPE_CAPTURE_IDLE;
+	}
+	
+	void layOutProbes(){
+		//Gives every probe a fresh, zeroed ring buffer, each starting on a cache line
+		const uint lineLength = SCOPE_ALIGNMENT/sizeof(Real);
+		vector<uint> offsets(probes.size());
+		uint totalLength = 0;
+		for (uint i = 0; i < probes.size(); ++i){
+			offsets[i] = totalLength;
+			uint length = bufferSize*probes[i].getNumChannels();
+			totalLength += (length + lineLength - 1)/lineLength*lineLength;
+		}
+		delete[] storage;
+		storage = new Real[totalLength + lineLength];
+		storageLength = totalLength;
+		alignedStorage = storage + (lineLength - ((size_t) storage/sizeof(Real)) % lineLength) % lineLength;
+		for (uint i = 0; i < totalLength; ++i){
+			alignedStorage[i] = 0.0;
+		}
+		for (uint i = 0; i < probes.size(); ++i){
+			probes[i].attach(alignedStorage + offsets[i], bufferSize*probes[i].getNumChannels());
+		}
+		if (captureStorage){
+			//The captures' layout has changed with the ring buffers'
+			if (!captures.empty()){
+				LOG_WARNING("Scope probes changed, discarding " << captures.size() << " captures");
+			}
+			bool wasArmed = captureState != SCOPE_CAPTURE_IDLE;
+			arm(min(postTriggerLength, bufferSize), maxCaptures);
+			if (!wasArmed){
+				captureState = SCOPE_CAPTURE_IDLE;
+			}
+		}
+	}
+
 	Real sampleRate;
 	vector<gnuplot_ctrl*> graphs;
-	ProbeMap probes;
+	vector<Probe> probes; //Indexed by handle
+	map<string, ProbeHandle> handles;
 	
 	uint bufferSize;
+	bool enabledByDefault;
+	Real *storage; //All the probes' ring buffers, allocated with a cache line to spare for alignment
+	Real *alignedStorage;
+	uint storageLength;
+	TraceWriter *trace; //While tracing
+	
+	enum CaptureState {
+		SCOPE_CAPTURE_IDLE,
+		SCOPE_CAPTURE_ARMED,
+		SCOPE_CAPTURE_CAPTURING
+	} captureState;
+	uint postTriggerLength;
+	uint maxCaptures;
+	vector<ScopeCapture> captures;
+	Real *captureStorage; //maxCaptures copies of storage's layout
+	uint numProbesCapturing; //Yet to keep their post trigger frames
 };
 
-Scope& GScope();
+void Probe::saveSample(const Real sample){
+	bool triggered = triggerCondition != SCOPE_TRIGGER_NONE && isTriggeredBy(sample) && scope->isArmed();
+	if (decimationPhase == 0){
+		Assert(buffer);
+		buffer[nextSampleIndex++] = sample;
+		if (nextSampleIndex >= length){
+			nextSampleIndex = 0;
+		}
+		if (trace){
+			traceSample(sample);
+		}
+		if (captureSamplesRemaining > 0 && --captureSamplesRemaining == 0){
+			scope->captureProbe(handle);
+		}
+	}
+	if (++channel >= numChannels){
+		channel = 0;
+		numFrames++;
+		if (++decimationPhase >= decimation){
+			decimationPhase = 0;
+		}
+	}
+	if (triggered){
+		scope->trigger(handle, sample);
+	}
+}
+
+void Probe::event(){
+	if (enabled){
+		numFrames++;
+		if (triggerCondition == SCOPE_TRIGGER_EVENT){
+			scope->trigger(handle, numFrames);
+		}
+	}
+}
+
+extern Scope globalScope;
+
+inline Scope& GScope(){
+	return globalScope;
+}
 
 #endif
\ No newline at end of file
@@ -31,10 +31,13 @@
 #include "wdfcircuits.h"
 #include "basicdsp.h"
 #include "scope.h"
+#include "fastmath.h"
+#include "statespace.h"
 
 #define USE_EARLY_EXIT_HEURISTICS false
 
 class SidechainAmplifier {
+	friend class Wavechild670Batch;
 public:
 	SidechainAmplifier(Real sampleRate, Real ACThresholdNew, Real DCThresholdNew) : inputCircuit(Cw, 0.0, Lm, Lp, Ls, NpOverNs, Rc, RinParallelValue, RpotValue, Rp, Rs, RinSeriesValue, sampleRate) {
 		setThresholds(ACThresholdNew, DCThresholdNew);
@@ -43,6 +46,8 @@ public:
 		earlyExit1 = 0;
 		calls = 0;
 		currentOvers = 0;
+		inputCircuitStateSpace = StateSpaceFilter::fromCircuit(inputCircuit);
+		useStateSpaceInputCircuit = false;
 
 	}
 	virtual ~SidechainAmplifier(){
@@ -67,12 +72,50 @@ public:
 	}
 	
 	virtual Real advanceAndGetCurrent(Real VinSidechain, Real VlevelCap) {
+		return getCurrent(advanceInputCircuit(VinSidechain), VlevelCap);
+	}
+	
+	/*
+	advanceAndGetCurrent() split at the input transformer, so that the nonlinear stages can run at 
+	a lower rate than the transformer: advanceInputCircuit() returns VgPlus, the grid voltage of the 
+	DC threshold stage, and getCurrent() takes it the rest of the way. The output current only 
+	depends on |VgPlus| (the stages after the transformer are odd functions followed by a full wave 
+	rectifier) and grows with it.
+	*/
+	Real advanceInputCircuit(Real VinSidechain) {
 		Assert(!isnan(VinSidechain));
-		Assert(!isnan(VlevelCap));
 		calls++;
-		Real VgPlus = ACThresholdProcessed*inputCircuit.advance(VinSidechain);
+		Real VgPlus = ACThresholdProcessed*(useStateSpaceInputCircuit ? inputCircuitStateSpace.advance(VinSidechain) : inputCircuit.advance(VinSidechain));
 		SCOPE("VgPlus", VgPlus);
 		Assert(!isnan(VgPlus));
+		return VgPlus;
+	}
+	void advanceInputCircuitBlock(Real* voltages, uint numSamples) {
+		//advanceInputCircuit() in place over a block, without the scope
+		calls += numSamples;
+		if (useStateSpaceInputCircuit) {
+			inputCircuitStateSpace.process(voltages, voltages, numSamples);
+		}
+		else {
+			for (uint i = 0; i < numSamples; ++i){
+				voltages[i] = inputCircuit.advance(voltages[i]);
+			}
+		}
+		for (uint i = 0; i < numSamples; ++i){
+			voltages[i] *= ACThresholdProcessed;
+			Assert(!isnan(voltages[i]));
+		}
+	}
+	void setUseStateSpaceInputCircuit(bool useStateSpace) {
+		//The state space realisation takes over from the WDF's current state
+		if (useStateSpace && !useStateSpaceInputCircuit) {
+			inputCircuitStateSpace.setState(inputCircuit.getState());
+		}
+		useStateSpaceInputCircuit = useStateSpace;
+	}
+	
+	Real getCurrent(Real VgPlus, Real VlevelCap) {
+		Assert(!isnan(VlevelCap));
 #if USE_EARLY_EXIT_HEURISTICS
 		//Early exit heuristic 0
 		if (fabs(VgPlus) * overallVoltageGain < VlevelCap){
@@ -99,11 +142,24 @@ public:
 		Confirm(!isnan(Iout));		
 		return Iout;
 	}
+	
+	struct State {
+		TransformerCoupledInputCircuit::State inputCircuit;
+		StateSpaceFilter::State inputCircuitStateSpace;
+	};
+	void saveState(State& state) const {
+		inputCircuit.saveState(state.inputCircuit);
+		inputCircuitStateSpace.saveState(state.inputCircuitStateSpace);
+	}
+	void loadState(const State& state) {
+		inputCircuit.loadState(state.inputCircuit);
+		inputCircuitStateSpace.loadState(state.inputCircuitStateSpace);
+	}
 protected:
 				
 	inline Real getDCThresholdStageVsc(Real VgPlus) {
-		Real xp = log1p(exp(VgPlus + DCThresholdProcessed));
-		Real xm = log1p(exp(-VgPlus + DCThresholdProcessed));
+		Real xp = FastMath::log1p(FastMath::exp(VgPlus + DCThresholdProcessed));
+		Real xm = FastMath::log1p(FastMath::exp(-VgPlus + DCThresholdProcessed));
 		Real x = xp - xm;
 		return VscScaleFactor*x;
 	}
@@ -113,11 +169,12 @@ protected:
 		//One side-saturation (does not saturate negatives)
 		const Real b = 10.0/maxOutputCurrent;
 		const Real c = 10.0;
-		Real isat = log1p(exp(b*i-c))/b;
+		Real isat = FastMath::log1p(FastMath::exp(b*i-c))/b;
 		isat = fmin(isat, i);
 		Confirm(isfinite(isat));
 		if (i > maxOutputCurrent) {
 			currentOvers += 1;
+			SCOPE_EVENT("currentOver");
 		}
 		return i - isat;
 	}
@@ -126,7 +183,7 @@ protected:
 		const Real b = 10.0/diodeDropX2;
 		const Real c = 10.0;
 		if (V < 20.0){
-			return log1p(exp(b*V-c))/b;
+			return FastMath::log1p(FastMath::exp(b*V-c))/b;
 		}
 		else{
 			return V - diodeDropX2;
@@ -158,6 +215,8 @@ protected:
 	Real DCThresholdProcessed;
 
 	TransformerCoupledInputCircuit inputCircuit;
+	StateSpaceFilter inputCircuitStateSpace; //Equivalent to inputCircuit
+	bool useStateSpaceInputCircuit;
 	
 	//Input stage
 	static const Real RinSeriesValue;
@@ -0,0 +1,220 @@
+/************************************************************************************
+* 
+* Wavechild670 v0.1 
+* 
+* statespace.cpp
+* 
+* By Peter Raffensperger 11 March 2014
+* 
+* Reference:
+* Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+* Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+* York, UK, September 17-21, 2012.
+* 
+* Note:
+* Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+* affiliated with the author.
+* 
+* License:
+* Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+* software in an academic context, we would appreciate it if you referenced the original
+* paper.
+* 
+************************************************************************************/
+
+
+
+
+#include "statespace.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+StateSpaceFilter::StateSpaceFilter() : D(0.0) {
+	for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+		for (uint j = 0; j < STATE_SPACE_ORDER; ++j){
+			A[i][j] = 0.0;
+		}
+		B[i] = 0.0;
+		C[i] = 0.0;
+		x[i] = 0.0;
+	}
+	precomputePowers();
+}
+
+void StateSpaceFilter::precomputePowers(){
+	for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+		for (uint j = 0; j < STATE_SPACE_ORDER; ++j){
+			powersOfA[0][i][j] = i == j ? 1.0 : 0.0;
+		}
+	}
+	for (uint k = 1; k <= STATE_SPACE_CHUNK_LENGTH; ++k){
+		for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+			for (uint j = 0; j < STATE_SPACE_ORDER; ++j){
+				Real sum = 0.0;
+				for (uint m = 0; m < STATE_SPACE_ORDER; ++m){
+					sum += A[i][m]*powersOfA[k - 1][m][j];
+				}
+				powersOfA[k][i][j] = sum;
+			}
+		}
+	}
+	for (uint k = 0; k < STATE_SPACE_CHUNK_LENGTH; ++k){
+		for (uint j = 0; j < STATE_SPACE_ORDER; ++j){
+			Real sum = 0.0;
+			for (uint m = 0; m < STATE_SPACE_ORDER; ++m){
+				sum += C[m]*powersOfA[k][m][j];
+			}
+			CPowersOfA[j][k] = sum;
+		}
+	}
+}
+
+void StateSpaceFilter::process(const Real* u, Real* y, uint numSamples){
+	const uint chunkLength = STATE_SPACE_CHUNK_LENGTH;
+	uint position = 0;
+	while (position < numSamples){
+		//The zero state responses of up to STATE_SPACE_NUM_LANES chunks...
+		uint remaining = numSamples - position;
+		Real chunkEndStates[STATE_SPACE_NUM_LANES][STATE_SPACE_ORDER];
+		uint numChunks;
+		if (remaining >= STATE_SPACE_NUM_LANES*chunkLength){
+			processChunksFromZeroState(u + position, y + position, chunkEndStates);
+			numChunks = STATE_SPACE_NUM_LANES;
+		}
+		else {
+			numChunks = (remaining + chunkLength - 1)/chunkLength;
+			for (uint c = 0; c < numChunks; ++c){
+				uint length = std::min(chunkLength, remaining - c*chunkLength);
+				processChunkFromZeroState(u + position + c*chunkLength, y + position + c*chunkLength, length, chunkEndStates[c]);
+			}
+		}
+		//...then the scan, which adds the response to each chunk's starting state and carries the state on
+		for (uint c = 0; c < numChunks; ++c){
+			Real* yChunk = y + position + c*chunkLength;
+			uint length = std::min(chunkLength, remaining - c*chunkLength);
+			uint k = 0;
+#ifdef __SSE2__
+			__m128d x0 = _mm_set1_pd(x[0]);
+			__m128d x1 = _mm_set1_pd(x[1]);
+			__m128d x2 = _mm_set1_pd(x[2]);
+			__m128d x3 = _mm_set1_pd(x[3]);
+			for (; k + 2 <= length; k += 2){
+				__m128d sum = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(&CPowersOfA[0][k]), x0), _mm_mul_pd(_mm_loadu_pd(&CPowersOfA[1][k]), x1));
+				sum = _mm_add_pd(sum, _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(&CPowersOfA[2][k]), x2), _mm_mul_pd(_mm_loadu_pd(&CPowersOfA[3][k]), x3)));
+				_mm_storeu_pd(yChunk + k, _mm_add_pd(_mm_loadu_pd(yChunk + k), sum));
+			}
+#endif
+			for (; k < length; ++k){
+				yChunk[k] += CPowersOfA[0][k]*x[0] + CPowersOfA[1][k]*x[1] + CPowersOfA[2][k]*x[2] + CPowersOfA[3][k]*x[3];
+			}
+			Real xNext[STATE_SPACE_ORDER];
+			for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+				xNext[i] = chunkEndStates[c][i];
+				for (uint j = 0; j < STATE_SPACE_ORDER; ++j){
+					xNext[i] += powersOfA[length][i][j]*x[j];
+				}
+			}
+			for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+				x[i] = xNext[i];
+			}
+		}
+		position += std::min(numChunks*chunkLength, remaining);
+	}
+}
+
+void StateSpaceFilter::processChunksFromZeroState(const Real* u, Real* y, Real (*chunkEndStates)[STATE_SPACE_ORDER]){
+	const uint chunkLength = STATE_SPACE_CHUNK_LENGTH;
+#ifdef __SSE2__
+	//Chunks 0 and 1 in one register, 2 and 3 in the other
+	__m128d a[STATE_SPACE_ORDER][STATE_SPACE_ORDER];
+	__m128d b[STATE_SPACE_ORDER];
+	__m128d c[STATE_SPACE_ORDER];
+	__m128d z01[STATE_SPACE_ORDER];
+	__m128d z23[STATE_SPACE_ORDER];
+	for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+		for (uint j = 0; j < STATE_SPACE_ORDER; ++j){
+			a[i][j] = _mm_set1_pd(A[i][j]);
+		}
+		b[i] = _mm_set1_pd(B[i]);
+		c[i] = _mm_set1_pd(C[i]);
+		z01[i] = _mm_setzero_pd();
+		z23[i] = _mm_setzero_pd();
+	}
+	__m128d d = _mm_set1_pd(D);
+	for (uint k = 0; k < chunkLength; ++k){
+		__m128d u01 = _mm_set_pd(u[chunkLength + k], u[k]);
+		__m128d u23 = _mm_set_pd(u[3*chunkLength + k], u[2*chunkLength + k]);
+		__m128d y01 = _mm_mul_pd(d, u01);
+		__m128d y23 = _mm_mul_pd(d, u23);
+		__m128d next01[STATE_SPACE_ORDER];
+		__m128d next23[STATE_SPACE_ORDER];
+		for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+			y01 = _mm_add_pd(y01, _mm_mul_pd(c[i], z01[i]));
+			y23 = _mm_add_pd(y23, _mm_mul_pd(c[i], z23[i]));
+			next01[i] = _mm_mul_pd(b[i], u01);
+			next23[i] = _mm_mul_pd(b[i], u23);
+			for (uint j = 0; j < STATE_SPACE_ORDER; ++j){
+				next01[i] = _mm_add_pd(next01[i], _mm_mul_pd(a[i][j], z01[j]));
+				next23[i] = _mm_add_pd(next23[i], _mm_mul_pd(a[i][j], z23[j]));
+			}
+		}
+		for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+			z01[i] = next01[i];
+			z23[i] = next23[i];
+		}
+		_mm_storel_pd(y + k, y01);
+		_mm_storeh_pd(y + chunkLength + k, y01);
+		_mm_storel_pd(y + 2*chunkLength + k, y23);
+		_mm_storeh_pd(y + 3*chunkLength + k, y23);
+	}
+	for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+		_mm_storel_pd(&chunkEndStates[0][i], z01[i]);
+		_mm_storeh_pd(&chunkEndStates[1][i], z01[i]);
+		_mm_storel_pd(&chunkEndStates[2][i], z23[i]);
+		_mm_storeh_pd(&chunkEndStates[3][i], z23[i]);
+	}
+#else
+	for (uint lane = 0; lane < STATE_SPACE_NUM_LANES; ++lane){
+		processChunkFromZeroState(u + lane*chunkLength, y + lane*chunkLength, chunkLength, chunkEndStates[lane]);
+	}
+#endif
+}
+
+void StateSpaceFilter::processChunkFromZeroState(const Real* u, Real* y, uint length, Real* chunkEndState){
+	Real z[STATE_SPACE_ORDER];
+	for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+		z[i] = 0.0;
+	}
+	for (uint k = 0; k < length; ++k){
+		Real uk = u[k];
+		Real yk = D*uk;
+		Real next[STATE_SPACE_ORDER];
+		for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+			yk += C[i]*z[i];
+			next[i] = B[i]*uk;
+			for (uint j = 0; j < STATE_SPACE_ORDER; ++j){
+				next[i] += A[i][j]*z[j];
+			}
+		}
+		for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+			z[i] = next[i];
+		}
+		y[k] = yk;
+	}
+	for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+		chunkEndState[i] = z[i];
+	}
+}
+
+vector<Real> StateSpaceFilter::getState() const {
+	return vector<Real>(x, x + STATE_SPACE_ORDER);
+}
+
+void StateSpaceFilter::setState(const vector<Real>& state){
+	Assert(state.size() <= STATE_SPACE_ORDER);
+	for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+		x[i] = i < state.size() ? state[i] : 0.0;
+	}
+}
@@ -0,0 +1,139 @@
+/************************************************************************************
+* 
+* Wavechild670 v0.1 
+* 
+* statespace.h
+* 
+* By Peter Raffensperger 11 March 2014
+* 
+* Reference:
+* Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+* Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+* York, UK, September 17-21, 2012.
+* 
+* Note:
+* Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+* affiliated with the author.
+* 
+* License:
+* Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+* software in an academic context, we would appreciate it if you referenced the original
+* paper.
+* 
+************************************************************************************/
+
+
+
+#ifndef STATESPACE_H
+#define STATESPACE_H
+
+#include "Misc.h"
+
+#define STATE_SPACE_ORDER 4 //Circuits with fewer states are padded with zero states
+#define STATE_SPACE_CHUNK_LENGTH 32 //Samples per chunk in process()
+#define STATE_SPACE_NUM_LANES 4 //Chunks filtered together in process()
+
+/*
+A linear, time-invariant circuit as the state-space system
+	x[n+1] = A x[n] + B u[n]
+	y[n]   = C x[n] + D u[n]
+where x is the circuit's state (its reactive elements' incident waves), u its input and y its output.
+fromCircuit() derives A, B, C and D by running a copy of the WDF one sample from each unit state and
+from a unit input, so the realisation matches the WDF to rounding and follows the generated code
+without any hand derivation.
+
+process() filters a block without the sample to sample dependency of the WDF. The block is cut into
+chunks of STATE_SPACE_CHUNK_LENGTH samples, and the response of each chunk from a zero state is
+computed STATE_SPACE_NUM_LANES chunks at a time, two lanes to an SSE2 register. A scan over the
+chunks then carries the true state from one chunk to the next through A^L, and adds each chunk's
+response to its starting state, C A^k x, which needs no recursion either.
+*/
+
+class StateSpaceFilter {
+public:
+	StateSpaceFilter();
+
+	template <class LinearCircuit>
+	static StateSpaceFilter fromCircuit(const LinearCircuit& circuit){
+		StateSpaceFilter filter;
+		LinearCircuit probe(circuit);
+		vector<Real> initialState = probe.getState();
+		uint numStates = initialState.size();
+		Assert(numStates <= STATE_SPACE_ORDER);
+		vector<Real> unitState(numStates, 0.0);
+		for (uint j = 0; j < numStates; ++j){
+			unitState.assign(numStates, 0.0);
+			unitState[j] = 1.0;
+			probe.setState(unitState);
+			filter.C[j] = probe.advance(0.0);
+			vector<Real> column = probe.getState();
+			for (uint i = 0; i < numStates; ++i){
+				filter.A[i][j] = column[i];
+			}
+		}
+		unitState.assign(numStates, 0.0);
+		probe.setState(unitState);
+		filter.D = probe.advance(1.0);
+		vector<Real> column = probe.getState();
+		for (uint i = 0; i < numStates; ++i){
+			filter.B[i] = column[i];
+			filter.x[i] = initialState[i];
+		}
+		filter.precomputePowers();
+		return filter;
+	}
+
+	Real advance(Real u){
+		Real y = D*u;
+		Real xNext[STATE_SPACE_ORDER];
+		for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+			y += C[i]*x[i];
+			xNext[i] = B[i]*u;
+			for (uint j = 0; j < STATE_SPACE_ORDER; ++j){
+				xNext[i] += A[i][j]*x[j];
+			}
+		}
+		for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+			x[i] = xNext[i];
+		}
+		return y;
+	}
+	void process(const Real* u, Real* y, uint numSamples); //u and y may be the same buffer
+
+	vector<Real> getState() const;
+	void setState(const vector<Real>& state);
+	
+	//The realisation, for running many filters with the same coefficients side by side (see Wavechild670Batch)
+	Real getA(uint i, uint j) const { return A[i][j]; }
+	Real getB(uint i) const { return B[i]; }
+	Real getC(uint i) const { return C[i]; }
+	Real getD() const { return D; }
+	struct State {
+		Real x[STATE_SPACE_ORDER];
+	};
+	void saveState(State& state) const {
+		for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+			state.x[i] = x[i];
+		}
+	}
+	void loadState(const State& state){
+		for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+			x[i] = state.x[i];
+		}
+	}
+
+protected:
+	void precomputePowers();
+	void processChunksFromZeroState(const Real* u, Real* y, Real (*chunkEndStates)[STATE_SPACE_ORDER]); //STATE_SPACE_NUM_LANES whole chunks
+	void processChunkFromZeroState(const Real* u, Real* y, uint length, Real* chunkEndState);
+
+	Real A[STATE_SPACE_ORDER][STATE_SPACE_ORDER];
+	Real B[STATE_SPACE_ORDER];
+	Real C[STATE_SPACE_ORDER];
+	Real D;
+	Real x[STATE_SPACE_ORDER];
+	Real powersOfA[STATE_SPACE_CHUNK_LENGTH + 1][STATE_SPACE_ORDER][STATE_SPACE_ORDER]; //A^k
+	Real CPowersOfA[STATE_SPACE_ORDER][STATE_SPACE_CHUNK_LENGTH]; //Element i of C A^k, by i then k so that k is contiguous
+};
+
+#endif
@@ -0,0 +1,278 @@
+/************************************************************************************
+* 
+* Wavechild670 v0.1 
+* 
+* tracewriter.cpp
+* 
+* By Peter Raffensperger 11 March 2014
+* 
+* Reference:
+* Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+* Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+* York, UK, September 17-21, 2012.
+* 
+* Note:
+* Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+* affiliated with the author.
+* 
+* License:
+* Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+* software in an academic context, we would appreciate it if you referenced the original
+* paper.
+* 
+************************************************************************************/
+
+
+
+
+#include "tracewriter.h"
+#include <unistd.h>
+#include <string.h>
+
+#define TRACE_IDLE_SLEEP_MICROSECONDS 1000
+
+TraceWriter::TraceWriter() : file(0), ring(0), ringMask(0), ringHead(0), ringTail(0), stopRequested(false), 
+numReserved(0), numDropped(0), numWritten(0) {
+	pthread_mutex_init(&definitionsMutex, NULL);
+}
+
+TraceWriter::~TraceWriter(){
+	close();
+	pthread_mutex_destroy(&definitionsMutex);
+}
+
+bool TraceWriter::open(const string& filename, Real sampleRate, uint ringLength){
+	Assert(!isOpen());
+	Assert(ringLength > 1 && (ringLength & (ringLength - 1)) == 0);
+	Assert(sizeof(uint) == 4);
+	file = fopen(filename.c_str(), "wb");
+	if (!file){
+		LOG_ERROR("Couldn't open trace file " << filename);
+		return false;
+	}
+	fwrite(TRACE_MAGIC, 1, 8, file);
+	writeUint(TRACE_VERSION);
+	fwrite(&sampleRate, sizeof(Real), 1, file);
+	
+	ring = new TraceSample[ringLength];
+	ringMask = ringLength - 1;
+	ringHead = 0;
+	ringTail = 0;
+	stopRequested = false;
+	numReserved = 0;
+	numDropped = 0;
+	numWritten = 0;
+	if (pthread_create(&consumerThread, NULL, consumerThreadEntry, this) != 0){
+		LOG_ERROR("Couldn't start the trace writer thread");
+		fclose(file);
+		file = 0;
+		delete[] ring;
+		ring = 0;
+		return false;
+	}
+	return true;
+}
+
+void TraceWriter::close(){
+	if (!isOpen()){
+		return;
+	}
+	stopRequested = true;
+	pthread_join(consumerThread, NULL);
+	drain(); //Anything pushed after the consumer's last look
+	for (uint column = 0; column < columnBuffers.size(); ++column){
+		if (column < columnGaps.size() && columnGaps[column] > 0){
+			writeGap(column, columnGaps[column]);
+		}
+		flushColumn(column);
+	}
+	fclose(file);
+	file = 0;
+	delete[] ring;
+	ring = 0;
+	pendingDefinitions.clear();
+	columnGaps.clear();
+	columnBuffers.clear();
+}
+
+void TraceWriter::defineColumn(uint column, const string& name, uint numChannels){
+	ColumnDefinition definition;
+	definition.column = column;
+	definition.numChannels = numChannels;
+	definition.name = name;
+	Assert(column < TRACE_GAP_FLAG);
+	if (column >= columnGaps.size()){
+		columnGaps.resize(column + 1, 0);
+	}
+	pthread_mutex_lock(&definitionsMutex);
+	pendingDefinitions.push_back(definition);
+	pthread_mutex_unlock(&definitionsMutex);
+}
+
+void* TraceWriter::consumerThreadEntry(void* traceWriter){
+	((TraceWriter*) traceWriter)->consumerLoop();
+	return NULL;
+}
+
+void TraceWriter::consumerLoop(){
+	while (!stopRequested){
+		if (!drain()){
+			usleep(TRACE_IDLE_SLEEP_MICROSECONDS);
+		}
+	}
+}
+
+bool TraceWriter::drain(){
+	//Take the head before the definitions: every column pushed before this head was defined before it
+	uint head = ringHead;
+	__sync_synchronize();
+	vector<ColumnDefinition> definitions;
+	pthread_mutex_lock(&definitionsMutex);
+	definitions.swap(pendingDefinitions);
+	pthread_mutex_unlock(&definitionsMutex);
+	for (uint i = 0; i < definitions.size(); ++i){
+		writeDefinition(definitions[i]);
+	}
+	
+	uint tail = ringTail;
+	if (tail == head){
+		return !definitions.empty();
+	}
+	while (tail != head){
+		const TraceSample& sample = ring[tail];
+		tail = (tail + 1) & ringMask;
+		if (sample.column & TRACE_GAP_FLAG){
+			writeGap(sample.column & ~TRACE_GAP_FLAG, (ulong) sample.value);
+			continue;
+		}
+		Assert(sample.column < columnBuffers.size());
+		vector<Real>& buffer = columnBuffers[sample.column];
+		buffer.push_back(sample.value);
+		if (buffer.size() >= TRACE_CHUNK_LENGTH){
+			flushColumn(sample.column);
+		}
+	}
+	__sync_synchronize(); //Finished with the records before the producer can reuse their slots
+	ringTail = tail;
+	return true;
+}
+
+void TraceWriter::writeDefinition(const ColumnDefinition& definition){
+	if (definition.column >= columnBuffers.size()){
+		columnBuffers.resize(definition.column + 1);
+	}
+	flushColumn(definition.column); //A redefinition applies to the samples after it
+	columnBuffers[definition.column].reserve(TRACE_CHUNK_LENGTH);
+	writeUint(TRACE_RECORD_DEFINE);
+	writeUint(definition.column);
+	writeUint(definition.numChannels);
+	writeUint(definition.name.size());
+	fwrite(definition.name.data(), 1, definition.name.size(), file);
+}
+
+void TraceWriter::writeGap(uint column, ulong numSamples){
+	flushColumn(column); //The samples before the gap
+	writeUint(TRACE_RECORD_GAP);
+	writeUint(column);
+	writeUint(numSamples);
+}
+
+void TraceWriter::flushColumn(uint column){
+	vector<Real>& buffer = columnBuffers[column];
+	if (buffer.empty()){
+		return;
+	}
+	writeUint(TRACE_RECORD_DATA);
+	writeUint(column);
+	writeUint(buffer.size());
+	fwrite(&buffer[0], sizeof(Real), buffer.size(), file);
+	numWritten += buffer.size();
+	buffer.clear();
+}
+
+void TraceWriter::writeUint(uint x){
+	fwrite(&x, sizeof(uint), 1, file);
+}
+
+static bool ReadUint(FILE* file, uint& x){
+	return fread(&x, sizeof(uint), 1, file) == 1;
+}
+
+bool LoadTrace(const string& filename, vector<TraceColumn>& columns, Real& sampleRate){
+	//Reads a whole trace back, the defined columns in the order of their indices
+	columns.clear();
+	FILE *file = fopen(filename.c_str(), "rb");
+	if (!file){
+		LOG_ERROR("Couldn't open trace file " << filename);
+		return false;
+	}
+	char magic[8];
+	uint version;
+	if (fread(magic, 1, 8, file) != 8 || strncmp(magic, TRACE_MAGIC, 8) != 0 || !ReadUint(file, version) || 
+		version != TRACE_VERSION || fread(&sampleRate, sizeof(Real), 1, file) != 1){
+		LOG_ERROR(filename << " isn't a version " << TRACE_VERSION << " trace file");
+		fclose(file);
+		return false;
+	}
+	bool ok = true;
+	vector<bool> defined;
+	uint type;
+	while (ok && ReadUint(file, type)){
+		uint column;
+		ok = ReadUint(file, column);
+		if (ok && type == TRACE_RECORD_DEFINE){
+			uint numChannels, nameLength;
+			ok = ReadUint(file, numChannels) && ReadUint(file, nameLength);
+			string name(nameLength, ' ');
+			ok = ok && (nameLength == 0 || fread(&name[0], 1, nameLength, file) == nameLength);
+			if (ok){
+				if (column >= columns.size()){
+					columns.resize(column + 1);
+					defined.resize(column + 1, false);
+				}
+				defined[column] = true;
+				columns[column].name = name;
+				columns[column].numChannels = numChannels;
+			}
+		}
+		else if (ok && type == TRACE_RECORD_DATA){
+			uint count;
+			ok = ReadUint(file, count) && column < columns.size() && defined[column];
+			if (ok){
+				vector<Real>& samples = columns[column].samples;
+				uint start = samples.size();
+				samples.resize(start + count);
+				ok = count == 0 || fread(&samples[start], sizeof(Real), count, file) == count;
+			}
+		}
+		else if (ok && type == TRACE_RECORD_GAP){
+			uint count;
+			ok = ReadUint(file, count) && column < columns.size() && defined[column];
+			if (ok){
+				vector<Real>& samples = columns[column].samples;
+				samples.resize(samples.size() + count, NAN);
+			}
+		}
+		else {
+			ok = false;
+		}
+	}
+	fclose(file);
+	if (!ok){
+		LOG_ERROR(filename << " is truncated or corrupt");
+	}
+	//Indices without a definition, such as the handles of probes that never traced, aren't columns
+	uint numDefined = 0;
+	for (uint column = 0; column < columns.size(); ++column){
+		if (defined[column]){
+			if (numDefined != column){
+				columns[numDefined].name.swap(columns[column].name);
+				columns[numDefined].numChannels = columns[column].numChannels;
+				columns[numDefined].samples.swap(columns[column].samples);
+			}
+			numDefined++;
+		}
+	}
+	columns.resize(numDefined);
+	return ok;
+}
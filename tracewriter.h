@@ -0,0 +1,159 @@
+/************************************************************************************
+* 
+* Wavechild670 v0.1 
+* 
+* tracewriter.h
+* 
+* By Peter Raffensperger 11 March 2014
+* 
+* Reference:
+* Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+* Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+* York, UK, September 17-21, 2012.
+* 
+* Note:
+* Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+* affiliated with the author.
+* 
+* License:
+* Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+* software in an academic context, we would appreciate it if you referenced the original
+* paper.
+* 
+************************************************************************************/
+
+
+
+#ifndef TRACEWRITER_H
+#define TRACEWRITER_H
+
+#include "Misc.h"
+#include <stdio.h>
+#include <pthread.h>
+
+#define TRACE_DEFAULT_RING_LENGTH 65536 //Records, a power of two
+#define TRACE_CHUNK_LENGTH 4096 //Samples per column written in each data record
+
+#define TRACE_MAGIC "WC670TRC"
+#define TRACE_VERSION 1
+#define TRACE_RECORD_DEFINE 1
+#define TRACE_RECORD_DATA 2
+#define TRACE_RECORD_GAP 3
+#define TRACE_GAP_FLAG 0x80000000 //Marks a gap in the ring's column field
+
+/*
+Streams probe samples to a binary trace file without holding up the audio thread. The audio thread 
+push()es (column, value) records into a single producer, single consumer ring, which never blocks 
+or allocates: when the ring is full the samples are dropped, counted and later marked with a gap. A background thread drains 
+the ring, gathers each column's samples and writes them out in chunks.
+
+The file, in the machine's byte order, is the header
+	char[8] TRACE_MAGIC, uint32 TRACE_VERSION, float64 sampleRate
+followed by records, each starting with a uint32 type:
+	TRACE_RECORD_DEFINE: uint32 column, uint32 numChannels, uint32 nameLength, char[nameLength] name
+	TRACE_RECORD_DATA: uint32 column, uint32 count, float64[count] samples
+	TRACE_RECORD_GAP: uint32 column, uint32 count, the number of samples dropped at this point
+A column is always defined before its first data record. The samples of a column with several 
+channels are interleaved. LoadTrace() below and loadtrace.py read it back, with gaps filled by NaNs.
+*/
+
+struct TraceSample {
+	uint column;
+	Real value;
+};
+
+class TraceWriter {
+public:
+	TraceWriter();
+	virtual ~TraceWriter();
+	
+	bool open(const string& filename, Real sampleRate, uint ringLength=TRACE_DEFAULT_RING_LENGTH);
+	void close(); //Writes out everything pushed so far
+	bool isOpen() const { return file != 0; }
+	
+	void defineColumn(uint column, const string& name, uint numChannels); //From the producer's thread, before the column's first push()
+	
+	bool reserve(uint column, uint numValues){
+		/*
+		Producer side, before push()ing numValues samples of column, such as one frame of a probe 
+		with several channels. Returns false, and counts the samples as dropped, if the ring hasn't 
+		room for them all, so that a frame is written whole or not at all. The first samples kept 
+		after a drop are preceded by a gap record, so the reader can keep the column in time. 
+		Frames of different columns may be reserved and pushed interleaved.
+		*/
+		ulong& gap = columnGaps[column];
+		uint numFree = (ringTail - ringHead - 1) & ringMask;
+		if (numFree < numReserved + numValues + (gap > 0 ? 1 : 0)){
+			gap += numValues;
+			numDropped += numValues;
+			return false;
+		}
+		if (gap > 0){
+			pushRecord(column | TRACE_GAP_FLAG, (Real) gap);
+			gap = 0;
+		}
+		numReserved += numValues;
+		return true;
+	}
+	
+	void push(uint column, Real value){
+		//Producer side, into space from reserve()
+		Assert(numReserved > 0);
+		numReserved--;
+		pushRecord(column, value);
+	}
+	
+	ulong getNumDropped() const { return numDropped; }
+	ulong getNumWritten() const { return numWritten; }
+	
+protected:
+	struct ColumnDefinition {
+		uint column;
+		uint numChannels;
+		string name;
+	};
+	
+	void pushRecord(uint column, Real value){
+		uint head = ringHead;
+		Assert(((head + 1) & ringMask) != ringTail);
+		ring[head].column = column;
+		ring[head].value = value;
+		__sync_synchronize(); //The record is in the ring before the consumer can see it
+		ringHead = (head + 1) & ringMask;
+	}
+	
+	static void* consumerThreadEntry(void* traceWriter);
+	void consumerLoop();
+	bool drain(); //Returns true if there was anything to drain
+	void writeDefinition(const ColumnDefinition& definition);
+	void writeGap(uint column, ulong numSamples);
+	void flushColumn(uint column);
+	void writeUint(uint x);
+	
+	FILE *file;
+	TraceSample *ring;
+	uint ringMask;
+	volatile uint ringHead; //Written only by the producer
+	volatile uint ringTail; //Written only by the consumer
+	volatile bool stopRequested;
+	uint numReserved; //Producer only, slots reserved but not yet pushed
+	ulong numDropped;
+	ulong numWritten;
+	
+	pthread_t consumerThread;
+	pthread_mutex_t definitionsMutex;
+	vector<ColumnDefinition> pendingDefinitions; //Guarded by definitionsMutex
+	vector<ulong> columnGaps; //Producer only, samples dropped since the column's last push()
+	vector<vector<Real> > columnBuffers; //Consumer only
+};
+
+struct TraceColumn {
+	TraceColumn() : numChannels(1) { }
+	string name;
+	uint numChannels;
+	vector<Real> samples; //Interleaved
+};
+
+bool LoadTrace(const string& filename, vector<TraceColumn>& columns, Real& sampleRate);
+
+#endif
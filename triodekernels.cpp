@@ -0,0 +1,133 @@
+/************************************************************************************
+* 
+* Wavechild670 v0.1 
+* 
+* triodekernels.cpp
+* 
+* By Peter Raffensperger 11 March 2014
+* 
+* Reference:
+* Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+* Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+* York, UK, September 17-21, 2012.
+* 
+* Note:
+* Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+* affiliated with the author.
+* 
+* License:
+* Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+* software in an academic context, we would appreciate it if you referenced the original
+* paper.
+* 
+************************************************************************************/
+
+
+
+#include "triodekernels.h"
+#include "vectormath.h"
+
+namespace TriodeKernels {
+
+static void evaluateRemoteCutoffScalar(const RemoteCutoffTriodeParameters& parameters, const Real* Vgk, const Real* Vak, Real* Ia, Real* dIadVak, uint n){
+	VectorTriodeRemoteCutoff<ScalarOps>::evaluate(parameters, Vgk, Vak, Ia, dIadVak, n);
+}
+
+#ifdef __SSE2__
+static void evaluateRemoteCutoffSSE2(const RemoteCutoffTriodeParameters& parameters, const Real* Vgk, const Real* Vak, Real* Ia, Real* dIadVak, uint n){
+	VectorTriodeRemoteCutoff<SSE2Ops>::evaluate(parameters, Vgk, Vak, Ia, dIadVak, n);
+}
+#endif
+
+static RemoteCutoffKernel getRemoteCutoffKernel(InstructionSet instructionSet){
+	switch (instructionSet) {
+	case INSTRUCTION_SET_SCALAR:
+		return evaluateRemoteCutoffScalar;
+#ifdef __SSE2__
+	case INSTRUCTION_SET_SSE2:
+		return evaluateRemoteCutoffSSE2;
+#endif
+	case INSTRUCTION_SET_AVX2:
+		return getRemoteCutoffKernelAVX2();
+	case INSTRUCTION_SET_AVX512:
+		return getRemoteCutoffKernelAVX512();
+	default:
+		return NULL;
+	}
+}
+
+static bool isSupportedByCPU(InstructionSet instructionSet){
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 8)) && (defined(__x86_64__) || defined(__i386__))
+	__builtin_cpu_init();
+	switch (instructionSet) {
+	case INSTRUCTION_SET_SSE2:
+		return __builtin_cpu_supports("sse2");
+	case INSTRUCTION_SET_AVX2:
+		return __builtin_cpu_supports("avx2");
+	case INSTRUCTION_SET_AVX512:
+		return __builtin_cpu_supports("avx512f");
+	default:
+		return true;
+	}
+#else
+	//No way of asking, so only trust what the whole program was compiled for
+	return instructionSet == INSTRUCTION_SET_SCALAR || instructionSet == INSTRUCTION_SET_SSE2;
+#endif
+}
+
+bool isSupported(InstructionSet instructionSet){
+	return getRemoteCutoffKernel(instructionSet) != NULL && isSupportedByCPU(instructionSet);
+}
+
+InstructionSet getBestInstructionSet(){
+	for (int instructionSet = NUM_INSTRUCTION_SETS - 1; instructionSet > INSTRUCTION_SET_SCALAR; --instructionSet){
+		if (isSupported((InstructionSet) instructionSet)) {
+			return (InstructionSet) instructionSet;
+		}
+	}
+	return INSTRUCTION_SET_SCALAR;
+}
+
+static InstructionSet currentInstructionSet = INSTRUCTION_SET_SCALAR;
+static RemoteCutoffKernel currentRemoteCutoffKernel = NULL; //Chosen on first use
+
+InstructionSet getInstructionSet(){
+	if (!currentRemoteCutoffKernel) {
+		setInstructionSet(getBestInstructionSet());
+	}
+	return currentInstructionSet;
+}
+
+void setInstructionSet(InstructionSet instructionSet){
+	if (!isSupported(instructionSet)) {
+		LOG_WARNING("Instruction set " << getInstructionSetName(instructionSet) << " isn't supported, using " << getInstructionSetName(getBestInstructionSet()));
+		instructionSet = getBestInstructionSet();
+	}
+	currentInstructionSet = instructionSet;
+	currentRemoteCutoffKernel = getRemoteCutoffKernel(instructionSet);
+	LOG_INFO("Tube kernels using " << getInstructionSetName(instructionSet));
+}
+
+const char* getInstructionSetName(InstructionSet instructionSet){
+	switch (instructionSet) {
+	case INSTRUCTION_SET_SCALAR:
+		return "scalar";
+	case INSTRUCTION_SET_SSE2:
+		return "SSE2";
+	case INSTRUCTION_SET_AVX2:
+		return "AVX2";
+	case INSTRUCTION_SET_AVX512:
+		return "AVX-512";
+	default:
+		return "unknown";
+	}
+}
+
+void evaluateRemoteCutoff(const RemoteCutoffTriodeParameters& parameters, const Real* Vgk, const Real* Vak, Real* Ia, Real* dIadVak, uint n){
+	if (!currentRemoteCutoffKernel) {
+		setInstructionSet(getBestInstructionSet());
+	}
+	currentRemoteCutoffKernel(parameters, Vgk, Vak, Ia, dIadVak, n);
+}
+
+}
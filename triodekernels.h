@@ -0,0 +1,77 @@
+/************************************************************************************
+* 
+* Wavechild670 v0.1 
+* 
+* triodekernels.h
+* 
+* By Peter Raffensperger 11 March 2014
+* 
+* Reference:
+* Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+* Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+* York, UK, September 17-21, 2012.
+* 
+* Note:
+* Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+* affiliated with the author.
+* 
+* License:
+* Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+* software in an academic context, we would appreciate it if you referenced the original
+* paper.
+* 
+************************************************************************************/
+
+
+
+#ifndef TRIODEKERNELS_H
+#define TRIODEKERNELS_H
+
+#include "Misc.h"
+
+/*
+Batched evaluation of the tube models, vectorised for whatever instruction set the CPU supports.
+The kernels for each instruction set are built in their own translation unit with the matching
+compiler flags and the best one the CPU supports is picked the first time they are used.
+*/
+
+struct RemoteCutoffTriodeParameters {
+	//Ia = p1*Vak^p2 / ((p3 - p4*Vgk)^p5 * (p6 + exp(p7*Vak - p8*Vgk)))
+	Real p1;
+	Real p2;
+	Real p3;
+	Real p4;
+	Real p5;
+	Real p6;
+	Real p7;
+	Real p8;
+};
+
+namespace TriodeKernels {
+
+enum InstructionSet {
+	INSTRUCTION_SET_SCALAR = 0,
+	INSTRUCTION_SET_SSE2,
+	INSTRUCTION_SET_AVX2,
+	INSTRUCTION_SET_AVX512,
+	NUM_INSTRUCTION_SETS
+};
+
+typedef void (*RemoteCutoffKernel)(const RemoteCutoffTriodeParameters& parameters, const Real* Vgk, const Real* Vak, Real* Ia, Real* dIadVak, uint n);
+
+bool isSupported(InstructionSet instructionSet); //Compiled in and supported by this CPU
+InstructionSet getBestInstructionSet();
+InstructionSet getInstructionSet();
+void setInstructionSet(InstructionSet instructionSet); //Overrides the best instruction set, for testing and benchmarks
+const char* getInstructionSetName(InstructionSet instructionSet);
+
+//Sets Ia[i] and dIadVak[i] for each operating point (Vgk[i], Vak[i]), dIadVak may be NULL
+void evaluateRemoteCutoff(const RemoteCutoffTriodeParameters& parameters, const Real* Vgk, const Real* Vak, Real* Ia, Real* dIadVak, uint n);
+
+//Defined in the translation units built for each instruction set, NULL when the compiler couldn't target it
+RemoteCutoffKernel getRemoteCutoffKernelAVX2();
+RemoteCutoffKernel getRemoteCutoffKernelAVX512();
+
+}
+
+#endif
@@ -0,0 +1,51 @@
+/************************************************************************************
+* 
+* Wavechild670 v0.1 
+* 
+* triodekernelsavx2.cpp
+* 
+* By Peter Raffensperger 11 March 2014
+* 
+* Reference:
+* Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+* Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+* York, UK, September 17-21, 2012.
+* 
+* Note:
+* Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+* affiliated with the author.
+* 
+* License:
+* Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+* software in an academic context, we would appreciate it if you referenced the original
+* paper.
+* 
+************************************************************************************/
+
+
+
+/*
+Built with -mavx2, see the Makefile. Nothing in here runs unless TriodeKernels has checked
+that the CPU supports it.
+*/
+
+#include "triodekernels.h"
+#include "vectormath.h"
+
+namespace TriodeKernels {
+
+#ifdef __AVX2__
+static void evaluateRemoteCutoffAVX2(const RemoteCutoffTriodeParameters& parameters, const Real* Vgk, const Real* Vak, Real* Ia, Real* dIadVak, uint n){
+	VectorTriodeRemoteCutoff<AVX2Ops>::evaluate(parameters, Vgk, Vak, Ia, dIadVak, n);
+}
+
+RemoteCutoffKernel getRemoteCutoffKernelAVX2(){
+	return evaluateRemoteCutoffAVX2;
+}
+#else
+RemoteCutoffKernel getRemoteCutoffKernelAVX2(){
+	return NULL;
+}
+#endif
+
+}
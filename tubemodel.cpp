@@ -26,6 +26,16 @@
 
 #include "tubemodel.h"
 
+const Real TriodeRemoteCutoff6386::p1 = 3.981e-8;
+const Real TriodeRemoteCutoff6386::p2 = 2.383;
+const Real TriodeRemoteCutoff6386::p3 = 0.5;
+const Real TriodeRemoteCutoff6386::p4 = 0.1;
+const Real TriodeRemoteCutoff6386::p5 = 1.8;
+const Real TriodeRemoteCutoff6386::p6 = 0.5;
+const Real TriodeRemoteCutoff6386::p7 = -0.03922;
+const Real TriodeRemoteCutoff6386::p8 = 0.2;
+const RemoteCutoffTriodeParameters TriodeRemoteCutoff6386::kernelParameters = {p1, p2, p3, p4, p5, p6, p7, p8};
+
 const Real TriodeRemoteCutoff6386::fa = -0.1961135820501605;
 const Real TriodeRemoteCutoff6386::aa = 3.980508168e-08;
 const Real TriodeRemoteCutoff6386::ab = 2.3830020303;
@@ -35,7 +45,84 @@ const Real TriodeRemoteCutoff6386::c = 10.0;
 const Real TriodeRemoteCutoff6386::g = 5.0;
 const Real TriodeRemoteCutoff6386::h = 0.5;	
 
-Real WDFTubeInterface::iterateNewtonRaphson(Real x, Real dx){
+void WDFTubeInterface::buildSolutionTable(Real r0_){
+	/*
+	With the port resistance fixed, the reflected wave only depends on the incident wave and the 
+	grid voltage, so b(Vgk, a) can be solved for ahead of time and interpolated. The nodes and the 
+	error check are solved with the analytic derivative to TUBE_SOLUTION_TABLE_SOLVER_TOLERANCE 
+	rather than with the per sample solver's settings, which may trade accuracy for speed and 
+	would then be built into the table and hidden from its error check.
+	*/
+	Assert(model);
+	Assert(r0_ > 0.0);
+	Real aSaved = a;
+	Real VgkSaved = Vgk;
+	Real IakSaved = Iak;
+	Real VakGuessSaved = VakGuess;
+	TubeSolverStatistics statisticsSaved = statistics;
+	bool useAnalyticDerivativeSaved = useAnalyticDerivative;
+	Real toleranceSaved = tolerance;
+	uint maxIterationsSaved = maxIterations;
+	useAnalyticDerivative = true;
+	tolerance = TUBE_SOLUTION_TABLE_SOLVER_TOLERANCE;
+	maxIterations = TUBE_SOLUTION_TABLE_SOLVER_MAX_ITERATIONS;
+	statistics.reset();
+	
+	r0 = r0_;
+	solutionTableR0 = r0_;
+	solutionTable.setup(solutionTableResolution, solutionTableResolution, TRIODE_TABLE_DEFAULT_VGK_MIN, TRIODE_TABLE_DEFAULT_VGK_MAX, 
+		TUBE_SOLUTION_TABLE_DEFAULT_A_MIN, TUBE_SOLUTION_TABLE_DEFAULT_A_MAX);
+	for (uint i = 0; i < solutionTable.getNumXPoints(); ++i) {
+		Vgk = solutionTable.getNodeX(i);
+		for (uint j = 0; j < solutionTable.getNumYPoints(); ++j) {
+			a = solutionTable.getNodeY(j);
+			Real Vak = solveForVak();
+			solutionTable.setNode(i, j, Vak - r0*Iak);
+		}
+	}
+	solutionTable.extrapolateEdges();
+	
+	//The interpolation error is largest between the nodes, so check the middle of every cell and edge
+	solutionTableMaxError = 0.0;
+	for (uint i = 0; i < 2*solutionTable.getNumXPoints() - 1; ++i) {
+		Vgk = 0.5*(solutionTable.getNodeX(i/2) + solutionTable.getNodeX((i + 1)/2));
+		for (uint j = 0; j < 2*solutionTable.getNumYPoints() - 1; ++j) {
+			if (i % 2 == 0 && j % 2 == 0) {
+				continue; //On a node
+			}
+			a = 0.5*(solutionTable.getNodeY(j/2) + solutionTable.getNodeY((j + 1)/2));
+			Real Vak = solveForVak();
+			Real err = fabs(solutionTable.interpolate(Vgk, a) - (Vak - r0*Iak));
+			solutionTableMaxError = fmax(solutionTableMaxError, err);
+		}
+	}
+	LOG_INFO("Tube solution table " << solutionTableResolution << "x" << solutionTableResolution << " r0=" << r0 << " max error=" << solutionTableMaxError << "V");
+	if (statistics.numIterationCapHits > 0) {
+		LOG_WARNING("The tube solution table has " << statistics.numIterationCapHits << " points that didn't converge");
+	}
+	
+	a = aSaved;
+	Vgk = VgkSaved;
+	Iak = IakSaved;
+	VakGuess = VakGuessSaved;
+	statistics = statisticsSaved;
+	useAnalyticDerivative = useAnalyticDerivativeSaved;
+	tolerance = toleranceSaved;
+	maxIterations = maxIterationsSaved;
+}
+
+Real WDFTubeInterface::iterateNewtonRaphson(Real x, Real& F){
+	/*
+	x(n+1) = x(n) - Fn(x)/Fn'(x)
+	
+	Fn'(x) = 1 + r0*dIa/dVak #From the model's closed form derivative
+	*/
+	Real dF;
+	F = evaluateImplicitEquation(x, dF);
+	return x - F/dF;
+}
+
+Real WDFTubeInterface::iterateNewtonRaphsonFiniteDifference(Real x, Real& F, Real dx){
 	/*
 	x(n+1) = x(n) - Fn(x)/Fn'(x)
 	
@@ -43,9 +130,112 @@ Real WDFTubeInterface::iterateNewtonRaphson(Real x, Real dx){
 
 	x(n+1) = x(n) - dx*Fn(x)/(Fn(x+dx) - Fn(x))
 	*/
-	Real F = evaluateImplicitEquation(x);
-	Real xNew = x - dx*F/(evaluateImplicitEquation(x + dx) - F);
-	Assert(isfinite(xNew));
-	return xNew;
+	F = evaluateImplicitEquation(x);
+	return x - dx*F/(evaluateImplicitEquation(x + dx) - F);
+}
+
+
+void TubeLockstepSolver::solve(){
+	TubeSolverState states[TUBE_LOCKSTEP_MAX_LANES];
+	bool inLockstep[TUBE_LOCKSTEP_MAX_LANES];
+	bool solving[TUBE_LOCKSTEP_MAX_LANES];
+	Real Vgk[TUBE_LOCKSTEP_MAX_LANES];
+	Real Vak[TUBE_LOCKSTEP_MAX_LANES];
+	Real Ia[TUBE_LOCKSTEP_MAX_LANES];
+	Real dIadVak[TUBE_LOCKSTEP_MAX_LANES];
+	TriodeModel* model = NULL;
+	uint numSolving = 0;
+	
+	for (uint lane = 0; lane < numLanes; ++lane){
+		WDFTubeInterface& tube = *tubes[lane];
+		Assert(tube.model);
+		inLockstep[lane] = false;
+		solving[lane] = false;
+		Vgk[lane] = 0.0;
+		Vak[lane] = 0.0;
+		if (!tube.useAnalyticDerivative || !tube.solutionTable.isEmpty()) {
+			b[lane] = tube.getB(a[lane], r0[lane], Vgate[lane], Vk[lane]);
+			continue;
+		}
+		tube.r0 = r0[lane];
+		tube.a = a[lane];
+		tube.Vgk = Vgate[lane] - Vk[lane];
+		tube.VakGuess = tube.predictVak();
+		tube.beginSolve(states[lane]);
+		Vgk[lane] = tube.Vgk;
+		Vak[lane] = states[lane].Vak;
+		inLockstep[lane] = true;
+		solving[lane] = true;
+		++numSolving;
+		model = tube.model;
+	}
+	
+	while (numSolving > 0){
+		model->getIaAndDerivativeBatch(Vgk, Vak, Ia, dIadVak, numLanes);
+		for (uint lane = 0; lane < numLanes; ++lane){
+			if (!solving[lane]) {
+				continue;
+			}
+			WDFTubeInterface& tube = *tubes[lane];
+			++tube.statistics.numModelEvaluations;
+			tube.Iak = Ia[lane]*tube.numParallelInstances;
+			Real F = Vak[lane] + tube.r0*tube.Iak - tube.a;
+			Real dFdVak = 1.0 + tube.r0*dIadVak[lane]*tube.numParallelInstances;
+			if (tube.stepSolve(states[lane], F, Vak[lane] - F/dFdVak)) {
+				solving[lane] = false;
+				--numSolving;
+				tube.finishSolve(states[lane]);
+				tube.recordVak(states[lane].Vak);
+				b[lane] = states[lane].Vak - tube.r0*tube.Iak;
+			}
+			Vak[lane] = states[lane].Vak;
+		}
+	}
+	for (uint lane = 0; lane < numLanes; ++lane){
+		if (inLockstep[lane]) {
+			SCOPE("VakModel", Vak[lane]);
+		}
+	}
+}
+
+TriodeTableModel::TriodeTableModel(const TriodeModel& sourceModel_, uint numVgkPoints, uint numVakPoints, Real VgkMin, Real VgkMax, Real VakMin, Real VakMax) : 
+sourceModel(sourceModel_.clone()) {
+	table.setup(numVgkPoints, numVakPoints, VgkMin, VgkMax, VakMin, VakMax);
+	buildTable();
+	measureMaxError();
+	LOG_INFO("TriodeTableModel " << numVgkPoints << "x" << numVakPoints << " max error=" << maxError << "A (" << getMaxRelativeError() << " of full scale)");
 }
 
+void TriodeTableModel::buildTable(){
+	peakIa = 0.0;
+	for (uint i = 0; i < table.getNumXPoints(); ++i) {
+		Real Vgk = table.getNodeX(i);
+		for (uint j = 0; j < table.getNumYPoints(); ++j) {
+			Real Vak = table.getNodeY(j);
+			Real Ia = sourceModel->getIa(Vgk, Vak);
+			Assert(isfinite(Ia));
+			table.setNode(i, j, Ia);
+			peakIa = fmax(peakIa, fabs(Ia));
+		}
+	}
+	table.extrapolateEdges();
+	if (peakIa <= 0.0) {
+		peakIa = 1.0;
+	}
+}
+
+void TriodeTableModel::measureMaxError(){
+	//The interpolation error is largest between the nodes, so check the middle of every cell and edge
+	maxError = 0.0;
+	for (uint i = 0; i < 2*table.getNumXPoints() - 1; ++i) {
+		Real Vgk = 0.5*(table.getNodeX(i/2) + table.getNodeX((i + 1)/2));
+		for (uint j = 0; j < 2*table.getNumYPoints() - 1; ++j) {
+			if (i % 2 == 0 && j % 2 == 0) {
+				continue; //On a node
+			}
+			Real Vak = 0.5*(table.getNodeY(j/2) + table.getNodeY((j + 1)/2));
+			Real err = fabs(getIa(Vgk, Vak) - sourceModel->getIa(Vgk, Vak));
+			maxError = fmax(maxError, err);
+		}
+	}
+}
@@ -28,11 +28,14 @@
 #define TUBEMODEL_H
 
 #include "Misc.h"
+#include "basicdsp.h"
 #include "scope.h"
+#include "triodekernels.h"
+#include "fastmath.h"
 
 class TriodeModel {
 public:
-	TriodeModel() {}
+	TriodeModel() : preparedVgk(0.0) {}
 	virtual ~TriodeModel() {}
 	virtual Real getIa(Real Vgk, Real Vak) { 
 		LOG_ERROR("Using an undefined triode model! FAIL!");
@@ -42,15 +45,50 @@ public:
 		LOG_ERROR("Using an undefined triode model! FAIL!");
 		return 0.0; 
 	}
+	virtual Real getIaAndDerivative(Real Vgk, Real Vak, Real& dIadVak) {
+		//Returns Ia and sets dIa/dVak. Models without a closed form fall back on a forward finite difference.
+		const Real dx = 1e-6;
+		Real Ia = getIa(Vgk, Vak);
+		dIadVak = (getIa(Vgk, Vak + dx) - Ia)/dx;
+		return Ia;
+	}
+	
+	/*
+	Staged evaluation for solvers that hold Vgk fixed while they iterate on Vak. prepare(Vgk) 
+	lets a model cache the terms that only depend on the grid, evaluate(Vak) then only computes
+	the rest. The defaults just defer to getIa and getIaAndDerivative.
+	*/
+	virtual void prepare(Real Vgk) { preparedVgk = Vgk; }
+	virtual Real evaluate(Real Vak) { return getIa(preparedVgk, Vak); }
+	virtual Real evaluate(Real Vak, Real& dIadVak) { return getIaAndDerivative(preparedVgk, Vak, dIadVak); }
+	
+	/*
+	Batched evaluation of n independent operating points (Vgk[i], Vak[i]), so that solvers running
+	several tubes in lockstep can use every SIMD lane. The defaults loop over the scalar functions.
+	*/
+	virtual void getIaBatch(const Real* Vgk, const Real* Vak, Real* Ia, uint n) {
+		for (uint i = 0; i < n; ++i){
+			Ia[i] = getIa(Vgk[i], Vak[i]);
+		}
+	}
+	virtual void getIaAndDerivativeBatch(const Real* Vgk, const Real* Vak, Real* Ia, Real* dIadVak, uint n) {
+		for (uint i = 0; i < n; ++i){
+			Ia[i] = getIaAndDerivative(Vgk[i], Vak[i], dIadVak[i]);
+		}
+	}
 
 	virtual TriodeModel* clone() const { return new TriodeModel(*this); }
 private:
 	TriodeModel(const TriodeModel& other) { }
+protected:
+	Real preparedVgk;
 };
 
 class TriodeRemoteCutoff6386 : public TriodeModel {
 public:
-	TriodeRemoteCutoff6386() : VgkLast(1.0), numeratorLast(0.0) { }
+	TriodeRemoteCutoff6386() : VgkLast(1.0), numeratorLast(0.0) { 
+		prepare(0.0);
+	}
 	virtual ~TriodeRemoteCutoff6386() { }
 	
 	virtual Real getIa(Real Vgk, Real Vak){
@@ -60,25 +98,86 @@ public:
 		if (Vgk > 0.0) {
 			Vgk = 0.0;
 		}
-		Real p1 = 3.981e-8;
-		Real p2 = 2.383;
-		Real p3 = 0.5;
-		Real p4 = 0.1;
-		Real p5 = 1.8;
-		Real p6 = 0.5;
-		Real p7 = -0.03922;
-		Real p8 = 0.2;
-		Real iakAlt = p1*pow(Vak, p2) / (pow((p3-p4*Vgk), p5)*(p6+exp(p7*Vak-p8*Vgk)));
+		Real iakAlt = p1*pow(Vak, p2) / (pow((p3-p4*Vgk), p5)*(p6+FastMath::exp(p7*Vak-p8*Vgk)));
 		return iakAlt;
 		
 	}
+	virtual Real getIaAndDerivative(Real Vgk, Real Vak, Real& dIadVak){
+		/*
+		Ia = p1*Vak^p2 / ((p3 - p4*Vgk)^p5 * (p6 + E)), E = exp(p7*Vak - p8*Vgk)
+		dIa/dVak = p1*Vak^(p2-1) / ((p3 - p4*Vgk)^p5 * (p6 + E)) * (p2 - p7*Vak*E/(p6 + E))
+		Factored so that the derivative is well behaved at Vak = 0.
+		*/
+		bool VakClipped = false;
+		if (Vak < 0.0) {
+			Vak = 0.0;
+			VakClipped = true;
+		}
+		if (Vgk > 0.0) {
+			Vgk = 0.0;
+		}
+		Real E = FastMath::exp(p7*Vak-p8*Vgk);
+		Real denominator = pow((p3-p4*Vgk), p5)*(p6+E);
+		Real IaOverVak = p1*pow(Vak, p2 - 1.0) / denominator;
+		if (VakClipped) {
+			dIadVak = 0.0;
+		}
+		else {
+			dIadVak = IaOverVak*(p2 - p7*Vak*E/(p6+E));
+		}
+		return IaOverVak*Vak;
+	}
+	
+	virtual void prepare(Real Vgk){
+		if (Vgk > 0.0) {
+			Vgk = 0.0;
+		}
+		VgkLast = Vgk;
+		gridPowLast = pow((p3-p4*Vgk), p5);
+		gridExpLast = FastMath::exp(-p8*Vgk);
+	}
+	virtual Real evaluate(Real Vak){
+		if (Vak < 0.0) {
+			Vak = 0.0;
+		}
+		return p1*pow(Vak, p2) / (gridPowLast*(p6+FastMath::exp(p7*Vak)*gridExpLast));
+	}
+	virtual Real evaluate(Real Vak, Real& dIadVak){
+		bool VakClipped = false;
+		if (Vak < 0.0) {
+			Vak = 0.0;
+			VakClipped = true;
+		}
+		Real E = FastMath::exp(p7*Vak)*gridExpLast;
+		Real IaOverVak = p1*pow(Vak, p2 - 1.0) / (gridPowLast*(p6+E));
+		if (VakClipped) {
+			dIadVak = 0.0;
+		}
+		else {
+			dIadVak = IaOverVak*(p2 - p7*Vak*E/(p6+E));
+		}
+		return IaOverVak*Vak;
+	}
+	
+	//Vectorised, within about a dozen ulp of the scalar functions (see --testTubeBatch)
+	virtual void getIaBatch(const Real* Vgk, const Real* Vak, Real* Ia, uint n) {
+		TriodeKernels::evaluateRemoteCutoff(kernelParameters, Vgk, Vak, Ia, NULL, n);
+	}
+	virtual void getIaAndDerivativeBatch(const Real* Vgk, const Real* Vak, Real* Ia, Real* dIadVak, uint n) {
+		TriodeKernels::evaluateRemoteCutoff(kernelParameters, Vgk, Vak, Ia, dIadVak, n);
+	}
+	
 	virtual TriodeModel* clone() const { return new TriodeRemoteCutoff6386(*this); }	
+	
+	static const RemoteCutoffTriodeParameters& getKernelParameters() { return kernelParameters; }
 
 private:
 	TriodeRemoteCutoff6386(const TriodeRemoteCutoff6386& other) {
 		LOG_INFO("Copied TriodeRemoteCutoff6386");
 		VgkLast = other.VgkLast; 
 		numeratorLast = other.numeratorLast; 
+		gridPowLast = other.gridPowLast;
+		gridExpLast = other.gridExpLast;
 	}
 
 protected:
@@ -93,6 +192,18 @@ protected:
 protected:
 	Real VgkLast;
 	Real numeratorLast;
+	Real gridPowLast; //(p3 - p4*Vgk)^p5 for the prepared Vgk
+	Real gridExpLast; //exp(-p8*Vgk) for the prepared Vgk
+	
+	static const Real p1;
+	static const Real p2;
+	static const Real p3;
+	static const Real p4;
+	static const Real p5;
+	static const Real p6;
+	static const Real p7;
+	static const Real p8;
+	static const RemoteCutoffTriodeParameters kernelParameters; //p1 to p8 for the batched kernels
 	
 	static const Real fa;
 	static const Real aa;
@@ -101,18 +212,169 @@ protected:
 	static const Real d;
 	static const Real c;
 	static const Real g;
-	static const Real h;	
+	static const Real h;
+};
+
+#define TRIODE_TABLE_DEFAULT_RESOLUTION 128
+#define TRIODE_TABLE_DEFAULT_VGK_MIN -80.0
+#define TRIODE_TABLE_DEFAULT_VGK_MAX 0.0
+#define TRIODE_TABLE_DEFAULT_VAK_MIN 0.0
+#define TRIODE_TABLE_DEFAULT_VAK_MAX 400.0
+
+class TriodeTableModel : public TriodeModel {
+	/*
+	Table driven version of another triode model. Ia(Vgk, Vak) is sampled on a regular grid
+	over the operating range of the 670 and read back with bicubic (Catmull-Rom) interpolation.
+	Operating points outside the grid are passed through to the source model.
+
+	The maximum interpolation error against the source model is measured when the table is built,
+	so the grid resolution can be traded against accuracy.
+	*/
+public:
+	TriodeTableModel(const TriodeModel& sourceModel_, uint numVgkPoints=TRIODE_TABLE_DEFAULT_RESOLUTION, uint numVakPoints=TRIODE_TABLE_DEFAULT_RESOLUTION,
+	Real VgkMin=TRIODE_TABLE_DEFAULT_VGK_MIN, Real VgkMax=TRIODE_TABLE_DEFAULT_VGK_MAX, Real VakMin=TRIODE_TABLE_DEFAULT_VAK_MIN, Real VakMax=TRIODE_TABLE_DEFAULT_VAK_MAX);
+	virtual ~TriodeTableModel() { delete sourceModel; }
+
+	virtual Real getIa(Real Vgk, Real Vak){
+		if (Vak < 0.0) {
+			Vak = 0.0;
+		}
+		if (Vgk > 0.0) {
+			Vgk = 0.0;
+		}
+		if (!table.contains(Vgk, Vak)) {
+			return sourceModel->getIa(Vgk, Vak);
+		}
+		return table.interpolate(Vgk, Vak);
+	}
+	virtual Real getIaAndDerivative(Real Vgk, Real Vak, Real& dIadVak){
+		bool VakClipped = false;
+		if (Vak < 0.0) {
+			Vak = 0.0;
+			VakClipped = true;
+		}
+		if (Vgk > 0.0) {
+			Vgk = 0.0;
+		}
+		if (!table.contains(Vgk, Vak)) {
+			return sourceModel->getIaAndDerivative(Vgk, Vak, dIadVak);
+		}
+		Real Ia = table.interpolate(Vgk, Vak, dIadVak);
+		if (VakClipped) {
+			dIadVak = 0.0;
+		}
+		return Ia;
+	}
+	virtual TriodeModel* clone() const { return new TriodeTableModel(*this); }
+
+	Real getMaxError() const { return maxError; } //Amps
+	Real getMaxRelativeError() const { return maxError/peakIa; } //Relative to the largest current in the table
+	uint getNumVgkPoints() const { return table.getNumXPoints(); }
+	uint getNumVakPoints() const { return table.getNumYPoints(); }
+
+private:
+	TriodeTableModel(const TriodeTableModel& other) {
+		LOG_INFO("Copied TriodeTableModel");
+		sourceModel = other.sourceModel->clone();
+		table = other.table;
+		maxError = other.maxError;
+		peakIa = other.peakIa;
+	}
+
+	void buildTable();
+	void measureMaxError();
+
+protected:
+	TriodeModel *sourceModel;
+	BasicDSP::BicubicTable table; //x = Vgk, y = Vak
+	Real maxError;
+	Real peakIa;
+};
+
+#define TUBE_SOLVER_HISTOGRAM_SIZE 8
+
+class TubeSolverStatistics {
+public:
+	TubeSolverStatistics() { reset(); }
+	void reset() {
+		numSolves = 0;
+		numIterations = 0;
+		numModelEvaluations = 0;
+		numTableLookups = 0;
+		numBisectionSteps = 0;
+		numIterationCapHits = 0;
+		for (uint i = 0; i < TUBE_SOLVER_HISTOGRAM_SIZE; ++i) {
+			iterationHistogram[i] = 0;
+		}
+	}
+	void add(const TubeSolverStatistics& other) {
+		numSolves += other.numSolves;
+		numIterations += other.numIterations;
+		numModelEvaluations += other.numModelEvaluations;
+		numTableLookups += other.numTableLookups;
+		numBisectionSteps += other.numBisectionSteps;
+		numIterationCapHits += other.numIterationCapHits;
+		for (uint i = 0; i < TUBE_SOLVER_HISTOGRAM_SIZE; ++i) {
+			iterationHistogram[i] += other.iterationHistogram[i];
+		}
+	}
+	void recordSolve(uint iterations) {
+		++numSolves;
+		numIterations += iterations;
+		++iterationHistogram[iterations < TUBE_SOLVER_HISTOGRAM_SIZE - 1 ? iterations : TUBE_SOLVER_HISTOGRAM_SIZE - 1];
+	}
+	Real getIterationsPerSolve() const { return numSolves ? ((Real) numIterations)/numSolves : 0.0; }
+	Real getModelEvaluationsPerSolve() const { return numSolves ? ((Real) numModelEvaluations)/numSolves : 0.0; }
+public:
+	ulong numSolves;
+	ulong numIterations;
+	ulong numModelEvaluations; //Each one costs the model's pow and exp calls
+	ulong numTableLookups; //Samples answered from the solution table, with no iteration
+	ulong numBisectionSteps; //Newton steps that left the bracket and were replaced by bisection
+	ulong numIterationCapHits; //Solves stopped by the iteration cap before reaching the tolerance
+	ulong iterationHistogram[TUBE_SOLVER_HISTOGRAM_SIZE]; //Solves by number of iterations, the last bin also counts anything longer
+};
+
+#define TUBE_SOLVER_PREDICTOR_HISTORY 3
+#define TUBE_SOLVER_DEFAULT_PREDICTOR_ORDER 0 //0 reuses the last solution, 1 and 2 extrapolate linearly and quadratically, which is opt-in
+
+#define TUBE_SOLVER_DEFAULT_TOLERANCE 1e-9 //Relative change in Vak between iterations
+#define TUBE_SOLVER_DEFAULT_MAX_ITERATIONS 100 //As before the solve was bracketed, lower it to bound the worst case cost
+
+#define TUBE_SOLUTION_TABLE_DEFAULT_A_MIN 100.0
+#define TUBE_SOLUTION_TABLE_DEFAULT_A_MAX 500.0
+//The solution table is built and checked with its own solves, whatever the per sample solver is set to
+#define TUBE_SOLUTION_TABLE_SOLVER_TOLERANCE 1e-14 //A few ulps of Vak
+#define TUBE_SOLUTION_TABLE_SOLVER_MAX_ITERATIONS 200 //Bisection alone gets there in under 60
+
+struct TubeSolverState {
+	Real Vak;
+	Real VakLow; //Bracket on the solution
+	Real VakHigh;
+	uint iteration;
+	bool converged;
 };
 
 class WDFTubeInterface {
 public:
+	friend class TubeLockstepSolver;
 	WDFTubeInterface() { model = NULL; }
-	WDFTubeInterface(TriodeModel *model_, Real numParallelInstances_=3.0) : model(model_), 
-	numParallelInstances(numParallelInstances_) {
+	WDFTubeInterface(TriodeModel *model_, Real numParallelInstances_=3.0, uint solutionTableResolution_=0) : model(model_), 
+	numParallelInstances(numParallelInstances_), solutionTableResolution(solutionTableResolution_) {
+		r0 = 0.0;
 		a = 0.0;
 		Vgk = 0.0;
 		Iak = 0.0;
 		VakGuess = 100.0;
+		for (uint i = 0; i < TUBE_SOLVER_PREDICTOR_HISTORY; ++i) {
+			VakHistory[i] = VakGuess;
+		}
+		predictorOrder = TUBE_SOLVER_DEFAULT_PREDICTOR_ORDER;
+		useAnalyticDerivative = true;
+		tolerance = TUBE_SOLVER_DEFAULT_TOLERANCE;
+		maxIterations = TUBE_SOLVER_DEFAULT_MAX_ITERATIONS;
+		solutionTableR0 = 0.0;
+		solutionTableMaxError = 0.0;
 	}
 	~WDFTubeInterface() { delete model; }
 	
@@ -124,6 +386,24 @@ public:
 		Vgk = other.Vgk;
 		Iak = other.Iak;
 		VakGuess = other.VakGuess;
+		for (uint i = 0; i < TUBE_SOLVER_PREDICTOR_HISTORY; ++i) {
+			VakHistory[i] = other.VakHistory[i];
+		}
+		predictorOrder = other.predictorOrder;
+		useAnalyticDerivative = other.useAnalyticDerivative;
+		tolerance = other.tolerance;
+		maxIterations = other.maxIterations;
+		solutionTableResolution = other.solutionTableResolution;
+		solutionTable = other.solutionTable;
+		solutionTableR0 = other.solutionTableR0;
+		solutionTableMaxError = other.solutionTableMaxError;
+	}
+	
+	void setPortResistance(Real r0_){
+		//Called whenever the circuit's coefficients are updated, so the solution table matches the port
+		if (solutionTableResolution > 0 && (solutionTable.isEmpty() || r0_ != solutionTableR0)) {
+			buildSolutionTable(r0_);
+		}
 	}
 	
 	Real getB(Real a_, Real r0_, Real Vgate, Real Vk){
@@ -142,48 +422,186 @@ public:
 		a = a_;
 		
 		Vgk = Vgate - Vk;
-
-		Real Vak = VakGuess;
-		uint iteration = 0;
-		Real err = 1e6;
-		Iak = 0.0;
-		
-		LOG_SAMPLE2("Vak=" << Vak << " Vgk=" << Vgk << " a=" << a << " ");
 		
-		while (fabs(err)/fabs(Vak) > 1e-9){
-			VakGuess = iterateNewtonRaphson(Vak);
-			err = Vak - VakGuess;
-			Vak = VakGuess;
-
-			LOG_INNER_LOOP("Vak=" << Vak << " err=" << err << " Iak=" << Iak);
-			if (iteration > 100){
-				LOG_ERROR("Convergence failure!");
-				break;
+		if (!solutionTable.isEmpty() && r0 == solutionTableR0) {
+			Real VgkClipped = fmin(Vgk, 0.0); //The model is flat for Vgk > 0
+			if (solutionTable.contains(VgkClipped, a)) {
+				++statistics.numTableLookups;
+				Real b = solutionTable.interpolate(VgkClipped, a);
+				Real Vak = 0.5*(a + b);
+				Iak = (a - b)/(2.0*r0);
+				VakGuess = Vak;
+				recordVak(Vak);
+				SCOPE("VakModel", Vak);
+				return b;
 			}
-			++iteration;
 		}
+
+		VakGuess = predictVak();
+		Real Vak = solveForVak();
+		recordVak(Vak);
 		Real b = Vak - r0*Iak;
 		/*
 		a = v + Ri
 		b = v - Ri
-		v = a + b
+		v = (a + b)/2
 		*/
 		SCOPE("VakModel", Vak);
 		LOG_SAMPLE2("Vgk" <<  Vgk << " Vak=" << Vak << " Iak=" << Iak);
 		return b;
 	}
+	
+	void setUseAnalyticDerivative(bool useAnalyticDerivative_) { useAnalyticDerivative = useAnalyticDerivative_; }
+	void setPredictorOrder(uint predictorOrder_) { 
+		Assert(predictorOrder_ < TUBE_SOLVER_PREDICTOR_HISTORY);
+		predictorOrder = predictorOrder_; 
+	}
+	void setTolerance(Real tolerance_) { tolerance = tolerance_; }
+	void setMaxIterations(uint maxIterations_) { 
+		Assert(maxIterations_ > 0);
+		maxIterations = maxIterations_; 
+	}
+	const TubeSolverStatistics& getStatistics() const { return statistics; }
+	void resetStatistics() { statistics.reset(); }
+	Real getSolutionTableMaxError() const { return solutionTableMaxError; }
+	
+	struct State {
+		//Only the predictor carries over from sample to sample, a, Vgk and Iak are set by every solve
+		Real VakGuess;
+		Real VakHistory[TUBE_SOLVER_PREDICTOR_HISTORY];
+	};
+	void saveState(State& state) const {
+		state.VakGuess = VakGuess;
+		for (uint i = 0; i < TUBE_SOLVER_PREDICTOR_HISTORY; ++i) {
+			state.VakHistory[i] = VakHistory[i];
+		}
+	}
+	void loadState(const State& state) {
+		VakGuess = state.VakGuess;
+		for (uint i = 0; i < TUBE_SOLVER_PREDICTOR_HISTORY; ++i) {
+			VakHistory[i] = state.VakHistory[i];
+		}
+	}
 
 protected:
+	Real solveForVak(){
+		//Solves the implicit equation for the current a, r0 and Vgk, starting from VakGuess
+		TubeSolverState state;
+		beginSolve(state);
+		
+		LOG_SAMPLE2("Vak=" << state.Vak << " Vgk=" << Vgk << " a=" << a << " ");
+		
+		model->prepare(Vgk); //Vgk is fixed for the whole solve
+		bool finished = false;
+		while (!finished){
+			Real F;
+			Real VakNewton;
+			if (useAnalyticDerivative) {
+				VakNewton = iterateNewtonRaphson(state.Vak, F);
+			}
+			else {
+				VakNewton = iterateNewtonRaphsonFiniteDifference(state.Vak, F);
+			}
+			finished = stepSolve(state, F, VakNewton);
+		}
+		finishSolve(state);
+		return state.Vak;
+	}
+	
+	/*
+	The safeguarded Newton iteration, in steps so that TubeLockstepSolver can run several solves 
+	side by side.
+	
+	F(Vak) = Vak + r0*Iak(Vak) - a has F' = 1 + r0*dIa/dVak >= 1, so it has exactly one root and
+	F(min(a, 0)) <= 0 <= F(max(a, 0)) brackets it. Each evaluation shrinks the bracket and any Newton
+	step that leaves it is replaced by bisection, so the solve always converges and a hard iteration
+	cap bounds the worst case cost per sample.
+	*/
+	void beginSolve(TubeSolverState& state) const {
+		state.VakLow = fmin(a, 0.0);
+		state.VakHigh = fmax(a, 0.0);
+		state.Vak = fmin(fmax(VakGuess, state.VakLow), state.VakHigh);
+		state.iteration = 0;
+		state.converged = false;
+	}
+	bool stepSolve(TubeSolverState& state, Real F, Real VakNewton){
+		//Takes F(Vak) and the Newton step from it, returns true once the solve has finished
+		++state.iteration;
+		if (F == 0.0) {
+			state.converged = true;
+			return true;
+		}
+		if (F < 0.0) {
+			state.VakLow = state.Vak;
+		}
+		else {
+			state.VakHigh = state.Vak;
+		}
+		if (!(VakNewton >= state.VakLow && VakNewton <= state.VakHigh)) { //Also catches a non finite step
+			VakNewton = 0.5*(state.VakLow + state.VakHigh);
+			++statistics.numBisectionSteps;
+		}
+		Real err = state.Vak - VakNewton;
+		state.Vak = VakNewton;
+
+		LOG_INNER_LOOP("Vak=" << state.Vak << " err=" << err << " Iak=" << Iak);
+		if (fabs(err) <= tolerance*fabs(state.Vak)){
+			state.converged = true;
+			return true;
+		}
+		return state.iteration >= maxIterations;
+	}
+	void finishSolve(const TubeSolverState& state){
+		if (!state.converged) {
+			++statistics.numIterationCapHits;
+			LOG_SAMPLE1("Tube solve hit the iteration cap: Vgk=" << Vgk << " a=" << a << " Vak=" << state.Vak);
+		}
+		statistics.recordSolve(state.iteration);
+	}
+	
+	Real predictVak() const {
+		//Polynomial extrapolation of the last few solutions, the initial guess for the next solve
+		switch (predictorOrder) {
+		case 0:
+			return VakHistory[0];
+		case 1:
+			return 2.0*VakHistory[0] - VakHistory[1];
+		default:
+			return 3.0*VakHistory[0] - 3.0*VakHistory[1] + VakHistory[2];
+		}
+	}
+	void recordVak(Real Vak) {
+		for (uint i = TUBE_SOLVER_PREDICTOR_HISTORY - 1; i > 0; --i) {
+			VakHistory[i] = VakHistory[i - 1];
+		}
+		VakHistory[0] = Vak;
+	}
+	
+	void buildSolutionTable(Real r0_);
+	
 	Real evaluateImplicitEquation(Real Vak){
 		Assert(!isnan(Vak));
 		Assert(!isnan(Vgk));		
-		Iak = model->getIa(Vgk, Vak) * numParallelInstances;
+		++statistics.numModelEvaluations;
+		Iak = model->evaluate(Vak) * numParallelInstances;
 		LOG_INNER_LOOP("Eval: " << "Vgk=" << Vgk << " Vak=" << Vak << " Iak=" << Iak << " r0=" << r0 << "; ");
 		Assert(!isnan(Iak));
 		LOG_INNER_LOOP("a=" << a << " diff=" << Vak + r0*Iak - a);
 		return Vak + r0*Iak - a;
 	}
-	Real iterateNewtonRaphson(Real x, Real dxFactor=1e-6);
+	Real evaluateImplicitEquation(Real Vak, Real& dFdVak){
+		Assert(!isnan(Vak));
+		Assert(!isnan(Vgk));		
+		++statistics.numModelEvaluations;
+		Real dIadVak;
+		Iak = model->evaluate(Vak, dIadVak) * numParallelInstances;
+		dFdVak = 1.0 + r0*dIadVak*numParallelInstances;
+		LOG_INNER_LOOP("Eval: " << "Vgk=" << Vgk << " Vak=" << Vak << " Iak=" << Iak << " r0=" << r0 << "; ");
+		Assert(!isnan(Iak));
+		return Vak + r0*Iak - a;
+	}
+	Real iterateNewtonRaphson(Real x, Real& F);
+	Real iterateNewtonRaphsonFiniteDifference(Real x, Real& F, Real dxFactor=1e-6);
 
 	Real numParallelInstances;
 
@@ -192,7 +610,64 @@ protected:
 	Real Vgk;
 	Real Iak;
 	Real VakGuess;
+	Real VakHistory[TUBE_SOLVER_PREDICTOR_HISTORY]; //Most recent solution first
+	uint predictorOrder;
 	TriodeModel *model;
+	
+	bool useAnalyticDerivative;
+	Real tolerance;
+	uint maxIterations; //Hard cap, the best estimate so far is used when it is reached
+	TubeSolverStatistics statistics;
+	
+	//Explicit solution b(Vgk, a) for a fixed port resistance, replaces the iterative solve when built
+	uint solutionTableResolution;
+	BasicDSP::BicubicTable solutionTable; //x = Vgk, y = a
+	Real solutionTableR0;
+	Real solutionTableMaxError;
+};
+
+#define TUBE_LOCKSTEP_MAX_LANES 8
+
+class TubeLockstepSolver {
+	/*
+	Solves several tubes together, with one batched model evaluation per Newton iteration for all 
+	of them so that the model's vectorised kernels fill their SIMD lanes. Each lane runs the same 
+	safeguarded Newton iteration as WDFTubeInterface::solveForVak and has its own convergence flag, 
+	finished lanes ride along until the slowest one is done. The tubes keep their own predictor 
+	history, settings and statistics. Lanes with a solution table or a finite difference derivative 
+	are handed to WDFTubeInterface::getB instead. All lanes must use the same tube model.
+	
+	Usage: clear(), addLane() for each tube, solve(), then getB() for each lane.
+	*/
+public:
+	TubeLockstepSolver() : numLanes(0) {}
+	
+	void clear() { numLanes = 0; }
+	uint addLane(WDFTubeInterface& tube, Real a_, Real r0_, Real Vgate_, Real Vk_){
+		//Takes the same arguments as WDFTubeInterface::getB, returns the lane index
+		Assert(numLanes < TUBE_LOCKSTEP_MAX_LANES);
+		tubes[numLanes] = &tube;
+		a[numLanes] = a_;
+		r0[numLanes] = r0_;
+		Vgate[numLanes] = Vgate_;
+		Vk[numLanes] = Vk_;
+		return numLanes++;
+	}
+	void solve();
+	Real getB(uint lane) const {
+		Assert(lane < numLanes);
+		return b[lane];
+	}
+	uint getNumLanes() const { return numLanes; }
+
+protected:
+	uint numLanes;
+	WDFTubeInterface* tubes[TUBE_LOCKSTEP_MAX_LANES];
+	Real a[TUBE_LOCKSTEP_MAX_LANES];
+	Real r0[TUBE_LOCKSTEP_MAX_LANES];
+	Real Vgate[TUBE_LOCKSTEP_MAX_LANES];
+	Real Vk[TUBE_LOCKSTEP_MAX_LANES];
+	Real b[TUBE_LOCKSTEP_MAX_LANES];
 };
 
 #endif
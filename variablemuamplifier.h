@@ -30,11 +30,14 @@
 #include "Misc.h"
 #include "wdfcircuits.h"
 #include "tubemodel.h"
+#include "statespace.h"
+#include "operatingpoint.h"
 #include "scope.h"
 
 #define CATHODE_CAPACITOR_CONN_R 1e-6
 
 class VariableMuAmplifier {
+	friend class Wavechild670Batch;
 	/*
 	Simulation of a variable-Mu tube amplifier using the 6386 remote-cutoff tube 
 	Peter Raffensperger
@@ -46,21 +49,71 @@ class VariableMuAmplifier {
 
 	*/
 public:
-	VariableMuAmplifier(Real sampleRate) : inputCircuit(inputTxCw, 0.0, inputTxLm, inputTxLp, inputTxLs, inputTxNpOverNs, inputTxRc, RinputTerminationValue, RgateValue, inputTxRp, inputTxRs, RinputValue, sampleRate),
-	tubeModelInterface(new TriodeRemoteCutoff6386(), numTubeParallelInstances),
+	VariableMuAmplifier(Real sampleRate, TriodeModel* tubeModel=NULL, uint tubeSolutionTableResolution=0) : inputCircuit(inputTxCw, 0.0, inputTxLm, inputTxLp, inputTxLs, inputTxNpOverNs, inputTxRc, RinputTerminationValue, RgateValue, inputTxRp, inputTxRs, RinputValue, sampleRate),
+	tubeModelInterface(tubeModel ? tubeModel : new TriodeRemoteCutoff6386(), numTubeParallelInstances, tubeSolutionTableResolution), //Takes ownership of tubeModel
 	tubeAmpPush(CcathodeValue, outputTxCw, VcathodeBias, Vplate, outputTxLm, outputTxLp, outputTxLs, outputTxNpOverNs, outputTxRc, 	RoutputValue, outputTxRp, outputTxRs, RsidechainValue, RcathodeValue, RplateValue, CATHODE_CAPACITOR_CONN_R, cathodeCapacitorConn.getInterface(0), sampleRate, tubeModelInterface),
 	tubeAmpPull(CcathodeValue, outputTxCw, VcathodeBias, Vplate, outputTxLm, outputTxLp, outputTxLs, outputTxNpOverNs, outputTxRc, 	RoutputValue, outputTxRp, outputTxRs, RsidechainValue, RcathodeValue, RplateValue, CATHODE_CAPACITOR_CONN_R, cathodeCapacitorConn.getInterface(1), sampleRate, tubeModelInterface) {
-	
+		pushLane = 0;
+		pullLane = 0;
+		inputCircuitStateSpace = StateSpaceFilter::fromCircuit(inputCircuit);
+		useStateSpaceInputCircuit = false;
 	}
 	virtual ~VariableMuAmplifier() { }
 	
 	virtual Real advanceAndGetOutputVoltage(Real inputVoltage, Real VlevelCap){
+		return advanceTubesAndGetOutputVoltage(advanceInputCircuit(inputVoltage), VlevelCap);
+	}
+	
+	/*
+	advanceAndGetOutputVoltage() in two halves, so that the push and pull tubes can be solved in 
+	lockstep with other amplifiers' tubes: beginAdvance() adds them to the solver, then after 
+	solver.solve(), finishAdvance() returns the output voltage.
+	*/
+	void beginAdvance(Real inputVoltage, Real VlevelCap, TubeLockstepSolver& solver){
+		beginAdvanceTubes(advanceInputCircuit(inputVoltage), VlevelCap, solver);
+	}
+	Real finishAdvance(const TubeLockstepSolver& solver){
+		Real VoutPush = tubeAmpPush.setTubeReflectedWave(solver.getB(pushLane));
+		Real VoutPull = tubeAmpPull.setTubeReflectedWave(solver.getB(pullLane));
+		LOG_SAMPLE1("VoutPush=" << VoutPush);
+		LOG_SAMPLE1("VoutPull=" << VoutPull);
+		cathodeCapacitorConnector.advance();
+		return VoutPush - VoutPull;
+	}
+	
+	/*
+	The input transformer on its own. It doesn't depend on the level capacitor voltage, so a block of 
+	samples can be run through it ahead of the tubes, which then take its gate voltages through 
+	advanceTubesAndGetOutputVoltage() or beginAdvanceTubes().
+	*/
+	Real advanceInputCircuit(Real inputVoltage){
 		Assert(!isnan(inputVoltage));
-		Assert(!isnan(VlevelCap));
-		Real Vgate = inputCircuit.advance(inputVoltage);
+		Real Vgate = useStateSpaceInputCircuit ? inputCircuitStateSpace.advance(inputVoltage) : inputCircuit.advance(inputVoltage);
 		SCOPE("Vgate", Vgate);
 		Assert(!isnan(Vgate));		
 		LOG_SAMPLE1("Vgate=" << Vgate);
+		return Vgate;
+	}
+	void advanceInputCircuitBlock(Real* voltages, uint numSamples){
+		//advanceInputCircuit() in place over a block, without the scope
+		if (useStateSpaceInputCircuit) {
+			inputCircuitStateSpace.process(voltages, voltages, numSamples);
+		}
+		else {
+			for (uint i = 0; i < numSamples; ++i){
+				voltages[i] = inputCircuit.advance(voltages[i]);
+			}
+		}
+	}
+	void setUseStateSpaceInputCircuit(bool useStateSpace) {
+		//The state space realisation takes over from the WDF's current state
+		if (useStateSpace && !useStateSpaceInputCircuit) {
+			inputCircuitStateSpace.setState(inputCircuit.getState());
+		}
+		useStateSpaceInputCircuit = useStateSpace;
+	}
+	Real advanceTubesAndGetOutputVoltage(Real Vgate, Real VlevelCap){
+		Assert(!isnan(VlevelCap));
 		Real VoutPush = tubeAmpPush.advance(VgateBiasConst - VlevelCap + Vgate);
 		Real VoutPull = tubeAmpPull.advance(VgateBiasConst - VlevelCap - Vgate);
 		LOG_SAMPLE1("VoutPush=" << VoutPush);
@@ -68,16 +121,89 @@ public:
 		cathodeCapacitorConnector.advance();
 		return VoutPush - VoutPull;
 	}
+	void beginAdvanceTubes(Real Vgate, Real VlevelCap, TubeLockstepSolver& solver){
+		Assert(!isnan(VlevelCap));
+		pushLane = solver.addLane(tubeAmpPush.getTube(), tubeAmpPush.getTubeIncidentWave(), tubeAmpPush.getTubePortResistance(), VgateBiasConst - VlevelCap + Vgate, tubeAmpPush.getVcathode());
+		pullLane = solver.addLane(tubeAmpPull.getTube(), tubeAmpPull.getTubeIncidentWave(), tubeAmpPull.getTubePortResistance(), VgateBiasConst - VlevelCap - Vgate, tubeAmpPull.getVcathode());
+	}
+	
+	TubeSolverStatistics getTubeSolverStatistics() {
+		TubeSolverStatistics statistics;
+		statistics.add(tubeAmpPush.getTube().getStatistics());
+		statistics.add(tubeAmpPull.getTube().getStatistics());
+		return statistics;
+	}
+	void resetTubeSolverStatistics() {
+		tubeAmpPush.getTube().resetStatistics();
+		tubeAmpPull.getTube().resetStatistics();
+	}
+	void setUseAnalyticDerivative(bool useAnalyticDerivative) {
+		tubeAmpPush.getTube().setUseAnalyticDerivative(useAnalyticDerivative);
+		tubeAmpPull.getTube().setUseAnalyticDerivative(useAnalyticDerivative);
+	}
+	void setTubeSolverPredictorOrder(uint predictorOrder) {
+		tubeAmpPush.getTube().setPredictorOrder(predictorOrder);
+		tubeAmpPull.getTube().setPredictorOrder(predictorOrder);
+	}
+	void setTubeSolverLimits(Real tolerance, uint maxIterations) {
+		tubeAmpPush.getTube().setTolerance(tolerance);
+		tubeAmpPush.getTube().setMaxIterations(maxIterations);
+		tubeAmpPull.getTube().setTolerance(tolerance);
+		tubeAmpPull.getTube().setMaxIterations(maxIterations);
+	}
+	bool solveOperatingPoint(Real VlevelCap) {
+		//The tube stages' quiescent state with no input, for a steady VlevelCap, see SolveOperatingPoint()
+		Real VakPush;
+		Real VakPull;
+		if (!SolveOperatingPoint(tubeAmpPush, VgateBiasConst - VlevelCap, VakPush) || !SolveOperatingPoint(tubeAmpPull, VgateBiasConst - VlevelCap, VakPull)) {
+			return false;
+		}
+		LOG_INFO("Operating point VakPush=" << VakPush << " VakPull=" << VakPull);
+		return true;
+	}
+	
+	struct State {
+		TransformerCoupledInputCircuit::State inputCircuit;
+		StateSpaceFilter::State inputCircuitStateSpace;
+		BidirectionalUnitDelay::State cathodeCapacitorConn;
+		TubeStageCircuit::State tubeAmpPush;
+		TubeStageCircuit::State tubeAmpPull;
+		WDFTubeInterface::State tubePush;
+		WDFTubeInterface::State tubePull;
+	};
+	void saveState(State& state) const {
+		//cathodeCapacitorConnector isn't connected to either tube stage, so it has no state that matters
+		inputCircuit.saveState(state.inputCircuit);
+		inputCircuitStateSpace.saveState(state.inputCircuitStateSpace);
+		cathodeCapacitorConn.saveState(state.cathodeCapacitorConn);
+		tubeAmpPush.saveState(state.tubeAmpPush);
+		tubeAmpPull.saveState(state.tubeAmpPull);
+		tubeAmpPush.getTube().saveState(state.tubePush);
+		tubeAmpPull.getTube().saveState(state.tubePull);
+	}
+	void loadState(const State& state) {
+		inputCircuit.loadState(state.inputCircuit);
+		inputCircuitStateSpace.loadState(state.inputCircuitStateSpace);
+		cathodeCapacitorConn.loadState(state.cathodeCapacitorConn);
+		tubeAmpPush.loadState(state.tubeAmpPush);
+		tubeAmpPull.loadState(state.tubeAmpPull);
+		tubeAmpPush.getTube().loadState(state.tubePush);
+		tubeAmpPull.getTube().loadState(state.tubePull);
+	}
 protected:
 	//Input circuit
 	TransformerCoupledInputCircuit inputCircuit;
+	StateSpaceFilter inputCircuitStateSpace; //Equivalent to inputCircuit
+	bool useStateSpaceInputCircuit;
 	BidirectionalUnitDelay cathodeCapacitorConn;
 
 	//Amplifier
-	WDFTubeInterface tubeModelInterface;
+	WDFTubeInterface tubeModelInterface; //Prototype only, each tube stage solves with its own copy
 	BidirectionalUnitDelay cathodeCapacitorConnector;
 	TubeStageCircuit tubeAmpPull;
 	TubeStageCircuit tubeAmpPush;
+	uint pushLane; //Lanes in the lockstep solver between beginAdvance and finishAdvance
+	uint pullLane;
 
 	//Input circuit
 	static const Real RinputValue;
@@ -0,0 +1,321 @@
+/************************************************************************************
+* 
+* Wavechild670 v0.1 
+* 
+* vectormath.h
+* 
+* By Peter Raffensperger 11 March 2014
+* 
+* Reference:
+* Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+* Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+* York, UK, September 17-21, 2012.
+* 
+* Note:
+* Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+* affiliated with the author.
+* 
+* License:
+* Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+* software in an academic context, we would appreciate it if you referenced the original
+* paper.
+* 
+************************************************************************************/
+
+
+
+#ifndef VECTORMATH_H
+#define VECTORMATH_H
+
+/*
+Lane generic exp, log and tube model kernels. Each instruction set gets an Ops struct with the
+handful of primitives the kernels need, and the kernels are templates on it, so every instruction
+set runs exactly the same arithmetic and returns bit identical results.
+
+Only include this from translation units that are built for one instruction set (see the
+Makefile), everything is in an unnamed namespace so that code compiled for AVX can't be linked
+into a path that runs on an older CPU. The Ops for an instruction set are only defined when the
+compiler is targeting it.
+*/
+
+#include "Misc.h"
+#include "triodekernels.h"
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+struct ScalarOps {
+	typedef Real V;
+	typedef bool Mask;
+	enum { width = 1 };
+	static inline V load(const Real* p) { return *p; }
+	static inline void store(Real* p, V x) { *p = x; }
+	static inline V set(Real x) { return x; }
+	static inline V setBits(uint64_t bits) {
+		V x;
+		memcpy(&x, &bits, sizeof(x));
+		return x;
+	}
+	static inline V add(V a, V b) { return a + b; }
+	static inline V sub(V a, V b) { return a - b; }
+	static inline V mul(V a, V b) { return a * b; }
+	static inline V div(V a, V b) { return a / b; }
+	static inline V min(V a, V b) { return a < b ? a : b; }
+	static inline V max(V a, V b) { return a > b ? a : b; }
+	static inline V bitAnd(V a, V b) { return setBits(getBits(a) & getBits(b)); }
+	static inline V bitOr(V a, V b) { return setBits(getBits(a) | getBits(b)); }
+	static inline V shiftLeft52(V a) { return setBits(getBits(a) << 52); }
+	static inline V shiftRight52(V a) { return setBits(getBits(a) >> 52); }
+	static inline Mask lessThan(V a, V b) { return a < b; }
+	static inline Mask lessOrEqual(V a, V b) { return a <= b; }
+	static inline bool any(Mask m) { return m; }
+	static inline V select(Mask m, V ifTrue, V ifFalse) { return m ? ifTrue : ifFalse; }
+private:
+	static inline uint64_t getBits(V x) {
+		uint64_t bits;
+		memcpy(&bits, &x, sizeof(bits));
+		return bits;
+	}
+};
+
+#ifdef __SSE2__
+struct SSE2Ops {
+	typedef __m128d V;
+	typedef __m128d Mask;
+	enum { width = 2 };
+	static inline V load(const Real* p) { return _mm_loadu_pd(p); }
+	static inline void store(Real* p, V x) { _mm_storeu_pd(p, x); }
+	static inline V set(Real x) { return _mm_set1_pd(x); }
+	static inline V setBits(uint64_t bits) { return _mm_castsi128_pd(_mm_set1_epi64x(bits)); }
+	static inline V add(V a, V b) { return _mm_add_pd(a, b); }
+	static inline V sub(V a, V b) { return _mm_sub_pd(a, b); }
+	static inline V mul(V a, V b) { return _mm_mul_pd(a, b); }
+	static inline V div(V a, V b) { return _mm_div_pd(a, b); }
+	static inline V min(V a, V b) { return _mm_min_pd(a, b); }
+	static inline V max(V a, V b) { return _mm_max_pd(a, b); }
+	static inline V bitAnd(V a, V b) { return _mm_and_pd(a, b); }
+	static inline V bitOr(V a, V b) { return _mm_or_pd(a, b); }
+	static inline V shiftLeft52(V a) { return _mm_castsi128_pd(_mm_slli_epi64(_mm_castpd_si128(a), 52)); }
+	static inline V shiftRight52(V a) { return _mm_castsi128_pd(_mm_srli_epi64(_mm_castpd_si128(a), 52)); }
+	static inline Mask lessThan(V a, V b) { return _mm_cmplt_pd(a, b); }
+	static inline Mask lessOrEqual(V a, V b) { return _mm_cmple_pd(a, b); }
+	static inline bool any(Mask m) { return _mm_movemask_pd(m) != 0; }
+	static inline V select(Mask m, V ifTrue, V ifFalse) { return _mm_or_pd(_mm_and_pd(m, ifTrue), _mm_andnot_pd(m, ifFalse)); }
+};
+#endif
+
+#ifdef __AVX2__
+struct AVX2Ops {
+	typedef __m256d V;
+	typedef __m256d Mask;
+	enum { width = 4 };
+	static inline V load(const Real* p) { return _mm256_loadu_pd(p); }
+	static inline void store(Real* p, V x) { _mm256_storeu_pd(p, x); }
+	static inline V set(Real x) { return _mm256_set1_pd(x); }
+	static inline V setBits(uint64_t bits) { return _mm256_castsi256_pd(_mm256_set1_epi64x(bits)); }
+	static inline V add(V a, V b) { return _mm256_add_pd(a, b); }
+	static inline V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+	static inline V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+	static inline V div(V a, V b) { return _mm256_div_pd(a, b); }
+	static inline V min(V a, V b) { return _mm256_min_pd(a, b); }
+	static inline V max(V a, V b) { return _mm256_max_pd(a, b); }
+	static inline V bitAnd(V a, V b) { return _mm256_and_pd(a, b); }
+	static inline V bitOr(V a, V b) { return _mm256_or_pd(a, b); }
+	static inline V shiftLeft52(V a) { return _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_castpd_si256(a), 52)); }
+	static inline V shiftRight52(V a) { return _mm256_castsi256_pd(_mm256_srli_epi64(_mm256_castpd_si256(a), 52)); }
+	static inline Mask lessThan(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+	static inline Mask lessOrEqual(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+	static inline bool any(Mask m) { return _mm256_movemask_pd(m) != 0; }
+	static inline V select(Mask m, V ifTrue, V ifFalse) { return _mm256_blendv_pd(ifFalse, ifTrue, m); }
+};
+#endif
+
+#ifdef __AVX512F__
+struct AVX512Ops {
+	typedef __m512d V;
+	typedef __mmask8 Mask;
+	enum { width = 8 };
+	static inline V load(const Real* p) { return _mm512_loadu_pd(p); }
+	static inline void store(Real* p, V x) { _mm512_storeu_pd(p, x); }
+	static inline V set(Real x) { return _mm512_set1_pd(x); }
+	static inline V setBits(uint64_t bits) { return _mm512_castsi512_pd(_mm512_set1_epi64(bits)); }
+	static inline V add(V a, V b) { return _mm512_add_pd(a, b); }
+	static inline V sub(V a, V b) { return _mm512_sub_pd(a, b); }
+	static inline V mul(V a, V b) { return _mm512_mul_pd(a, b); }
+	static inline V div(V a, V b) { return _mm512_div_pd(a, b); }
+	static inline V min(V a, V b) { return _mm512_min_pd(a, b); }
+	static inline V max(V a, V b) { return _mm512_max_pd(a, b); }
+	static inline V bitAnd(V a, V b) { return _mm512_castsi512_pd(_mm512_and_epi64(_mm512_castpd_si512(a), _mm512_castpd_si512(b))); }
+	static inline V bitOr(V a, V b) { return _mm512_castsi512_pd(_mm512_or_epi64(_mm512_castpd_si512(a), _mm512_castpd_si512(b))); }
+	static inline V shiftLeft52(V a) { return _mm512_castsi512_pd(_mm512_slli_epi64(_mm512_castpd_si512(a), 52)); }
+	static inline V shiftRight52(V a) { return _mm512_castsi512_pd(_mm512_srli_epi64(_mm512_castpd_si512(a), 52)); }
+	static inline Mask lessThan(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+	static inline Mask lessOrEqual(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_LE_OQ); }
+	static inline bool any(Mask m) { return m != 0; }
+	static inline V select(Mask m, V ifTrue, V ifFalse) { return _mm512_mask_blend_pd(m, ifFalse, ifTrue); }
+};
+#endif
+
+template <class Ops>
+struct VectorMath {
+	typedef typename Ops::V V;
+
+	static inline V roundToNearest(V x){
+		//Exact for |x| < 2^51, ties go to even
+		const V magic = Ops::set(6755399441055744.0); //1.5*2^52
+		return Ops::sub(Ops::add(x, magic), magic);
+	}
+
+	static inline V exp(V x){
+		/*
+		Cephes exp: x = n*ln(2) + r with |r| <= ln(2)/2, then a Pade approximation of exp(r),
+		within 1 ulp of the exact result. The argument is clamped to [-700, 700] so that the
+		exponent can be built directly, which is far outside anything the tube models produce.
+		*/
+		x = Ops::min(Ops::max(x, Ops::set(-700.0)), Ops::set(700.0));
+		V n = roundToNearest(Ops::mul(x, Ops::set(1.4426950408889634073599)));
+		x = Ops::sub(x, Ops::mul(n, Ops::set(6.93145751953125E-1)));
+		x = Ops::sub(x, Ops::mul(n, Ops::set(1.42860682030941723212E-6)));
+		V xx = Ops::mul(x, x);
+		V px = Ops::add(Ops::mul(Ops::set(1.26177193074810590878E-4), xx), Ops::set(3.02994407707441961300E-2));
+		px = Ops::add(Ops::mul(px, xx), Ops::set(9.99999999999999999910E-1));
+		px = Ops::mul(px, x);
+		V qx = Ops::add(Ops::mul(Ops::set(3.00198505138664455042E-6), xx), Ops::set(2.52448340349684104192E-3));
+		qx = Ops::add(Ops::mul(qx, xx), Ops::set(2.27265548208155028766E-1));
+		qx = Ops::add(Ops::mul(qx, xx), Ops::set(2.00000000000000000009E0));
+		x = Ops::div(px, Ops::sub(qx, px));
+		x = Ops::add(Ops::set(1.0), Ops::add(x, x));
+		return Ops::mul(x, exp2Integer(n));
+	}
+
+	static inline V log(V x){
+		/*
+		Cephes log for positive, normal x: x = m*2^e with m in [sqrt(0.5), sqrt(2)), then a rational
+		approximation of log(m). Within 2 ulp of the exact result.
+		*/
+		V biasedExponent = integerToReal(Ops::shiftRight52(x));
+		V e = Ops::sub(biasedExponent, Ops::set(1022.0));
+		V m = Ops::bitOr(Ops::bitAnd(x, Ops::setBits(0x000FFFFFFFFFFFFFULL)), Ops::setBits(0x3FE0000000000000ULL)); //[0.5, 1)
+		typename Ops::Mask small = Ops::lessThan(m, Ops::set(0.70710678118654752440));
+		e = Ops::select(small, Ops::sub(e, Ops::set(1.0)), e);
+		x = Ops::sub(Ops::select(small, Ops::add(m, m), m), Ops::set(1.0));
+		V z = Ops::mul(x, x);
+		V px = Ops::add(Ops::mul(Ops::set(1.01875663804580931796E-4), x), Ops::set(4.97494994976747001425E-1));
+		px = Ops::add(Ops::mul(px, x), Ops::set(4.70579119878881725854E0));
+		px = Ops::add(Ops::mul(px, x), Ops::set(1.44989225341610930846E1));
+		px = Ops::add(Ops::mul(px, x), Ops::set(1.79368678507819816313E1));
+		px = Ops::add(Ops::mul(px, x), Ops::set(7.70838733755885391666E0));
+		V qx = Ops::add(x, Ops::set(1.12873587189167450590E1));
+		qx = Ops::add(Ops::mul(qx, x), Ops::set(4.52279145837532221105E1));
+		qx = Ops::add(Ops::mul(qx, x), Ops::set(8.29875266912776603211E1));
+		qx = Ops::add(Ops::mul(qx, x), Ops::set(7.11544750618563894466E1));
+		qx = Ops::add(Ops::mul(qx, x), Ops::set(2.31251620126765340583E1));
+		V y = Ops::mul(x, Ops::mul(z, Ops::div(px, qx)));
+		y = Ops::sub(y, Ops::mul(e, Ops::set(2.121944400546905827679e-4)));
+		y = Ops::sub(y, Ops::mul(Ops::set(0.5), z));
+		z = Ops::add(x, y);
+		return Ops::add(z, Ops::mul(e, Ops::set(0.693359375)));
+	}
+
+	static inline V abs(V x){
+		return Ops::bitAnd(x, Ops::setBits(0x7FFFFFFFFFFFFFFFULL));
+	}
+
+	static inline V log1pExp(V x){
+		/*
+		log(1 + exp(x)) as max(x, 0) + log1p(exp(-|x|)), so that exp can't overflow. log1p(y) is taken
+		as log(u)*y/(u - 1) with u = 1 + y, which cancels the rounding error in u, and is y itself
+		when y is too small to change u.
+		*/
+		const V zero = Ops::set(0.0);
+		V y = exp(Ops::sub(zero, abs(x)));
+		V u = Ops::add(Ops::set(1.0), y);
+		V uMinusOne = Ops::sub(u, Ops::set(1.0));
+		V log1pY = Ops::select(Ops::lessOrEqual(uMinusOne, zero), y, Ops::mul(log(u), Ops::div(y, uMinusOne)));
+		return Ops::add(Ops::max(x, zero), log1pY);
+	}
+
+protected:
+	static inline V exp2Integer(V n){
+		//2^n for integral n in [-1022, 1023], the low bits of n + 1023 + 2^52 are the biased exponent
+		V biased = Ops::add(n, Ops::set(1023.0 + 4503599627370496.0));
+		return Ops::shiftLeft52(biased);
+	}
+	static inline V integerToReal(V bits){
+		//Converts the integer held in the low bits, exact below 2^52
+		V twoTo52 = Ops::setBits(0x4330000000000000ULL);
+		return Ops::sub(Ops::bitOr(bits, twoTo52), twoTo52);
+	}
+};
+
+template <class Ops>
+struct VectorTriodeRemoteCutoff {
+	typedef typename Ops::V V;
+
+	static inline void getIaAndDerivative(const RemoteCutoffTriodeParameters& p, V Vgk, V Vak, V& Ia, V& dIadVak){
+		/*
+		The same clipping and factoring as TriodeRemoteCutoff6386::getIaAndDerivative, with the
+		pow calls written as exp(p*log(x)).
+		*/
+		const V zero = Ops::set(0.0);
+		Vgk = Ops::min(Vgk, zero);
+		typename Ops::Mask conducting = Ops::lessThan(zero, Vak);
+		Vak = Ops::max(Vak, zero);
+		V VakSafe = Ops::select(conducting, Vak, Ops::set(1.0)); //Keeps log away from zero in the clipped lanes
+		V E = VectorMath<Ops>::exp(Ops::sub(Ops::mul(Ops::set(p.p7), Vak), Ops::mul(Ops::set(p.p8), Vgk)));
+		V logGrid = VectorMath<Ops>::log(Ops::sub(Ops::set(p.p3), Ops::mul(Ops::set(p.p4), Vgk)));
+		V logVak = VectorMath<Ops>::log(VakSafe);
+		V numerator = VectorMath<Ops>::exp(Ops::sub(Ops::mul(Ops::set(p.p2 - 1.0), logVak), Ops::mul(Ops::set(p.p5), logGrid)));
+		V p6PlusE = Ops::add(Ops::set(p.p6), E);
+		V IaOverVak = Ops::div(Ops::mul(Ops::set(p.p1), numerator), p6PlusE);
+		Ia = Ops::select(conducting, Ops::mul(IaOverVak, Vak), zero);
+		V slope = Ops::sub(Ops::set(p.p2), Ops::div(Ops::mul(Ops::mul(Ops::set(p.p7), Vak), E), p6PlusE));
+		dIadVak = Ops::select(conducting, Ops::mul(IaOverVak, slope), zero);
+	}
+
+	static void evaluate(const RemoteCutoffTriodeParameters& parameters, const Real* Vgk, const Real* Vak, Real* Ia, Real* dIadVak, uint n){
+		const uint width = Ops::width;
+		V IaLanes;
+		V dIadVakLanes;
+		uint i = 0;
+		for (; i + width <= n; i += width){
+			getIaAndDerivative(parameters, Ops::load(Vgk + i), Ops::load(Vak + i), IaLanes, dIadVakLanes);
+			Ops::store(Ia + i, IaLanes);
+			if (dIadVak) {
+				Ops::store(dIadVak + i, dIadVakLanes);
+			}
+		}
+		if (i < n) {
+			//Pads the remainder out to a full vector
+			Real VgkPadded[width];
+			Real VakPadded[width];
+			Real IaPadded[width];
+			Real dIadVakPadded[width];
+			for (uint j = 0; j < width; ++j){
+				VgkPadded[j] = i + j < n ? Vgk[i + j] : 0.0;
+				VakPadded[j] = i + j < n ? Vak[i + j] : 0.0;
+			}
+			getIaAndDerivative(parameters, Ops::load(VgkPadded), Ops::load(VakPadded), IaLanes, dIadVakLanes);
+			Ops::store(IaPadded, IaLanes);
+			Ops::store(dIadVakPadded, dIadVakLanes);
+			for (uint j = 0; i + j < n; ++j){
+				Ia[i + j] = IaPadded[j];
+				if (dIadVak) {
+					dIadVak[i + j] = dIadVakPadded[j];
+				}
+			}
+		}
+	}
+};
+
+}
+
+#endif
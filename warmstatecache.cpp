@@ -0,0 +1,170 @@
+/************************************************************************************
+* 
+* Wavechild670 v0.1 
+* 
+* warmstatecache.cpp
+* 
+* By Peter Raffensperger 11 March 2014
+* 
+* Reference:
+* Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+* Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+* York, UK, September 17-21, 2012.
+* 
+* Note:
+* Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+* affiliated with the author.
+* 
+* License:
+* Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+* software in an academic context, we would appreciate it if you referenced the original
+* paper.
+* 
+************************************************************************************/
+
+
+
+
+#include "warmstatecache.h"
+#include "fastmath.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+WarmStateCache::WarmStateCache(const string& directory_) : directory(directory_), numHits(0), numMisses(0) {
+	if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+		LOG_WARNING("Couldn't create the warm state cache directory " << directory);
+	}
+}
+
+WarmStateCache::~WarmStateCache(){
+	for (map<string, const Entry*>::iterator it = mappedEntries.begin(); it != mappedEntries.end(); ++it){
+		munmap((void*) it->second, sizeof(Entry));
+	}
+}
+
+bool WarmStateCache::warmUp(Wavechild670& compressor, Real sampleRate, const Wavechild670Parameters& parameters, Real warmUpTimeInSeconds){
+	Real key[WARM_STATE_KEY_LENGTH];
+	makeKey(sampleRate, parameters, warmUpTimeInSeconds, key);
+	string filename = getFilename(key);
+	const Entry* entry = find(filename, key);
+	if (entry) {
+		compressor.loadState(entry->state);
+		++numHits;
+		return true;
+	}
+	compressor.warmUp(warmUpTimeInSeconds);
+	Wavechild670::State state;
+	compressor.saveState(state);
+	writeEntry(filename, key, state);
+	++numMisses;
+	return false;
+}
+
+void WarmStateCache::makeKey(Real sampleRate, const Wavechild670Parameters& parameters, Real warmUpTimeInSeconds, Real* key){
+	//Every setting as a Real, so that the key has no padding to hash
+	uint i = 0;
+	key[i++] = sampleRate;
+	key[i++] = warmUpTimeInSeconds;
+	key[i++] = FastMath::getUseApproximations();
+	key[i++] = parameters.inputLevelA;
+	key[i++] = parameters.ACThresholdA;
+	key[i++] = parameters.timeConstantSelectA;
+	key[i++] = parameters.DCThresholdA;
+	key[i++] = parameters.inputLevelB;
+	key[i++] = parameters.ACThresholdB;
+	key[i++] = parameters.timeConstantSelectB;
+	key[i++] = parameters.DCThresholdB;
+	key[i++] = parameters.sidechainLink;
+	key[i++] = parameters.isMidSide;
+	key[i++] = parameters.useFeedbackTopology;
+	key[i++] = parameters.outputGain;
+	key[i++] = parameters.hardClipOutput;
+	key[i++] = parameters.tubeTableResolution;
+	key[i++] = parameters.tubeSolutionTableResolution;
+	key[i++] = parameters.tubeSolverPredictorOrder;
+	key[i++] = parameters.tubeSolverTolerance;
+	key[i++] = parameters.tubeSolverMaxIterations;
+	key[i++] = parameters.useLockstepTubeSolver;
+	key[i++] = parameters.oversamplingFactor;
+	key[i++] = parameters.sidechainDecimation;
+	key[i++] = parameters.useStateSpaceInputCircuits;
+	Assert(i == WARM_STATE_KEY_LENGTH);
+}
+
+string WarmStateCache::getFilename(const Real* key) const {
+	//64 bit FNV-1a of the key
+	const unsigned char* bytes = (const unsigned char*) key;
+	uint64_t hash = 14695981039346656037ULL;
+	for (uint i = 0; i < WARM_STATE_KEY_LENGTH*sizeof(Real); ++i){
+		hash = (hash ^ bytes[i])*1099511628211ULL;
+	}
+	char name[32];
+	snprintf(name, sizeof(name), "/%016llx.state", (unsigned long long) hash);
+	return directory + name;
+}
+
+const WarmStateCache::Entry* WarmStateCache::find(const string& filename, const Real* key){
+	map<string, const Entry*>::iterator it = mappedEntries.find(filename);
+	const Entry* entry = it != mappedEntries.end() ? it->second : mapEntry(filename);
+	if (!entry) {
+		return NULL;
+	}
+	if (memcmp(entry->magic, WARM_STATE_MAGIC, 8) != 0 || entry->version != WARM_STATE_VERSION 
+		|| entry->stateSize != sizeof(Wavechild670::State) || memcmp(entry->key, key, sizeof(entry->key)) != 0) {
+		//From an older build, or a hash collision, it gets written over
+		LOG_INFO("Stale warm state cache entry " << filename);
+		munmap((void*) entry, sizeof(Entry));
+		mappedEntries.erase(filename);
+		return NULL;
+	}
+	return entry;
+}
+
+const WarmStateCache::Entry* WarmStateCache::mapEntry(const string& filename){
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+	struct stat info;
+	void* mapping = MAP_FAILED;
+	if (fstat(fd, &info) == 0 && info.st_size == (off_t) sizeof(Entry)) {
+		mapping = mmap(NULL, sizeof(Entry), PROT_READ, MAP_SHARED, fd, 0);
+	}
+	close(fd); //The mapping keeps the file
+	if (mapping == MAP_FAILED) {
+		LOG_INFO("Couldn't map warm state cache entry " << filename);
+		return NULL;
+	}
+	const Entry* entry = (const Entry*) mapping;
+	mappedEntries[filename] = entry;
+	return entry;
+}
+
+bool WarmStateCache::writeEntry(const string& filename, const Real* key, const Wavechild670::State& state){
+	//To a temporary file first, so that a reader never maps half an entry
+	Entry* entry = new Entry;
+	memset(entry, 0, sizeof(Entry));
+	memcpy(entry->magic, WARM_STATE_MAGIC, 8);
+	entry->version = WARM_STATE_VERSION;
+	entry->stateSize = sizeof(Wavechild670::State);
+	memcpy(entry->key, key, sizeof(entry->key));
+	entry->state = state;
+	char suffix[32];
+	snprintf(suffix, sizeof(suffix), ".%d.tmp", (int) getpid());
+	string temporaryFilename = filename + suffix;
+	FILE* file = fopen(temporaryFilename.c_str(), "wb");
+	bool written = file && fwrite(entry, sizeof(Entry), 1, file) == 1;
+	written = file && fclose(file) == 0 && written;
+	delete entry;
+	if (!written || rename(temporaryFilename.c_str(), filename.c_str()) != 0) {
+		LOG_WARNING("Couldn't write warm state cache entry " << filename);
+		unlink(temporaryFilename.c_str());
+		return false;
+	}
+	return true;
+}
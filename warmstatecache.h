@@ -0,0 +1,87 @@
+/************************************************************************************
+* 
+* Wavechild670 v0.1 
+* 
+* warmstatecache.h
+* 
+* By Peter Raffensperger 11 March 2014
+* 
+* Reference:
+* Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+* Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+* York, UK, September 17-21, 2012.
+* 
+* Note:
+* Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+* affiliated with the author.
+* 
+* License:
+* Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+* software in an academic context, we would appreciate it if you referenced the original
+* paper.
+* 
+************************************************************************************/
+
+
+
+#ifndef WARMSTATECACHE_H
+#define WARMSTATECACHE_H
+
+#include "Misc.h"
+#include "wavechild670.h"
+#include <map>
+
+#define WARM_STATE_MAGIC "WC670WST"
+#define WARM_STATE_VERSION 1
+#define WARM_STATE_KEY_LENGTH 25 //Settings that the warmed up state depends on, see makeKey()
+
+/*
+The state that Wavechild670::warmUp() leaves a compressor in, cached on disk so that it's only 
+simulated once for each sample rate, set of parameters and warm up time. Each entry is a file in 
+the cache directory, named after a hash of its settings:
+	char[8] WARM_STATE_MAGIC, uint32 WARM_STATE_VERSION, uint32 sizeof(Wavechild670::State), 
+	float64[WARM_STATE_KEY_LENGTH] key, Wavechild670::State state
+The files are memory mapped when first used and stay mapped, so that later compressors load 
+straight from the mapping. A State is raw memory, so a file only suits builds with the same 
+layout; the version and size checks catch most changes, delete the directory after any other.
+
+A compressor warmed up from the cache is bit for bit the same as one warmed up by warmUp(). 
+Not thread safe.
+*/
+
+class WarmStateCache {
+public:
+	WarmStateCache(const string& directory_);
+	virtual ~WarmStateCache();
+	
+	//Loads the compressor's warmed up state if there's an entry for these settings, otherwise 
+	//warms it up and adds one. Returns true if it came from the cache.
+	bool warmUp(Wavechild670& compressor, Real sampleRate, const Wavechild670Parameters& parameters, Real warmUpTimeInSeconds=0.5);
+	
+	uint getNumHits() const { return numHits; }
+	uint getNumMisses() const { return numMisses; }
+
+protected:
+	struct Entry {
+		char magic[8];
+		uint version;
+		uint stateSize;
+		Real key[WARM_STATE_KEY_LENGTH];
+		Wavechild670::State state;
+	};
+	static void makeKey(Real sampleRate, const Wavechild670Parameters& parameters, Real warmUpTimeInSeconds, Real* key);
+	string getFilename(const Real* key) const;
+	const Entry* find(const string& filename, const Real* key);
+	const Entry* mapEntry(const string& filename);
+	bool writeEntry(const string& filename, const Real* key, const Wavechild670::State& state);
+	
+	string directory;
+	map<string, const Entry*> mappedEntries; //By filename, stay mapped until the cache is destroyed
+	uint numHits;
+	uint numMisses;
+
+private:
+	WarmStateCache(const WarmStateCache& other) {}
+};
+
+#endif
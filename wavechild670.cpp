@@ -33,4 +33,6 @@ const Real Wavechild670::levelTimeConstantCircuitComponentValues[6][6] = {
 	{ 4e-6, 8e-6, 20e-6, 220e3, 10e9, 10e9 },
 	{ 8e-6, 8e-6, 20e-6, 220e3, 10e9, 10e9 },
 	{ 4e-6, 8e-6, 20e-6, 220e3, 100e3, 10e9 },
-	{ 2e-6, 8e-6, 20e-6, 220e3, 100e3, 100e3 }};
\ No newline at end of file
+	{ 2e-6, 8e-6, 20e-6, 220e3, 100e3, 100e3 }};
+
+const Real Wavechild670::sqrt2 = sqrt(2.0);
\ No newline at end of file
@@ -33,6 +33,7 @@
 
 #include "sidechainamplifier.h"
 #include "variablemuamplifier.h"
+#include "oversampling.h"
 #include "basicdsp.h"
 #include "scope.h"
 
@@ -43,6 +44,14 @@
 #define LEVELTC_CIRCUIT_DEFAULT_R_R2 1e9
 #define LEVELTC_CIRCUIT_DEFAULT_R_R3 1e9
 
+/*
+How far sidechain decimation may move the static gain curve from the undecimated one, in dB: half of 
+the roughly 1dB just noticeable difference in level, so that the decimated sidechain can't be heard 
+as a different amount of gain reduction.
+*/
+#define WAVECHILD670_SIDECHAIN_DECIMATION_TOLERANCE 0.5
+#define WAVECHILD670_MAX_FEEDBACK_SIDECHAIN_DECIMATION 4 //Above this, the feedback loop's extra delay moves the static gain curve by more than the tolerance (0.50dB at 8)
+
 class Wavechild670Parameters {
 public:
 	Wavechild670Parameters(Real inputLevelA_, Real ACThresholdA_, uint timeConstantSelectA_, Real DCThresholdA_, 
@@ -64,6 +73,15 @@ public:
 		outputGain = outputGain_;
 		hardClipOutput = hardClipOutput_;
 		
+		tubeTableResolution = 0;
+		tubeSolutionTableResolution = 0;
+		tubeSolverPredictorOrder = TUBE_SOLVER_DEFAULT_PREDICTOR_ORDER;
+		tubeSolverTolerance = TUBE_SOLVER_DEFAULT_TOLERANCE;
+		tubeSolverMaxIterations = TUBE_SOLVER_DEFAULT_MAX_ITERATIONS;
+		useLockstepTubeSolver = false;
+		oversamplingFactor = 1;
+		sidechainDecimation = 1;
+		useStateSpaceInputCircuits = false;
 	}
 	virtual ~Wavechild670Parameters() {}
 public:
@@ -83,21 +101,45 @@ public:
 	
 	Real outputGain;
 	bool hardClipOutput;
+	
+	//Simulation settings, only read when the compressor is constructed
+	uint tubeTableResolution; //Grid points per axis for a table driven tube model, 0 for the analytic model
+	uint tubeSolutionTableResolution; //Grid points per axis for the iteration free tube solution table, 0 to solve iteratively
+	uint tubeSolverPredictorOrder; //Order of the extrapolation that seeds each tube solve
+	Real tubeSolverTolerance; //Relative change in Vak at which a tube solve stops
+	uint tubeSolverMaxIterations; //Hard cap on the iterations of each tube solve
+	bool useLockstepTubeSolver; //Solve all four tubes together with the vectorised tube model
+	uint oversamplingFactor; //1, 2, 4 or 8, the signal amplifiers run at this multiple of the sample rate, which delays the output (see Wavechild670::getLatency())
+	uint sidechainDecimation; //The sidechain current and level circuits run at the sample rate divided by this, 1 to run them every sample, capped in the feedback topology to stay within WAVECHILD670_SIDECHAIN_DECIMATION_TOLERANCE
+	bool useStateSpaceInputCircuits; //Run the input transformers as state space filters, no faster in a full render (see TestStateSpace() in main.cpp), so off
 private:
 	Wavechild670Parameters() {}
 };
 
 class Wavechild670 {
+	friend class Wavechild670Batch; //Reads each lane's circuits and state out of a compressor
 public:
 	Wavechild670(Real sampleRate_, Wavechild670Parameters& parameters) : 
-	sampleRate(sampleRate_),
+	sampleRate(sampleRate_), numClippedSamples(0), totalClippedSamples(0), clipPeak(0.0),
 	useFeedbackTopology(parameters.useFeedbackTopology), isMidSide(parameters.isMidSide), sidechainLink(parameters.sidechainLink),
 	sidechainAmplifierA(sampleRate, parameters.ACThresholdA, parameters.DCThresholdA), sidechainAmplifierB(sampleRate, parameters.ACThresholdB, parameters.DCThresholdB), 
-	levelTimeConstantCircuitA(LEVELTC_CIRCUIT_DEFAULT_C_C1, LEVELTC_CIRCUIT_DEFAULT_C_C2, LEVELTC_CIRCUIT_DEFAULT_C_C3, LEVELTC_CIRCUIT_DEFAULT_R_R1, LEVELTC_CIRCUIT_DEFAULT_R_R2, LEVELTC_CIRCUIT_DEFAULT_R_R3, sampleRate), 
-	levelTimeConstantCircuitB(LEVELTC_CIRCUIT_DEFAULT_C_C1, LEVELTC_CIRCUIT_DEFAULT_C_C2, LEVELTC_CIRCUIT_DEFAULT_C_C3, LEVELTC_CIRCUIT_DEFAULT_R_R1, LEVELTC_CIRCUIT_DEFAULT_R_R2, LEVELTC_CIRCUIT_DEFAULT_R_R3, sampleRate), 
+	levelTimeConstantCircuitA(LEVELTC_CIRCUIT_DEFAULT_C_C1, LEVELTC_CIRCUIT_DEFAULT_C_C2, LEVELTC_CIRCUIT_DEFAULT_C_C3, LEVELTC_CIRCUIT_DEFAULT_R_R1, LEVELTC_CIRCUIT_DEFAULT_R_R2, LEVELTC_CIRCUIT_DEFAULT_R_R3, sampleRate/sidechainDecimation), 
+	levelTimeConstantCircuitB(LEVELTC_CIRCUIT_DEFAULT_C_C1, LEVELTC_CIRCUIT_DEFAULT_C_C2, LEVELTC_CIRCUIT_DEFAULT_C_C3, LEVELTC_CIRCUIT_DEFAULT_R_R1, LEVELTC_CIRCUIT_DEFAULT_R_R2, LEVELTC_CIRCUIT_DEFAULT_R_R3, sampleRate/sidechainDecimation), 
 	VlevelCapA(0.0), VlevelCapB(0.0),
-	signalAmplifierA(sampleRate), signalAmplifierB(sampleRate), inputLevelA(parameters.inputLevelA), inputLevelB(parameters.inputLevelB) {
+	sidechainDecimation(limitSidechainDecimation(parameters)), sidechainPhase(0), peakVgPlusA(0.0), peakVgPlusB(0.0),
+	VlevelCapControlA(0.0), VlevelCapControlB(0.0), VlevelCapPreviousA(0.0), VlevelCapPreviousB(0.0),
+	signalAmplifierA(sampleRate*parameters.oversamplingFactor, createTubeModel(parameters), parameters.tubeSolutionTableResolution), signalAmplifierB(sampleRate*parameters.oversamplingFactor, createTubeModel(parameters), parameters.tubeSolutionTableResolution), inputLevelA(parameters.inputLevelA), inputLevelB(parameters.inputLevelB),
+	useLockstepTubeSolver(parameters.useLockstepTubeSolver), oversamplerA(parameters.oversamplingFactor), oversamplerB(parameters.oversamplingFactor) {
+		Assert(sidechainDecimation >= 1);
 		setParameters(parameters);
+		signalAmplifierA.setTubeSolverPredictorOrder(parameters.tubeSolverPredictorOrder);
+		signalAmplifierB.setTubeSolverPredictorOrder(parameters.tubeSolverPredictorOrder);
+		signalAmplifierA.setTubeSolverLimits(parameters.tubeSolverTolerance, parameters.tubeSolverMaxIterations);
+		signalAmplifierB.setTubeSolverLimits(parameters.tubeSolverTolerance, parameters.tubeSolverMaxIterations);
+		signalAmplifierA.setUseStateSpaceInputCircuit(parameters.useStateSpaceInputCircuits);
+		signalAmplifierB.setUseStateSpaceInputCircuit(parameters.useStateSpaceInputCircuits);
+		sidechainAmplifierA.setUseStateSpaceInputCircuit(parameters.useStateSpaceInputCircuits);
+		sidechainAmplifierB.setUseStateSpaceInputCircuit(parameters.useStateSpaceInputCircuits);
 		SCOPE_PROBE("Vgate", 2);
 		SCOPE_PROBE("Vcathode", 4);
 		SCOPE_PROBE("Vak", 4);
@@ -107,6 +149,7 @@ public:
 		SCOPE_PROBE("Vsc", 2);			
 		SCOPE_PROBE("VgPlus", 2);
 		SCOPE_PROBE("Vamp", 2);
+		SCOPE_PROBE("currentOver", 0); //Up front like the rest, so that rendering threads only ever look probes up
 	}
 	virtual ~Wavechild670() {}
 
@@ -124,6 +167,7 @@ public:
 		useFeedbackTopology = parameters.useFeedbackTopology;		
 		outputGain = parameters.outputGain;
 		hardClipOutput = parameters.hardClipOutput;
+		selectProcessKernel();
 		
 		LOG_INFO("Internals");
 		LOG_INFO("inputLevelA=" << inputLevelA); 
@@ -137,128 +181,397 @@ public:
 	}
 	
 	virtual void warmUp(Real warmUpTimeInSeconds=0.5){
-		ulong numSamples = (ulong) warmUpTimeInSeconds*sampleRate;
+		ulong numSamples = (ulong) (warmUpTimeInSeconds*sampleRate);
 		for (ulong i = 0; i < numSamples/2; i += 1) {
-			Real VoutA = signalAmplifierA.advanceAndGetOutputVoltage(0.0, VlevelCapA);
-			Real VoutB = signalAmplifierB.advanceAndGetOutputVoltage(0.0, VlevelCapB);
+			Real VoutA;
+			Real VoutB;
+			advanceSignalAmplifiers(0.0, 0.0, VoutA, VoutB);
 		}
 		for (ulong i = 0; i < numSamples/2; i += 1) {
-			Real VoutA = signalAmplifierA.advanceAndGetOutputVoltage(0.0, VlevelCapA);
-			Real VoutB = signalAmplifierB.advanceAndGetOutputVoltage(0.0, VlevelCapB);
+			Real VoutA;
+			Real VoutB;
+			advanceSignalAmplifiers(0.0, 0.0, VoutA, VoutB);
 			advanceSidechain(VoutA, VoutB); //Feedback topology with implicit unit delay between the sidechain input and the output, 
 		}
 		SCOPE_RESET();
+		resetTubeSolverStatistics();
+	}
+
+	virtual void solveOperatingPoint(){
+		//The state that warmUp() approaches, solved for directly: everything at rest apart from the tube stages' bias
+		State state;
+		memset(&state, 0, sizeof(State));
+		loadState(state);
+		if (!signalAmplifierA.solveOperatingPoint(VlevelCapA) || !signalAmplifierB.solveOperatingPoint(VlevelCapB)) {
+			LOG_WARNING("Couldn't solve for the DC operating point, warming up instead");
+			loadState(state);
+			warmUp();
+		}
 	}
 
 	//virtual void process(Real *VinputLeft, Real *VinputRight, Real *VoutLeft, Real *VoutRight, ulong numSamples) {
 	virtual void process(Real *VinputInterleaved, Real *VoutInterleaved, ulong numSamples) {
 		Assert(VinputInterleaved);
 		Assert(VoutInterleaved);
+		(this->*selectedProcessKernel)(VinputInterleaved, VoutInterleaved, numSamples);
+		reportClipping(numSamples/2);
+	}
+	
+	void reportClipping(ulong numFrames) {
+		//One warning for all the samples clipped in the last numFrames frames, rather than one each
+		if (numClippedSamples > 0) {
+			LOG_WARNING("Clipped " << numClippedSamples << " output samples in " << numFrames << " frames, peak " << clipPeak);
+			totalClippedSamples += numClippedSamples;
+			numClippedSamples = 0;
+			clipPeak = 0.0;
+		}
+	}
+	ulong getNumClippedSamples() const { return totalClippedSamples + numClippedSamples; }
+	
+	/*
+	Everything that carries over from one sample to the next, as plain data: saveState() and 
+	loadState() only copy, so they never allocate and are safe to call from the audio thread, and a 
+	State can be copied around with memcpy. A State only suits a compressor with the same sample 
+	rate, oversampling factor and sidechain decimation as the one it came from. The controls aren't 
+	part of it, setParameters() sets those.
+	*/
+	struct State {
+		VariableMuAmplifier::State signalAmplifierA;
+		VariableMuAmplifier::State signalAmplifierB;
+		SidechainAmplifier::State sidechainAmplifierA;
+		SidechainAmplifier::State sidechainAmplifierB;
+		LevelTimeConstantCircuit::State levelTimeConstantCircuitA;
+		LevelTimeConstantCircuit::State levelTimeConstantCircuitB;
+		Oversampler::State oversamplerA;
+		Oversampler::State oversamplerB;
+		Real VlevelCapA;
+		Real VlevelCapB;
+		uint sidechainPhase;
+		Real peakVgPlusA;
+		Real peakVgPlusB;
+		Real VlevelCapControlA;
+		Real VlevelCapControlB;
+		Real VlevelCapPreviousA;
+		Real VlevelCapPreviousB;
+	};
+	void saveState(State& state) const {
+		signalAmplifierA.saveState(state.signalAmplifierA);
+		signalAmplifierB.saveState(state.signalAmplifierB);
+		sidechainAmplifierA.saveState(state.sidechainAmplifierA);
+		sidechainAmplifierB.saveState(state.sidechainAmplifierB);
+		levelTimeConstantCircuitA.saveState(state.levelTimeConstantCircuitA);
+		levelTimeConstantCircuitB.saveState(state.levelTimeConstantCircuitB);
+		oversamplerA.saveState(state.oversamplerA);
+		oversamplerB.saveState(state.oversamplerB);
+		state.VlevelCapA = VlevelCapA;
+		state.VlevelCapB = VlevelCapB;
+		state.sidechainPhase = sidechainPhase;
+		state.peakVgPlusA = peakVgPlusA;
+		state.peakVgPlusB = peakVgPlusB;
+		state.VlevelCapControlA = VlevelCapControlA;
+		state.VlevelCapControlB = VlevelCapControlB;
+		state.VlevelCapPreviousA = VlevelCapPreviousA;
+		state.VlevelCapPreviousB = VlevelCapPreviousB;
+	}
+	void loadState(const State& state) {
+		signalAmplifierA.loadState(state.signalAmplifierA);
+		signalAmplifierB.loadState(state.signalAmplifierB);
+		sidechainAmplifierA.loadState(state.sidechainAmplifierA);
+		sidechainAmplifierB.loadState(state.sidechainAmplifierB);
+		levelTimeConstantCircuitA.loadState(state.levelTimeConstantCircuitA);
+		levelTimeConstantCircuitB.loadState(state.levelTimeConstantCircuitB);
+		oversamplerA.loadState(state.oversamplerA);
+		oversamplerB.loadState(state.oversamplerB);
+		VlevelCapA = state.VlevelCapA;
+		VlevelCapB = state.VlevelCapB;
+		sidechainPhase = state.sidechainPhase;
+		peakVgPlusA = state.peakVgPlusA;
+		peakVgPlusB = state.peakVgPlusB;
+		VlevelCapControlA = state.VlevelCapControlA;
+		VlevelCapControlB = state.VlevelCapControlB;
+		VlevelCapPreviousA = state.VlevelCapPreviousA;
+		VlevelCapPreviousB = state.VlevelCapPreviousB;
+	}
+	
+	uint getOversamplingFactor() const { return oversamplerA.getFactor(); }
+	/*
+	How many samples the output lags the input by, from the oversampling filters' round trip: 0 at 
+	1x, 47 at 2x, 54.5 at 4x and 58.25 at 8x. process() doesn't compensate for it, so callers that 
+	need the output lined up with the input have to trim it. The sidechain isn't delayed, so in the 
+	feedforward topology the gain reduction leads the signal by this much, and in the feedback 
+	topology the sidechain hears the delayed output, which adds this much to the loop's delay.
+	*/
+	Real getLatency() const { return oversamplerA.getLatency(); }
+
+	TubeSolverStatistics getTubeSolverStatistics() {
+		TubeSolverStatistics statistics = signalAmplifierA.getTubeSolverStatistics();
+		statistics.add(signalAmplifierB.getTubeSolverStatistics());
+		return statistics;
+	}
+	void resetTubeSolverStatistics() {
+		signalAmplifierA.resetTubeSolverStatistics();
+		signalAmplifierB.resetTubeSolverStatistics();
+	}
+
+protected:
+	static uint limitSidechainDecimation(const Wavechild670Parameters& parameters){
+		//Quietly, so that the many compressors of a static gain curve don't each warn, it's up to the caller to check
+		if (parameters.useFeedbackTopology && parameters.sidechainDecimation > WAVECHILD670_MAX_FEEDBACK_SIDECHAIN_DECIMATION) {
+			return WAVECHILD670_MAX_FEEDBACK_SIDECHAIN_DECIMATION;
+		}
+		return parameters.sidechainDecimation;
+	}
+	static TriodeModel* createTubeModel(const Wavechild670Parameters& parameters){
+		if (parameters.tubeTableResolution == 0) {
+			return new TriodeRemoteCutoff6386();
+		}
+		return new TriodeTableModel(TriodeRemoteCutoff6386(), parameters.tubeTableResolution, parameters.tubeTableResolution);
+	}
+
+	Real getControlRate() const {
+		return sampleRate/sidechainDecimation;
+	}
+
+	virtual void select670TimeConstants(uint tcA, uint tcB){
+		Assert(tcA >= 1);
+		Assert(tcA <= 6);
+		tcA -= 1;
+		levelTimeConstantCircuitA.updateRValues(levelTimeConstantCircuitComponentValues[tcA][0], levelTimeConstantCircuitComponentValues[tcA][1], levelTimeConstantCircuitComponentValues[tcA][2], levelTimeConstantCircuitComponentValues[tcA][3], levelTimeConstantCircuitComponentValues[tcA][4], levelTimeConstantCircuitComponentValues[tcA][5], getControlRate());
+		Assert(tcB >= 1);
+		Assert(tcB <= 6);
+		tcB -= 1;
+		levelTimeConstantCircuitA.updateRValues(levelTimeConstantCircuitComponentValues[tcB][0], levelTimeConstantCircuitComponentValues[tcB][1], levelTimeConstantCircuitComponentValues[tcB][2], levelTimeConstantCircuitComponentValues[tcB][3], levelTimeConstantCircuitComponentValues[tcB][4], levelTimeConstantCircuitComponentValues[tcB][5], getControlRate());
+	}
+
+	typedef void (Wavechild670::*ProcessKernel)(Real *VinputInterleaved, Real *VoutInterleaved, ulong numSamples);
+	
+	/*
+	process() for one combination of the mode flags, so that the frame by frame loop doesn't branch 
+	on them. selectProcessKernel() picks one of the 16 instances whenever the parameters are set.
+	*/
+	template <bool MidSide, bool FeedbackTopology, bool HardClip, bool Link>
+	void processKernel(Real *VinputInterleaved, Real *VoutInterleaved, ulong numSamples) {
 		static uint numChannels = 2;
 		
 		for (ulong i = 0; i < numSamples; i += numChannels) {
 			uint j = i + 1;
 			Real VinputA;
 			Real VinputB;
-			Assert(!isnan(*(VinputInterleaved+i)));
-			Assert(!isnan(*(VinputInterleaved+j)));
-			if (isMidSide) {
-				VinputA = (*(VinputInterleaved+i) + *(VinputInterleaved+i))/sqrt(2.0);
-				VinputB = (*(VinputInterleaved+j) - *(VinputInterleaved+j))/sqrt(2.0);
-			}
-			else {
-				VinputA = *(VinputInterleaved+i);
-				VinputB = *(VinputInterleaved+j);
-			}
-			SCOPE("VinputA", VinputA);
-			SCOPE("VinputB", VinputB);
-			VinputA *= inputLevelA;
-			VinputB *= inputLevelB;
-			
-			
-			if (!useFeedbackTopology) { // => Feedforward
-				advanceSidechain(VinputA, VinputB); //Feedforward topology
-			}
-			Real VoutA = signalAmplifierA.advanceAndGetOutputVoltage(VinputA, VlevelCapA);
-			Real VoutB = signalAmplifierB.advanceAndGetOutputVoltage(VinputB, VlevelCapB);
-			if (useFeedbackTopology) {
-				advanceSidechain(VoutA, VoutB); //Feedback topology with implicit unit delay between the sidechain input and the output, 
-				//and probably an implicit unit delay between the sidechain capacitor voltage input and the capacitor voltage 
-				//(at least they're not the proper WDF coupling between the two)
+			routeFrameInputs<MidSide>(*(VinputInterleaved+i), *(VinputInterleaved+j), VinputA, VinputB);
+			if (!FeedbackTopology) {
+				advanceSidechain<Link>(VinputA, VinputB); //Feedforward topology
 			}
-			
-			
-			Real VoutLeft;
-			Real VoutRight;			
-			
-			if (isMidSide) {
-				VoutLeft = (VoutA + VoutB)/sqrt(2.0);
-				VoutRight  = (VoutA - VoutB)/sqrt(2.0);
+			Real VoutA;
+			Real VoutB;
+			advanceSignalAmplifiers(VinputA, VinputB, VoutA, VoutB);
+			if (FeedbackTopology) {
+				advanceSidechain<Link>(VoutA, VoutB); //Feedback topology with implicit unit delay between the sidechain input and the output
 			}
-			else {
-				VoutLeft = VoutA;
-				VoutRight = VoutB;
-			}
-			if (hardClipOutput){
-				VoutLeft = BasicDSP::clipWithWarning(VoutLeft * outputGain, -1.0, 1.0);
-				VoutRight = BasicDSP::clipWithWarning(VoutRight * outputGain, -1.0, 1.0);
+			routeFrameOutputs<MidSide, HardClip>(VoutA, VoutB, *(VoutInterleaved + i), *(VoutInterleaved + j));
+		}
+	}
+	void selectProcessKernel() {
+		static const ProcessKernel kernels[16] = {
+			&Wavechild670::processKernel<false, false, false, false>, &Wavechild670::processKernel<false, false, false, true>, 
+			&Wavechild670::processKernel<false, false, true, false>, &Wavechild670::processKernel<false, false, true, true>, 
+			&Wavechild670::processKernel<false, true, false, false>, &Wavechild670::processKernel<false, true, false, true>, 
+			&Wavechild670::processKernel<false, true, true, false>, &Wavechild670::processKernel<false, true, true, true>, 
+			&Wavechild670::processKernel<true, false, false, false>, &Wavechild670::processKernel<true, false, false, true>, 
+			&Wavechild670::processKernel<true, false, true, false>, &Wavechild670::processKernel<true, false, true, true>, 
+			&Wavechild670::processKernel<true, true, false, false>, &Wavechild670::processKernel<true, true, false, true>, 
+			&Wavechild670::processKernel<true, true, true, false>, &Wavechild670::processKernel<true, true, true, true>};
+		selectedProcessKernel = kernels[8*isMidSide + 4*useFeedbackTopology + 2*hardClipOutput + sidechainLink];
+	}
+
+	template <bool MidSide>
+	void routeFrameInputs(Real VinputLeft, Real VinputRight, Real& VinputA, Real& VinputB) {
+		//Stereo or mid/side to the two channels, with their input levels
+		Assert(!isnan(VinputLeft));
+		Assert(!isnan(VinputRight));
+		if (MidSide) {
+			VinputA = (VinputLeft + VinputLeft)/sqrt2;
+			VinputB = (VinputRight - VinputRight)/sqrt2;
+		}
+		else {
+			VinputA = VinputLeft;
+			VinputB = VinputRight;
+		}
+		SCOPE("VinputA", VinputA);
+		SCOPE("VinputB", VinputB);
+		VinputA *= inputLevelA;
+		VinputB *= inputLevelB;
+	}
+	template <bool MidSide, bool HardClip>
+	void routeFrameOutputs(Real VoutA, Real VoutB, Real& VoutLeft, Real& VoutRight) {
+		//The two channels back to stereo, with the output gain and clipping
+		if (MidSide) {
+			VoutLeft = (VoutA + VoutB)/sqrt2;
+			VoutRight  = (VoutA - VoutB)/sqrt2;
+		}
+		else {
+			VoutLeft = VoutA;
+			VoutRight = VoutB;
+		}
+		if (HardClip){
+			VoutLeft = clipOutput(VoutLeft * outputGain);
+			VoutRight = clipOutput(VoutRight * outputGain);
+		}
+		else {
+			VoutLeft = VoutLeft * outputGain;
+			VoutRight = VoutRight * outputGain;
+		}
+		
+		SCOPE("VoutLeft", VoutLeft);
+		SCOPE("VoutRight", VoutRight);			
+	}
+	
+	Real clipOutput(Real Vout) {
+		//Constrains Vout to [-1, 1], counting the samples clipped for reportClipping()
+		if (Vout < -1.0 || Vout > 1.0) {
+			numClippedSamples++;
+			clipPeak = fmax(clipPeak, fabs(Vout));
+			return Vout < -1.0 ? -1.0 : 1.0;
+		}
+		return Vout;
+	}
+	
+	void advanceSignalAmplifiers(Real VinputA, Real VinputB, Real& VoutA, Real& VoutB) {
+		//Only the signal amplifiers run at the internal rate, the level capacitor voltage is held across the steps
+		upsampleSignalAmplifierInputs(VinputA, VinputB);
+		for (uint step = 0; step < getOversamplingFactor(); ++step){
+			if (useLockstepTubeSolver) {
+				//All four tube solves (push and pull for both channels) share each batched model evaluation
+				tubeLockstepSolver.clear();
+				signalAmplifierA.beginAdvance(oversampledA[step], VlevelCapA, tubeLockstepSolver);
+				signalAmplifierB.beginAdvance(oversampledB[step], VlevelCapB, tubeLockstepSolver);
+				tubeLockstepSolver.solve();
+				oversampledA[step] = signalAmplifierA.finishAdvance(tubeLockstepSolver);
+				oversampledB[step] = signalAmplifierB.finishAdvance(tubeLockstepSolver);
 			}
 			else {
-				VoutLeft = VoutLeft * outputGain;
-				VoutRight = VoutRight * outputGain;
+				oversampledA[step] = signalAmplifierA.advanceAndGetOutputVoltage(oversampledA[step], VlevelCapA);
+				oversampledB[step] = signalAmplifierB.advanceAndGetOutputVoltage(oversampledB[step], VlevelCapB);
 			}
-			
-			SCOPE("VoutLeft", VoutLeft);
-			SCOPE("VoutRight", VoutRight);			
-			
-			*(VoutInterleaved + i) = VoutLeft;
-			*(VoutInterleaved + j) = VoutRight;
 		}
+		downsampleSignalAmplifierOutputs(VoutA, VoutB);
 	}
-
-protected:
-	virtual void select670TimeConstants(uint tcA, uint tcB){
-		Assert(tcA >= 1);
-		Assert(tcA <= 6);
-		tcA -= 1;
-		levelTimeConstantCircuitA.updateRValues(levelTimeConstantCircuitComponentValues[tcA][0], levelTimeConstantCircuitComponentValues[tcA][1], levelTimeConstantCircuitComponentValues[tcA][2], levelTimeConstantCircuitComponentValues[tcA][3], levelTimeConstantCircuitComponentValues[tcA][4], levelTimeConstantCircuitComponentValues[tcA][5], sampleRate);
-		Assert(tcB >= 1);
-		Assert(tcB <= 6);
-		tcB -= 1;
-		levelTimeConstantCircuitA.updateRValues(levelTimeConstantCircuitComponentValues[tcB][0], levelTimeConstantCircuitComponentValues[tcB][1], levelTimeConstantCircuitComponentValues[tcB][2], levelTimeConstantCircuitComponentValues[tcB][3], levelTimeConstantCircuitComponentValues[tcB][4], levelTimeConstantCircuitComponentValues[tcB][5], sampleRate);
+	
+	void upsampleSignalAmplifierInputs(Real VinputA, Real VinputB) {
+		if (getOversamplingFactor() == 1) {
+			oversampledA[0] = VinputA;
+			oversampledB[0] = VinputB;
+		}
+		else {
+			oversamplerA.upsample(VinputA, oversampledA);
+			oversamplerB.upsample(VinputB, oversampledB);
+		}
+	}
+	void downsampleSignalAmplifierOutputs(Real& VoutA, Real& VoutB) {
+		if (getOversamplingFactor() == 1) {
+			VoutA = oversampledA[0];
+			VoutB = oversampledB[0];
+		}
+		else {
+			VoutA = oversamplerA.downsample(oversampledA);
+			VoutB = oversamplerB.downsample(oversampledB);
+		}
 	}
 
 	virtual void advanceSidechain(Real VinSidechainA, Real VinSidechainB) {
+		if (sidechainLink) {
+			advanceSidechain<true>(VinSidechainA, VinSidechainB);
+		}
+		else {
+			advanceSidechain<false>(VinSidechainA, VinSidechainB);
+		}
+	}
 	
-		Real sidechainCurrentA = sidechainAmplifierA.advanceAndGetCurrent(VinSidechainA, VlevelCapA);
-		Real sidechainCurrentB = sidechainAmplifierB.advanceAndGetCurrent(VinSidechainB, VlevelCapB);
+	template <bool Link>
+	void advanceSidechain(Real VinSidechainA, Real VinSidechainB) {
+		//LOG_SAMPLE1(VinSidechainA << "V " << VinSidechainB << "V ");
+		Real VgPlusA = sidechainAmplifierA.advanceInputCircuit(VinSidechainA);
+		Real VgPlusB = sidechainAmplifierB.advanceInputCircuit(VinSidechainB);
+		advanceSidechainFromVgPlus<Link>(VgPlusA, VgPlusB);
+	}
+	
+	template <bool Link>
+	void advanceSidechainFromVgPlus(Real VgPlusA, Real VgPlusB) {
+		//The sidechain after its input transformers
+		if (sidechainDecimation > 1) {
+			advanceDecimatedSidechain<Link>(VgPlusA, VgPlusB);
+			return;
+		}
+		Real sidechainCurrentA = sidechainAmplifierA.getCurrent(VgPlusA, VlevelCapA);
+		Real sidechainCurrentB = sidechainAmplifierB.getCurrent(VgPlusB, VlevelCapB);
+		advanceLevelTimeConstantCircuits<Link>(sidechainCurrentA, sidechainCurrentB, VlevelCapA, VlevelCapB);
+		SCOPE("VlevelCapA", VlevelCapA);
+		SCOPE("VlevelCapB", VlevelCapB);
+	}	
+
+	/* The sidechain at a control rate of sampleRate/sidechainDecimation. The input circuits (which high pass 
+	the sidechain signal) still run every sample, but the drive stage and level circuits only run once per 
+	control period. Decimating the drive stage's input directly would alias and miss peaks, so instead it 
+	is fed the peak of |VgPlus| over the period: the drive stage current depends only on |VgPlus| and grows 
+	with it, so this is the largest current any sample in the period would have produced. VlevelCap is 
+	linearly interpolated back to the sample rate, one control period behind. */
+	template <bool Link>
+	void advanceDecimatedSidechain(Real VgPlusA, Real VgPlusB) {
+		peakVgPlusA = std::max(peakVgPlusA, fabs(VgPlusA));
+		peakVgPlusB = std::max(peakVgPlusB, fabs(VgPlusB));
+		if (++sidechainPhase == sidechainDecimation) {
+			Real sidechainCurrentA = sidechainAmplifierA.getCurrent(peakVgPlusA, VlevelCapControlA);
+			Real sidechainCurrentB = sidechainAmplifierB.getCurrent(peakVgPlusB, VlevelCapControlB);
+			VlevelCapPreviousA = VlevelCapControlA;
+			VlevelCapPreviousB = VlevelCapControlB;
+			advanceLevelTimeConstantCircuits<Link>(sidechainCurrentA, sidechainCurrentB, VlevelCapControlA, VlevelCapControlB);
+			peakVgPlusA = 0.0;
+			peakVgPlusB = 0.0;
+			sidechainPhase = 0;
+		}
+		Real fraction = ((Real) (sidechainPhase + 1))/sidechainDecimation;
+		VlevelCapA = VlevelCapPreviousA + (VlevelCapControlA - VlevelCapPreviousA)*fraction;
+		VlevelCapB = VlevelCapPreviousB + (VlevelCapControlB - VlevelCapPreviousB)*fraction;
+		SCOPE("VlevelCapA", VlevelCapA);
+		SCOPE("VlevelCapB", VlevelCapB);
+	}
+
+	template <bool Link>
+	void advanceLevelTimeConstantCircuits(Real sidechainCurrentA, Real sidechainCurrentB, Real& VlevelCapAOut, Real& VlevelCapBOut) {
 		SCOPE("sidechainCurrentA", sidechainCurrentA);
 		SCOPE("sidechainCurrentB", sidechainCurrentA);
-		//LOG_SAMPLE1(VinSidechainA << "V " << VinSidechainB << "V ");
 		//LOG_SAMPLE1(sidechainCurrentA << "A " << sidechainCurrentB << "A ");
-		if (sidechainLink) {
+		if (Link) {
 			Real sidechainCurrentTotal = (sidechainCurrentA + sidechainCurrentB)/2.0;// #Effectively compute the two circuits in parallel, crude but effective (I haven't prove this is exactly right)
 			SCOPE("sidechainCurrentTotal", sidechainCurrentTotal);
 			Real VlevelCapAx = levelTimeConstantCircuitA.advance(sidechainCurrentTotal);
 			Real VlevelCapBx = levelTimeConstantCircuitB.advance(sidechainCurrentTotal); // #maintain the voltage in circuit B in case the user disengages the link
-			VlevelCapA = (VlevelCapAx + VlevelCapBx) / 2.0;
-			VlevelCapB = (VlevelCapAx + VlevelCapBx) / 2.0;
+			VlevelCapAOut = (VlevelCapAx + VlevelCapBx) / 2.0;
+			VlevelCapBOut = (VlevelCapAx + VlevelCapBx) / 2.0;
 		}
 		else {
-			VlevelCapA = levelTimeConstantCircuitA.advance(sidechainCurrentA);
-			VlevelCapB = levelTimeConstantCircuitB.advance(sidechainCurrentB);
+			VlevelCapAOut = levelTimeConstantCircuitA.advance(sidechainCurrentA);
+			VlevelCapBOut = levelTimeConstantCircuitB.advance(sidechainCurrentB);
 		}
-		SCOPE("VlevelCapA", VlevelCapA);
-		SCOPE("VlevelCapB", VlevelCapB);
-	}	
+	}
 
 protected:
 	Real sampleRate;
 	Real outputGain;
 	bool hardClipOutput;
+	ulong numClippedSamples; //Since the last reportClipping()
+	ulong totalClippedSamples;
+	Real clipPeak; //Of the samples clipped since the last reportClipping()
 	
 	Real VlevelCapA;
 	Real VlevelCapB;
+	uint sidechainDecimation;
+	uint sidechainPhase; //Samples since the last control rate update
+	Real peakVgPlusA; //Peak |VgPlus| since the last control rate update
+	Real peakVgPlusB;
+	Real VlevelCapControlA; //Level circuit voltages at the latest and previous control rate updates
+	Real VlevelCapControlB;
+	Real VlevelCapPreviousA;
+	Real VlevelCapPreviousB;
 
 	Real inputLevelA;
 	Real inputLevelB;
@@ -272,8 +585,16 @@ protected:
 	LevelTimeConstantCircuit levelTimeConstantCircuitB;
 	VariableMuAmplifier signalAmplifierA;
 	VariableMuAmplifier signalAmplifierB;
+	bool useLockstepTubeSolver;
+	TubeLockstepSolver tubeLockstepSolver;
+	Oversampler oversamplerA;
+	Oversampler oversamplerB;
+	Real oversampledA[OVERSAMPLING_MAX_FACTOR]; //Signal amplifier inputs, then outputs, of each step at the internal rate
+	Real oversampledB[OVERSAMPLING_MAX_FACTOR];
+	ProcessKernel selectedProcessKernel; //The instance of processKernel() for the current mode flags
 	
 	static const Real Wavechild670::levelTimeConstantCircuitComponentValues[6][6];
+	static const Real sqrt2;
 };
 
 
@@ -0,0 +1,249 @@
+/************************************************************************************
+* 
+* Wavechild670 v0.1 
+* 
+* wavechild670batch.cpp
+* 
+* By Peter Raffensperger 11 March 2014
+* 
+* Reference:
+* Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+* Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+* York, UK, September 17-21, 2012.
+* 
+* Note:
+* Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+* affiliated with the author.
+* 
+* License:
+* Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+* software in an academic context, we would appreciate it if you referenced the original
+* paper.
+* 
+************************************************************************************/
+
+
+
+
+#include "wavechild670batch.h"
+
+template <class LinearCircuit>
+static void ProbeStateSpace(LinearCircuit& circuit, Real (&A)[STATE_SPACE_ORDER][STATE_SPACE_ORDER], Real (&B)[STATE_SPACE_ORDER], Real (&C)[STATE_SPACE_ORDER], Real& D){
+	StateSpaceFilter filter = StateSpaceFilter::fromCircuit(circuit);
+	for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+		for (uint j = 0; j < STATE_SPACE_ORDER; ++j){
+			A[i][j] = filter.getA(i, j);
+		}
+		B[i] = filter.getB(i);
+		C[i] = filter.getC(i);
+	}
+	D = filter.getD();
+}
+
+static void ProbeTubeStage(TubeStageCircuit& stage, Wavechild670BatchCoefficients& c){
+	/*
+	Runs the stage one sample from the zero state with b = 0 for the offsets, then from each unit 
+	state and with a unit b for the rest, like StateSpaceFilter::fromCircuit(). The cathode 
+	capacitor connector between the push and pull stages is never advanced (see 
+	VariableMuAmplifier::saveState()), so each stage is a system on its own.
+	*/
+	const uint order = WAVECHILD670_BATCH_TUBE_STAGE_ORDER;
+	vector<Real> zeroState(order, 0.0);
+	stage.setState(zeroState);
+	c.tubeIncidentOffset = stage.getTubeIncidentWave();
+	c.stageOutputOffset = stage.setTubeReflectedWave(0.0);
+	vector<Real> offset = stage.getState();
+	for (uint i = 0; i < order; ++i){
+		c.stageOffset[i] = offset[i];
+	}
+	for (uint j = 0; j < order; ++j){
+		vector<Real> unitState(order, 0.0);
+		unitState[j] = 1.0;
+		stage.setState(unitState);
+		c.tubeIncident[j] = stage.getTubeIncidentWave() - c.tubeIncidentOffset;
+		c.stageC[j] = stage.setTubeReflectedWave(0.0) - c.stageOutputOffset;
+		vector<Real> column = stage.getState();
+		for (uint i = 0; i < order; ++i){
+			c.stageA[i][j] = column[i] - offset[i];
+		}
+	}
+	stage.setState(zeroState);
+	stage.getTubeIncidentWave();
+	c.stageD = stage.setTubeReflectedWave(1.0) - c.stageOutputOffset;
+	vector<Real> column = stage.getState();
+	for (uint i = 0; i < order; ++i){
+		c.stageB[i] = column[i] - offset[i];
+	}
+	c.tubePortResistance = stage.getTubePortResistance();
+}
+
+Wavechild670Batch::Wavechild670Batch(Real sampleRate_, vector<Wavechild670Parameters>& parameters_) : sampleRate(sampleRate_), parameters(parameters_) {
+	Assert(parameters.size() > 0);
+	for (uint lane = 0; lane < parameters.size(); ++lane){
+		Assert(isSupported(parameters[lane]));
+		Assert(parameters[lane].tubeSolverTolerance == parameters[0].tubeSolverTolerance);
+		Assert(parameters[lane].tubeSolverMaxIterations == parameters[0].tubeSolverMaxIterations);
+	}
+	
+	//The feedback lanes fill the first groups and the feedforward lanes the rest, so each group has one topology
+	laneGroups.resize(parameters.size());
+	laneSlots.resize(parameters.size());
+	totalClippedSamples.assign(parameters.size(), 0);
+	for (uint feedforward = 0; feedforward < 2; ++feedforward){
+		uint slot = WAVECHILD670_BATCH_GROUP_SIZE;
+		for (uint lane = 0; lane < parameters.size(); ++lane){
+			if (parameters[lane].useFeedbackTopology == (bool) feedforward) {
+				continue;
+			}
+			if (slot == WAVECHILD670_BATCH_GROUP_SIZE) {
+				Wavechild670BatchGroup group;
+				memset(&group, 0, sizeof(group));
+				for (uint i = 0; i < WAVECHILD670_BATCH_GROUP_SIZE; ++i){
+					group.lanes[i] = -1;
+				}
+				group.useFeedbackTopology = !feedforward;
+				groups.push_back(group);
+				slot = 0;
+			}
+			laneGroups[lane] = groups.size() - 1;
+			laneSlots[lane] = slot;
+			groups.back().lanes[slot] = lane;
+			++slot;
+		}
+	}
+	
+	for (uint lane = 0; lane < parameters.size(); ++lane){
+		Wavechild670 compressor(sampleRate, parameters[lane]);
+		if (lane == 0) {
+			loadCoefficients(compressor);
+		}
+		loadLane(lane, compressor);
+	}
+	LOG_INFO("Batch of " << parameters.size() << " lanes in " << groups.size() << " groups");
+}
+
+bool Wavechild670Batch::isSupported(const Wavechild670Parameters& parameters){
+	return parameters.oversamplingFactor == 1 && parameters.sidechainDecimation == 1 && parameters.tubeTableResolution == 0 && 
+		parameters.tubeSolutionTableResolution == 0 && parameters.tubeSolverPredictorOrder == 0;
+}
+
+void Wavechild670Batch::warmUp(Real warmUpTimeInSeconds){
+	for (uint lane = 0; lane < parameters.size(); ++lane){
+		Wavechild670 compressor(sampleRate, parameters[lane]);
+		compressor.warmUp(warmUpTimeInSeconds);
+		loadLane(lane, compressor);
+	}
+}
+
+void Wavechild670Batch::loadLane(uint lane, Wavechild670& compressor){
+	Assert(lane < parameters.size());
+	Wavechild670BatchGroup& group = groups[laneGroups[lane]];
+	loadSlot(group, laneSlots[lane], compressor);
+	if (laneSlots[lane] == 0) {
+		//The padding follows the group's first lane, so that it idles at a steady state
+		for (uint slot = 1; slot < WAVECHILD670_BATCH_GROUP_SIZE; ++slot){
+			if (group.lanes[slot] < 0) {
+				loadSlot(group, slot, compressor);
+			}
+		}
+	}
+}
+
+void Wavechild670Batch::loadCoefficients(Wavechild670& compressor){
+	Wavechild670BatchCoefficients& c = coefficients;
+	ProbeStateSpace(compressor.signalAmplifierA.inputCircuit, c.inputA, c.inputB, c.inputC, c.inputD);
+	ProbeStateSpace(compressor.sidechainAmplifierA.inputCircuit, c.sidechainInputA, c.sidechainInputB, c.sidechainInputC, c.sidechainInputD);
+	TubeStageCircuit stage(compressor.signalAmplifierA.tubeAmpPush); //A copy, probing it overwrites its state
+	ProbeTubeStage(stage, c);
+	c.numTubeParallelInstances = VariableMuAmplifier::numTubeParallelInstances;
+	c.VgateBias = VariableMuAmplifier::VgateBiasConst;
+	c.tube = TriodeRemoteCutoff6386::getKernelParameters();
+	c.tubeSolverTolerance = parameters[0].tubeSolverTolerance;
+	c.tubeSolverMaxIterations = parameters[0].tubeSolverMaxIterations;
+	
+	c.VscScaleFactor = SidechainAmplifier::VscScaleFactor;
+	c.overallVoltageGain = SidechainAmplifier::overallVoltageGain;
+	c.finalOutputClipVoltage = SidechainAmplifier::finalOutputClipVoltage;
+	c.diodeDropX2 = SidechainAmplifier::diodeDropX2;
+	c.nominalOutputConductance = SidechainAmplifier::nominalOutputConductance;
+	c.maxOutputCurrent = SidechainAmplifier::maxOutputCurrent;
+}
+
+void Wavechild670Batch::loadSlot(Wavechild670BatchGroup& group, uint slot, Wavechild670& compressor){
+	VariableMuAmplifier* signalAmplifiers[2] = {&compressor.signalAmplifierA, &compressor.signalAmplifierB};
+	SidechainAmplifier* sidechainAmplifiers[2] = {&compressor.sidechainAmplifierA, &compressor.sidechainAmplifierB};
+	LevelTimeConstantCircuit* levelCircuits[2] = {&compressor.levelTimeConstantCircuitA, &compressor.levelTimeConstantCircuitB};
+	Real VlevelCaps[2] = {compressor.VlevelCapA, compressor.VlevelCapB};
+	Real inputLevels[2] = {compressor.inputLevelA, compressor.inputLevelB};
+	for (uint channel = 0; channel < 2; ++channel){
+		VariableMuAmplifier& signalAmplifier = *signalAmplifiers[channel];
+		vector<Real> x = signalAmplifier.useStateSpaceInputCircuit ? signalAmplifier.inputCircuitStateSpace.getState() : signalAmplifier.inputCircuit.getState();
+		for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+			group.inputCircuit[channel][i][slot] = i < x.size() ? x[i] : 0.0;
+		}
+		TubeStageCircuit* stages[2] = {&signalAmplifier.tubeAmpPush, &signalAmplifier.tubeAmpPull};
+		for (uint side = 0; side < 2; ++side){
+			vector<Real> s = stages[side]->getState();
+			for (uint i = 0; i < WAVECHILD670_BATCH_TUBE_STAGE_ORDER; ++i){
+				group.tubeStage[2*channel + side][i][slot] = s[i];
+			}
+			WDFTubeInterface::State tube;
+			stages[side]->getTube().saveState(tube);
+			group.VakGuess[2*channel + side][slot] = tube.VakHistory[0]; //The order 0 predictor
+		}
+		
+		SidechainAmplifier& sidechainAmplifier = *sidechainAmplifiers[channel];
+		x = sidechainAmplifier.useStateSpaceInputCircuit ? sidechainAmplifier.inputCircuitStateSpace.getState() : sidechainAmplifier.inputCircuit.getState();
+		for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+			group.sidechainInputCircuit[channel][i][slot] = i < x.size() ? x[i] : 0.0;
+		}
+		group.ACThresholdProcessed[channel][slot] = sidechainAmplifier.ACThresholdProcessed;
+		group.DCThresholdProcessed[channel][slot] = sidechainAmplifier.DCThresholdProcessed;
+		
+		StateSpaceFilter levelCircuit = StateSpaceFilter::fromCircuit(*levelCircuits[channel]);
+		x = levelCircuit.getState();
+		for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+			for (uint j = 0; j < STATE_SPACE_ORDER; ++j){
+				group.levelA[channel][i][j][slot] = levelCircuit.getA(i, j);
+			}
+			group.levelB[channel][i][slot] = levelCircuit.getB(i);
+			group.levelC[channel][i][slot] = levelCircuit.getC(i);
+			group.levelCircuit[channel][i][slot] = x[i];
+		}
+		group.levelD[channel][slot] = levelCircuit.getD();
+		group.VlevelCap[channel][slot] = VlevelCaps[channel];
+		group.inputLevel[channel][slot] = inputLevels[channel];
+	}
+	group.outputGain[slot] = compressor.outputGain;
+	group.isMidSide[slot] = compressor.isMidSide;
+	group.hardClipOutput[slot] = compressor.hardClipOutput;
+	group.sidechainLink[slot] = compressor.sidechainLink ? 1.0 : 0.0;
+	group.numClippedSamples[slot] = 0;
+	group.clipPeak[slot] = 0.0;
+}
+
+void Wavechild670Batch::process(Real** VinputInterleaved, Real** VoutInterleaved, ulong numSamples){
+	Assert(VinputInterleaved);
+	Assert(VoutInterleaved);
+	//The same instruction set as the tube kernels, so setting theirs sets this too
+	Wavechild670BatchKernels::ProcessKernel kernel = Wavechild670BatchKernels::getProcessKernel(TriodeKernels::getInstructionSet());
+	Assert(kernel);
+	for (uint group = 0; group < groups.size(); ++group){
+		kernel(coefficients, groups[group], VinputInterleaved, VoutInterleaved, numSamples/2);
+	}
+	reportClipping(numSamples/2);
+}
+
+void Wavechild670Batch::reportClipping(ulong numFrames){
+	//As Wavechild670::reportClipping(), one warning per lane
+	for (uint lane = 0; lane < parameters.size(); ++lane){
+		Wavechild670BatchGroup& group = groups[laneGroups[lane]];
+		uint slot = laneSlots[lane];
+		if (group.numClippedSamples[slot] > 0) {
+			LOG_WARNING("Lane " << lane << " clipped " << group.numClippedSamples[slot] << " output samples in " << numFrames << " frames, peak " << group.clipPeak[slot]);
+			totalClippedSamples[lane] += group.numClippedSamples[slot];
+			group.numClippedSamples[slot] = 0;
+			group.clipPeak[slot] = 0.0;
+		}
+	}
+}
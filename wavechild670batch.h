@@ -0,0 +1,176 @@
+/************************************************************************************
+* 
+* Wavechild670 v0.1 
+* 
+* wavechild670batch.h
+* 
+* By Peter Raffensperger 11 March 2014
+* 
+* Reference:
+* Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+* Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+* York, UK, September 17-21, 2012.
+* 
+* Note:
+* Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+* affiliated with the author.
+* 
+* License:
+* Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+* software in an academic context, we would appreciate it if you referenced the original
+* paper.
+* 
+************************************************************************************/
+
+
+
+
+#ifndef WAVECHILD670BATCH_H
+#define WAVECHILD670BATCH_H
+
+#include "Misc.h"
+#include "wavechild670.h"
+#include "statespace.h"
+#include "triodekernels.h"
+
+#define WAVECHILD670_BATCH_GROUP_SIZE 8 //Lanes per group, as many as the widest vectors (AVX-512) hold
+#define WAVECHILD670_BATCH_TUBE_STAGE_ORDER 6 //TubeStageCircuit's states, Vcathode last
+
+struct Wavechild670BatchCoefficients {
+	/*
+	What every lane shares, read out of one compressor: all the circuits but the level circuits 
+	have fixed component values. The input transformers are state space filters (see 
+	StateSpaceFilter). A tube stage is affine in its state s, split at the tube like 
+	TubeStageCircuit: the tube's incident wave is a = tubeIncident.s + tubeIncidentOffset, and given 
+	the tube's reflected wave b, the output is Vout = stageC.s + stageD*b + stageOutputOffset and 
+	the next state stageA s + stageB*b + stageOffset.
+	*/
+	Real inputA[STATE_SPACE_ORDER][STATE_SPACE_ORDER];
+	Real inputB[STATE_SPACE_ORDER];
+	Real inputC[STATE_SPACE_ORDER];
+	Real inputD;
+	Real sidechainInputA[STATE_SPACE_ORDER][STATE_SPACE_ORDER];
+	Real sidechainInputB[STATE_SPACE_ORDER];
+	Real sidechainInputC[STATE_SPACE_ORDER];
+	Real sidechainInputD;
+	
+	Real tubeIncident[WAVECHILD670_BATCH_TUBE_STAGE_ORDER];
+	Real tubeIncidentOffset;
+	Real stageA[WAVECHILD670_BATCH_TUBE_STAGE_ORDER][WAVECHILD670_BATCH_TUBE_STAGE_ORDER];
+	Real stageB[WAVECHILD670_BATCH_TUBE_STAGE_ORDER];
+	Real stageOffset[WAVECHILD670_BATCH_TUBE_STAGE_ORDER];
+	Real stageC[WAVECHILD670_BATCH_TUBE_STAGE_ORDER];
+	Real stageD;
+	Real stageOutputOffset;
+	Real tubePortResistance;
+	Real numTubeParallelInstances;
+	Real VgateBias;
+	RemoteCutoffTriodeParameters tube;
+	Real tubeSolverTolerance;
+	uint tubeSolverMaxIterations;
+	
+	//The sidechain amplifier after its input transformer, see SidechainAmplifier::getCurrent()
+	Real VscScaleFactor;
+	Real overallVoltageGain;
+	Real finalOutputClipVoltage;
+	Real diodeDropX2;
+	Real nominalOutputConductance;
+	Real maxOutputCurrent;
+};
+
+struct Wavechild670BatchGroup {
+	/*
+	The settings and state of WAVECHILD670_BATCH_GROUP_SIZE lanes, with the lane as the last index 
+	of every array so that neighbouring lanes load as one vector. The first index is the channel 
+	(A then B) or the tube stage (A push, A pull, B push, B pull). All plain data.
+	*/
+	int lanes[WAVECHILD670_BATCH_GROUP_SIZE]; //The batch lane in each slot, -1 for padding, which runs on silence
+	bool useFeedbackTopology; //The same for every lane in the group
+	
+	//Settings
+	Real inputLevel[2][WAVECHILD670_BATCH_GROUP_SIZE];
+	Real outputGain[WAVECHILD670_BATCH_GROUP_SIZE];
+	bool isMidSide[WAVECHILD670_BATCH_GROUP_SIZE];
+	bool hardClipOutput[WAVECHILD670_BATCH_GROUP_SIZE];
+	Real sidechainLink[WAVECHILD670_BATCH_GROUP_SIZE]; //1 or 0
+	Real ACThresholdProcessed[2][WAVECHILD670_BATCH_GROUP_SIZE];
+	Real DCThresholdProcessed[2][WAVECHILD670_BATCH_GROUP_SIZE];
+	Real levelA[2][STATE_SPACE_ORDER][STATE_SPACE_ORDER][WAVECHILD670_BATCH_GROUP_SIZE]; //The level circuits depend on the time constant
+	Real levelB[2][STATE_SPACE_ORDER][WAVECHILD670_BATCH_GROUP_SIZE];
+	Real levelC[2][STATE_SPACE_ORDER][WAVECHILD670_BATCH_GROUP_SIZE];
+	Real levelD[2][WAVECHILD670_BATCH_GROUP_SIZE];
+	
+	//State
+	Real inputCircuit[2][STATE_SPACE_ORDER][WAVECHILD670_BATCH_GROUP_SIZE];
+	Real tubeStage[4][WAVECHILD670_BATCH_TUBE_STAGE_ORDER][WAVECHILD670_BATCH_GROUP_SIZE];
+	Real VakGuess[4][WAVECHILD670_BATCH_GROUP_SIZE];
+	Real sidechainInputCircuit[2][STATE_SPACE_ORDER][WAVECHILD670_BATCH_GROUP_SIZE];
+	Real levelCircuit[2][STATE_SPACE_ORDER][WAVECHILD670_BATCH_GROUP_SIZE];
+	Real VlevelCap[2][WAVECHILD670_BATCH_GROUP_SIZE];
+	ulong numClippedSamples[WAVECHILD670_BATCH_GROUP_SIZE]; //Since the last process()
+	Real clipPeak[WAVECHILD670_BATCH_GROUP_SIZE];
+};
+
+namespace Wavechild670BatchKernels {
+
+//Runs numFrames frames of every lane in the group, reading and writing each lane's interleaved stereo buffers
+typedef void (*ProcessKernel)(const Wavechild670BatchCoefficients& coefficients, Wavechild670BatchGroup& group, Real** VinputInterleaved, Real** VoutInterleaved, ulong numFrames);
+
+//NULL when the compiler couldn't target the instruction set, like the tube kernels
+ProcessKernel getProcessKernel(TriodeKernels::InstructionSet instructionSet);
+ProcessKernel getProcessKernelAVX2();
+ProcessKernel getProcessKernelAVX512();
+
+}
+
+class Wavechild670Batch {
+	/*
+	Renders many independent compressors at once, for offline jobs with lots of files. Each lane is 
+	a whole Wavechild670 with its own input, output, controls, topology and link setting, and the 
+	lanes are held structure of arrays in groups of WAVECHILD670_BATCH_GROUP_SIZE, so that every 
+	step of a frame runs on as many lanes as the CPU's vectors hold: 1, 2, 4 or 8 lanes, with the 
+	instruction set the tube kernels use (see TriodeKernels). The tube stages and transformers are 
+	run as the affine systems they are, read out of the generated WDFs (see 
+	Wavechild670BatchCoefficients), the four tubes of each lane are solved with the same 
+	safeguarded Newton iteration as WDFTubeInterface, with the lanes in lockstep, and the sidechain's 
+	nonlinear stages use the vectorised exp and log of vectormath.h. Lanes are grouped by topology, 
+	so each group runs one without masking.
+	
+	Each lane follows the Wavechild670 with its parameters to within rounding, amplified through the 
+	tube solves' tolerance (see TestBatch() in main.cpp). Only the simulation settings that the 
+	scalar compressor defaults to are supported: no oversampling or sidechain decimation, no tube 
+	tables and no solver predictor (see isSupported()), and every lane must use the same tube solver 
+	tolerance and iteration cap. There's no scope and no tube solver statistics.
+	*/
+public:
+	Wavechild670Batch(Real sampleRate_, vector<Wavechild670Parameters>& parameters_); //One lane per parameter set, each starting cold like a new Wavechild670
+	virtual ~Wavechild670Batch() {}
+	static bool isSupported(const Wavechild670Parameters& parameters);
+	
+	void warmUp(Real warmUpTimeInSeconds=0.5); //Each lane as Wavechild670::warmUp()
+	void loadLane(uint lane, Wavechild670& compressor); //Takes over the state of a compressor made with the lane's parameters
+	//One interleaved stereo buffer per lane, each numSamples long, a lane's input and output may be the same buffer
+	void process(Real** VinputInterleaved, Real** VoutInterleaved, ulong numSamples);
+	
+	uint getNumLanes() const { return parameters.size(); }
+	uint getNumGroups() const { return groups.size(); }
+	ulong getNumClippedSamples(uint lane) const { return totalClippedSamples[lane]; }
+
+protected:
+	void loadCoefficients(Wavechild670& compressor);
+	void loadSlot(Wavechild670BatchGroup& group, uint slot, Wavechild670& compressor);
+	void reportClipping(ulong numFrames);
+	
+	Real sampleRate;
+	vector<Wavechild670Parameters> parameters; //By lane
+	vector<uint> laneGroups; //The group and slot of each lane
+	vector<uint> laneSlots;
+	vector<ulong> totalClippedSamples;
+	Wavechild670BatchCoefficients coefficients;
+	vector<Wavechild670BatchGroup> groups;
+
+private:
+	Wavechild670Batch(const Wavechild670Batch& other) {}
+};
+
+#endif
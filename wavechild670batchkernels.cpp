@@ -0,0 +1,59 @@
+/************************************************************************************
+* 
+* Wavechild670 v0.1 
+* 
+* wavechild670batchkernels.cpp
+* 
+* By Peter Raffensperger 11 March 2014
+* 
+* Reference:
+* Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+* Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+* York, UK, September 17-21, 2012.
+* 
+* Note:
+* Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+* affiliated with the author.
+* 
+* License:
+* Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+* software in an academic context, we would appreciate it if you referenced the original
+* paper.
+* 
+************************************************************************************/
+
+
+
+
+#include "wavechild670batchkernels.h"
+
+namespace Wavechild670BatchKernels {
+
+static void processScalar(const Wavechild670BatchCoefficients& coefficients, Wavechild670BatchGroup& group, Real** VinputInterleaved, Real** VoutInterleaved, ulong numFrames){
+	Wavechild670BatchLanes<ScalarOps>::process(coefficients, group, VinputInterleaved, VoutInterleaved, numFrames);
+}
+
+#ifdef __SSE2__
+static void processSSE2(const Wavechild670BatchCoefficients& coefficients, Wavechild670BatchGroup& group, Real** VinputInterleaved, Real** VoutInterleaved, ulong numFrames){
+	Wavechild670BatchLanes<SSE2Ops>::process(coefficients, group, VinputInterleaved, VoutInterleaved, numFrames);
+}
+#endif
+
+ProcessKernel getProcessKernel(TriodeKernels::InstructionSet instructionSet){
+	switch (instructionSet) {
+	case TriodeKernels::INSTRUCTION_SET_SCALAR:
+		return processScalar;
+#ifdef __SSE2__
+	case TriodeKernels::INSTRUCTION_SET_SSE2:
+		return processSSE2;
+#endif
+	case TriodeKernels::INSTRUCTION_SET_AVX2:
+		return getProcessKernelAVX2();
+	case TriodeKernels::INSTRUCTION_SET_AVX512:
+		return getProcessKernelAVX512();
+	default:
+		return NULL;
+	}
+}
+
+}
@@ -0,0 +1,374 @@
+/************************************************************************************
+* 
+* Wavechild670 v0.1 
+* 
+* wavechild670batchkernels.h
+* 
+* By Peter Raffensperger 11 March 2014
+* 
+* Reference:
+* Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+* Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+* York, UK, September 17-21, 2012.
+* 
+* Note:
+* Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+* affiliated with the author.
+* 
+* License:
+* Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+* software in an academic context, we would appreciate it if you referenced the original
+* paper.
+* 
+************************************************************************************/
+
+
+
+
+#ifndef WAVECHILD670BATCHKERNELS_H
+#define WAVECHILD670BATCHKERNELS_H
+
+/*
+Wavechild670Batch's frame loop as a template on the Ops of vectormath.h, so that it runs Ops::width 
+lanes of a group at a time and every instruction set runs the same arithmetic. Like vectormath.h, 
+only include this from the translation units built for one instruction set, it's all in an unnamed 
+namespace. wavechild670batch.h is only needed for the layout of the coefficients and groups.
+*/
+
+#include "wavechild670batch.h"
+#include "vectormath.h"
+
+namespace {
+
+template <class Ops>
+struct Wavechild670BatchLanes {
+	typedef typename Ops::V V;
+	typedef typename Ops::Mask Mask;
+	typedef VectorMath<Ops> Math;
+	enum { width = Ops::width };
+	
+	static void process(const Wavechild670BatchCoefficients& c, Wavechild670BatchGroup& group, Real** VinputInterleaved, Real** VoutInterleaved, ulong numFrames){
+		for (uint offset = 0; offset < WAVECHILD670_BATCH_GROUP_SIZE; offset += width){
+			bool hasLane = false;
+			for (uint j = 0; j < width; ++j){
+				hasLane = hasLane || group.lanes[offset + j] >= 0;
+			}
+			if (!hasLane) {
+				continue; //All padding
+			}
+			if (group.useFeedbackTopology) {
+				processLanes<true>(c, group, offset, VinputInterleaved, VoutInterleaved, numFrames);
+			}
+			else {
+				processLanes<false>(c, group, offset, VinputInterleaved, VoutInterleaved, numFrames);
+			}
+		}
+	}
+	
+protected:
+	template <bool FeedbackTopology>
+	static void processLanes(const Wavechild670BatchCoefficients& c, Wavechild670BatchGroup& g, uint offset, Real** VinputInterleaved, Real** VoutInterleaved, ulong numFrames){
+		//Frame by frame as Wavechild670::processKernel(), with the state held in registers for the whole block
+		V inputCircuit[2][STATE_SPACE_ORDER];
+		V tubeStage[4][WAVECHILD670_BATCH_TUBE_STAGE_ORDER];
+		V VakGuess[4];
+		V sidechainInputCircuit[2][STATE_SPACE_ORDER];
+		V levelCircuit[2][STATE_SPACE_ORDER];
+		V VlevelCap[2];
+		for (uint channel = 0; channel < 2; ++channel){
+			for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+				inputCircuit[channel][i] = Ops::load(&g.inputCircuit[channel][i][offset]);
+				sidechainInputCircuit[channel][i] = Ops::load(&g.sidechainInputCircuit[channel][i][offset]);
+				levelCircuit[channel][i] = Ops::load(&g.levelCircuit[channel][i][offset]);
+			}
+			VlevelCap[channel] = Ops::load(&g.VlevelCap[channel][offset]);
+		}
+		for (uint stage = 0; stage < 4; ++stage){
+			for (uint i = 0; i < WAVECHILD670_BATCH_TUBE_STAGE_ORDER; ++i){
+				tubeStage[stage][i] = Ops::load(&g.tubeStage[stage][i][offset]);
+			}
+			VakGuess[stage] = Ops::load(&g.VakGuess[stage][offset]);
+		}
+		
+		Real VinputA[width];
+		Real VinputB[width];
+		Real VoutA[width];
+		Real VoutB[width];
+		for (ulong frame = 0; frame < numFrames; ++frame){
+			routeFrameInputs(g, offset, VinputInterleaved, frame, VinputA, VinputB);
+			V Vinput[2] = {Ops::load(VinputA), Ops::load(VinputB)};
+			if (!FeedbackTopology) {
+				advanceSidechain(c, g, offset, Vinput, sidechainInputCircuit, levelCircuit, VlevelCap);
+			}
+			V Vout[2];
+			advanceSignalAmplifiers(c, Vinput, VlevelCap, inputCircuit, tubeStage, VakGuess, Vout);
+			if (FeedbackTopology) {
+				advanceSidechain(c, g, offset, Vout, sidechainInputCircuit, levelCircuit, VlevelCap);
+			}
+			Ops::store(VoutA, Vout[0]);
+			Ops::store(VoutB, Vout[1]);
+			routeFrameOutputs(g, offset, VoutInterleaved, frame, VoutA, VoutB);
+		}
+		
+		for (uint channel = 0; channel < 2; ++channel){
+			for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+				Ops::store(&g.inputCircuit[channel][i][offset], inputCircuit[channel][i]);
+				Ops::store(&g.sidechainInputCircuit[channel][i][offset], sidechainInputCircuit[channel][i]);
+				Ops::store(&g.levelCircuit[channel][i][offset], levelCircuit[channel][i]);
+			}
+			Ops::store(&g.VlevelCap[channel][offset], VlevelCap[channel]);
+		}
+		for (uint stage = 0; stage < 4; ++stage){
+			for (uint i = 0; i < WAVECHILD670_BATCH_TUBE_STAGE_ORDER; ++i){
+				Ops::store(&g.tubeStage[stage][i][offset], tubeStage[stage][i]);
+			}
+			Ops::store(&g.VakGuess[stage][offset], VakGuess[stage]);
+		}
+	}
+	
+	static inline void routeFrameInputs(const Wavechild670BatchGroup& g, uint offset, Real** VinputInterleaved, ulong frame, Real* VinputA, Real* VinputB){
+		//Wavechild670::routeFrameInputs() for each lane
+		const Real sqrt2 = sqrt(2.0);
+		for (uint j = 0; j < width; ++j){
+			uint slot = offset + j;
+			int lane = g.lanes[slot];
+			if (lane < 0) {
+				VinputA[j] = 0.0;
+				VinputB[j] = 0.0;
+				continue;
+			}
+			Real VinputLeft = VinputInterleaved[lane][2*frame];
+			Real VinputRight = VinputInterleaved[lane][2*frame + 1];
+			if (g.isMidSide[slot]) {
+				VinputA[j] = (VinputLeft + VinputLeft)/sqrt2;
+				VinputB[j] = (VinputRight - VinputRight)/sqrt2;
+			}
+			else {
+				VinputA[j] = VinputLeft;
+				VinputB[j] = VinputRight;
+			}
+			VinputA[j] *= g.inputLevel[0][slot];
+			VinputB[j] *= g.inputLevel[1][slot];
+		}
+	}
+	static inline void routeFrameOutputs(Wavechild670BatchGroup& g, uint offset, Real** VoutInterleaved, ulong frame, const Real* VoutA, const Real* VoutB){
+		//Wavechild670::routeFrameOutputs() for each lane
+		const Real sqrt2 = sqrt(2.0);
+		for (uint j = 0; j < width; ++j){
+			uint slot = offset + j;
+			int lane = g.lanes[slot];
+			if (lane < 0) {
+				continue;
+			}
+			Real VoutLeft;
+			Real VoutRight;
+			if (g.isMidSide[slot]) {
+				VoutLeft = (VoutA[j] + VoutB[j])/sqrt2;
+				VoutRight = (VoutA[j] - VoutB[j])/sqrt2;
+			}
+			else {
+				VoutLeft = VoutA[j];
+				VoutRight = VoutB[j];
+			}
+			VoutLeft = VoutLeft * g.outputGain[slot];
+			VoutRight = VoutRight * g.outputGain[slot];
+			if (g.hardClipOutput[slot]) {
+				VoutLeft = clipOutput(g, slot, VoutLeft);
+				VoutRight = clipOutput(g, slot, VoutRight);
+			}
+			VoutInterleaved[lane][2*frame] = VoutLeft;
+			VoutInterleaved[lane][2*frame + 1] = VoutRight;
+		}
+	}
+	static inline Real clipOutput(Wavechild670BatchGroup& g, uint slot, Real Vout){
+		if (Vout < -1.0 || Vout > 1.0) {
+			g.numClippedSamples[slot]++;
+			g.clipPeak[slot] = fmax(g.clipPeak[slot], fabs(Vout));
+			return Vout < -1.0 ? -1.0 : 1.0;
+		}
+		return Vout;
+	}
+	
+	static inline V advanceStateSpace(const Real (&A)[STATE_SPACE_ORDER][STATE_SPACE_ORDER], const Real (&B)[STATE_SPACE_ORDER], const Real (&C)[STATE_SPACE_ORDER], Real D, V (&x)[STATE_SPACE_ORDER], V u){
+		//StateSpaceFilter::advance() with the same coefficients in every lane
+		V y = Ops::mul(Ops::set(D), u);
+		V xNext[STATE_SPACE_ORDER];
+		for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+			y = Ops::add(y, Ops::mul(Ops::set(C[i]), x[i]));
+			xNext[i] = Ops::mul(Ops::set(B[i]), u);
+			for (uint j = 0; j < STATE_SPACE_ORDER; ++j){
+				xNext[i] = Ops::add(xNext[i], Ops::mul(Ops::set(A[i][j]), x[j]));
+			}
+		}
+		for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+			x[i] = xNext[i];
+		}
+		return y;
+	}
+	static inline V advanceLevelCircuit(const Wavechild670BatchGroup& g, uint channel, uint offset, V (&x)[STATE_SPACE_ORDER], V u){
+		//advanceStateSpace() with each lane's own coefficients
+		V y = Ops::mul(Ops::load(&g.levelD[channel][offset]), u);
+		V xNext[STATE_SPACE_ORDER];
+		for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+			y = Ops::add(y, Ops::mul(Ops::load(&g.levelC[channel][i][offset]), x[i]));
+			xNext[i] = Ops::mul(Ops::load(&g.levelB[channel][i][offset]), u);
+			for (uint j = 0; j < STATE_SPACE_ORDER; ++j){
+				xNext[i] = Ops::add(xNext[i], Ops::mul(Ops::load(&g.levelA[channel][i][j][offset]), x[j]));
+			}
+		}
+		for (uint i = 0; i < STATE_SPACE_ORDER; ++i){
+			x[i] = xNext[i];
+		}
+		return y;
+	}
+	
+	static inline void advanceSignalAmplifiers(const Wavechild670BatchCoefficients& c, const V (&Vinput)[2], const V (&VlevelCap)[2], V (&inputCircuit)[2][STATE_SPACE_ORDER], 
+		V (&tubeStage)[4][WAVECHILD670_BATCH_TUBE_STAGE_ORDER], V (&VakGuess)[4], V (&Vout)[2]){
+		//VariableMuAmplifier::advanceAndGetOutputVoltage() for both channels
+		V a[4];
+		V Vgk[4];
+		for (uint channel = 0; channel < 2; ++channel){
+			V Vgate = advanceStateSpace(c.inputA, c.inputB, c.inputC, c.inputD, inputCircuit[channel], Vinput[channel]);
+			V VgateBiased = Ops::sub(Ops::set(c.VgateBias), VlevelCap[channel]);
+			V Vgrid[2] = {Ops::add(VgateBiased, Vgate), Ops::sub(VgateBiased, Vgate)}; //Push, pull
+			for (uint side = 0; side < 2; ++side){
+				uint stage = 2*channel + side;
+				a[stage] = Ops::set(c.tubeIncidentOffset);
+				for (uint i = 0; i < WAVECHILD670_BATCH_TUBE_STAGE_ORDER; ++i){
+					a[stage] = Ops::add(a[stage], Ops::mul(Ops::set(c.tubeIncident[i]), tubeStage[stage][i]));
+				}
+				Vgk[stage] = Ops::sub(Vgrid[side], tubeStage[stage][WAVECHILD670_BATCH_TUBE_STAGE_ORDER - 1]); //Less Vcathode
+			}
+		}
+		V b[4];
+		solveTubes(c, a, Vgk, VakGuess, b);
+		V VoutStage[4];
+		for (uint stage = 0; stage < 4; ++stage){
+			V* s = tubeStage[stage];
+			VoutStage[stage] = Ops::add(Ops::set(c.stageOutputOffset), Ops::mul(Ops::set(c.stageD), b[stage]));
+			V sNext[WAVECHILD670_BATCH_TUBE_STAGE_ORDER];
+			for (uint i = 0; i < WAVECHILD670_BATCH_TUBE_STAGE_ORDER; ++i){
+				VoutStage[stage] = Ops::add(VoutStage[stage], Ops::mul(Ops::set(c.stageC[i]), s[i]));
+				sNext[i] = Ops::add(Ops::set(c.stageOffset[i]), Ops::mul(Ops::set(c.stageB[i]), b[stage]));
+				for (uint j = 0; j < WAVECHILD670_BATCH_TUBE_STAGE_ORDER; ++j){
+					sNext[i] = Ops::add(sNext[i], Ops::mul(Ops::set(c.stageA[i][j]), s[j]));
+				}
+			}
+			for (uint i = 0; i < WAVECHILD670_BATCH_TUBE_STAGE_ORDER; ++i){
+				s[i] = sNext[i];
+			}
+		}
+		Vout[0] = Ops::sub(VoutStage[0], VoutStage[1]);
+		Vout[1] = Ops::sub(VoutStage[2], VoutStage[3]);
+	}
+	
+	static inline void solveTubes(const Wavechild670BatchCoefficients& c, const V (&a)[4], const V (&Vgk)[4], V (&VakGuess)[4], V (&b)[4]){
+		/*
+		WDFTubeInterface::getB() for all four tubes with the last solution as the guess: the same 
+		safeguarded Newton iteration as WDFTubeInterface::stepSolve(), with each lane's bracket, 
+		step and convergence test done with selects. A lane that has converged keeps its values 
+		while the rest carry on.
+		*/
+		const V zero = Ops::set(0.0);
+		const V one = Ops::set(1.0);
+		const V half = Ops::set(0.5);
+		const V r0 = Ops::set(c.tubePortResistance);
+		const V numParallelInstances = Ops::set(c.numTubeParallelInstances);
+		const V tolerance = Ops::set(c.tubeSolverTolerance);
+		V VakLow[4];
+		V VakHigh[4];
+		V Vak[4];
+		V Iak[4];
+		V converged[4]; //1 or 0
+		for (uint tube = 0; tube < 4; ++tube){
+			VakLow[tube] = Ops::min(a[tube], zero);
+			VakHigh[tube] = Ops::max(a[tube], zero);
+			Vak[tube] = Ops::min(Ops::max(VakGuess[tube], VakLow[tube]), VakHigh[tube]);
+			Iak[tube] = zero;
+			converged[tube] = zero;
+		}
+		for (uint iteration = 0; iteration < c.tubeSolverMaxIterations; ++iteration){
+			bool solving = false;
+			for (uint tube = 0; tube < 4; ++tube){
+				solving = solving || Ops::any(Ops::lessThan(converged[tube], half));
+			}
+			if (!solving) {
+				break;
+			}
+			for (uint tube = 0; tube < 4; ++tube){
+				V Ia;
+				V dIadVak;
+				VectorTriodeRemoteCutoff<Ops>::getIaAndDerivative(c.tube, Vgk[tube], Vak[tube], Ia, dIadVak);
+				V IakNew = Ops::mul(Ia, numParallelInstances);
+				V F = Ops::sub(Ops::add(Vak[tube], Ops::mul(r0, IakNew)), a[tube]);
+				V dFdVak = Ops::add(one, Ops::mul(Ops::mul(r0, dIadVak), numParallelInstances));
+				V VakNewton = Ops::sub(Vak[tube], Ops::div(F, dFdVak));
+				Mask below = Ops::lessThan(F, zero);
+				V VakLowNew = Ops::select(below, Vak[tube], VakLow[tube]);
+				V VakHighNew = Ops::select(below, VakHigh[tube], Vak[tube]);
+				V bisection = Ops::mul(half, Ops::add(VakLowNew, VakHighNew));
+				VakNewton = Ops::select(Ops::lessOrEqual(VakLowNew, VakNewton), VakNewton, bisection); //Also catches a non finite step
+				VakNewton = Ops::select(Ops::lessOrEqual(VakNewton, VakHighNew), VakNewton, bisection);
+				Mask done = Ops::lessOrEqual(Math::abs(Ops::sub(Vak[tube], VakNewton)), Ops::mul(tolerance, Math::abs(VakNewton)));
+				Mask stepping = Ops::lessThan(converged[tube], half);
+				VakLow[tube] = Ops::select(stepping, VakLowNew, VakLow[tube]);
+				VakHigh[tube] = Ops::select(stepping, VakHighNew, VakHigh[tube]);
+				Iak[tube] = Ops::select(stepping, IakNew, Iak[tube]);
+				Vak[tube] = Ops::select(stepping, VakNewton, Vak[tube]);
+				converged[tube] = Ops::select(done, one, converged[tube]);
+			}
+		}
+		for (uint tube = 0; tube < 4; ++tube){
+			b[tube] = Ops::sub(Vak[tube], Ops::mul(r0, Iak[tube]));
+			VakGuess[tube] = Vak[tube];
+		}
+	}
+	
+	static inline void advanceSidechain(const Wavechild670BatchCoefficients& c, const Wavechild670BatchGroup& g, uint offset, const V (&VinSidechain)[2], 
+		V (&sidechainInputCircuit)[2][STATE_SPACE_ORDER], V (&levelCircuit)[2][STATE_SPACE_ORDER], V (&VlevelCap)[2]){
+		//Wavechild670::advanceSidechain(), with the link as a select
+		V sidechainCurrent[2];
+		for (uint channel = 0; channel < 2; ++channel){
+			V VgPlus = Ops::mul(Ops::load(&g.ACThresholdProcessed[channel][offset]), 
+				advanceStateSpace(c.sidechainInputA, c.sidechainInputB, c.sidechainInputC, c.sidechainInputD, sidechainInputCircuit[channel], VinSidechain[channel]));
+			sidechainCurrent[channel] = getSidechainCurrent(c, VgPlus, VlevelCap[channel], Ops::load(&g.DCThresholdProcessed[channel][offset]));
+		}
+		const V two = Ops::set(2.0);
+		Mask link = Ops::lessThan(Ops::set(0.5), Ops::load(&g.sidechainLink[offset]));
+		V sidechainCurrentTotal = Ops::div(Ops::add(sidechainCurrent[0], sidechainCurrent[1]), two);
+		V VlevelCapNew[2];
+		for (uint channel = 0; channel < 2; ++channel){
+			VlevelCapNew[channel] = advanceLevelCircuit(g, channel, offset, levelCircuit[channel], Ops::select(link, sidechainCurrentTotal, sidechainCurrent[channel]));
+		}
+		V VlevelCapLinked = Ops::div(Ops::add(VlevelCapNew[0], VlevelCapNew[1]), two);
+		for (uint channel = 0; channel < 2; ++channel){
+			VlevelCap[channel] = Ops::select(link, VlevelCapLinked, VlevelCapNew[channel]);
+		}
+	}
+	
+	static inline V getSidechainCurrent(const Wavechild670BatchCoefficients& c, V VgPlus, V VlevelCap, V DCThresholdProcessed){
+		//SidechainAmplifier::getCurrent(), with log1p(exp(x)) from vectormath.h
+		const V zero = Ops::set(0.0);
+		const V ten = Ops::set(10.0);
+		V xp = Math::log1pExp(Ops::add(VgPlus, DCThresholdProcessed));
+		V xm = Math::log1pExp(Ops::add(Ops::sub(zero, VgPlus), DCThresholdProcessed));
+		V Vsc = Ops::mul(Ops::set(c.VscScaleFactor), Ops::sub(xp, xm));
+		V Vamp = Ops::mul(Vsc, Ops::set(c.overallVoltageGain));
+		Vamp = Ops::min(Ops::max(Vamp, Ops::set(-c.finalOutputClipVoltage)), Ops::set(c.finalOutputClipVoltage));
+		V Vdiff = Ops::sub(Math::abs(Vamp), VlevelCap);
+		
+		//Drive stage, SidechainAmplifier::diodeModel() and sidechainAmplifierCurrentSaturation()
+		const V diodeB = Ops::set(10.0/c.diodeDropX2);
+		V diode = Ops::div(Math::log1pExp(Ops::sub(Ops::mul(diodeB, Vdiff), ten)), diodeB);
+		diode = Ops::select(Ops::lessThan(Vdiff, Ops::set(20.0)), diode, Ops::sub(Vdiff, Ops::set(c.diodeDropX2)));
+		V current = Ops::mul(diode, Ops::set(c.nominalOutputConductance));
+		const V saturationB = Ops::set(10.0/c.maxOutputCurrent);
+		V isat = Ops::div(Math::log1pExp(Ops::sub(Ops::mul(saturationB, current), ten)), saturationB);
+		isat = Ops::min(isat, current);
+		return Ops::sub(current, isat);
+	}
+};
+
+}
+
+#endif
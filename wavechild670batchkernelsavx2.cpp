@@ -0,0 +1,51 @@
+/************************************************************************************
+* 
+* Wavechild670 v0.1 
+* 
+* wavechild670batchkernelsavx2.cpp
+* 
+* By Peter Raffensperger 11 March 2014
+* 
+* Reference:
+* Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+* Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+* York, UK, September 17-21, 2012.
+* 
+* Note:
+* Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+* affiliated with the author.
+* 
+* License:
+* Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+* software in an academic context, we would appreciate it if you referenced the original
+* paper.
+* 
+************************************************************************************/
+
+
+
+
+/*
+Built with -mavx2, see the Makefile. Nothing in here runs unless TriodeKernels has checked
+that the CPU supports it.
+*/
+
+#include "wavechild670batchkernels.h"
+
+namespace Wavechild670BatchKernels {
+
+#ifdef __AVX2__
+static void processAVX2(const Wavechild670BatchCoefficients& coefficients, Wavechild670BatchGroup& group, Real** VinputInterleaved, Real** VoutInterleaved, ulong numFrames){
+	Wavechild670BatchLanes<AVX2Ops>::process(coefficients, group, VinputInterleaved, VoutInterleaved, numFrames);
+}
+
+ProcessKernel getProcessKernelAVX2(){
+	return processAVX2;
+}
+#else
+ProcessKernel getProcessKernelAVX2(){
+	return NULL;
+}
+#endif
+
+}
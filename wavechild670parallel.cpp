@@ -0,0 +1,175 @@
+/************************************************************************************
+* 
+* Wavechild670 v0.1 
+* 
+* wavechild670parallel.cpp
+* 
+* By Peter Raffensperger 11 March 2014
+* 
+* Reference:
+* Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+* Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+* York, UK, September 17-21, 2012.
+* 
+* Note:
+* Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+* affiliated with the author.
+* 
+* License:
+* Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+* software in an academic context, we would appreciate it if you referenced the original
+* paper.
+* 
+************************************************************************************/
+
+
+
+
+#include "wavechild670parallel.h"
+
+Wavechild670ParallelRenderer::Wavechild670ParallelRenderer(Real sampleRate_, Wavechild670Parameters& parameters, uint numThreads, 
+	Real overlapTimeInSeconds, Real crossfadeTimeInSeconds, Real maxSeamDeviationInVolts) : sampleRate(sampleRate_), 
+	overlapTime(overlapTimeInSeconds), crossfadeTime(crossfadeTimeInSeconds), maxSeamDeviation(maxSeamDeviationInVolts) {
+	Assert(numThreads >= 1);
+	Assert(crossfadeTime <= overlapTime);
+	//All on this thread, the compressors register their scope probes as they're constructed
+	for (uint i = 0; i < numThreads; ++i){
+		instances.push_back(new Wavechild670(sampleRate, parameters));
+	}
+	instances[0]->saveState(warmState);
+}
+
+Wavechild670ParallelRenderer::~Wavechild670ParallelRenderer(){
+	for (uint i = 0; i < instances.size(); ++i){
+		delete instances[i];
+	}
+}
+
+void Wavechild670ParallelRenderer::warmUp(Real warmUpTimeInSeconds){
+	//Once, then every chunk starts from the same state
+	instances[0]->warmUp(warmUpTimeInSeconds);
+	instances[0]->saveState(warmState);
+}
+
+void Wavechild670ParallelRenderer::setWarmState(const Wavechild670::State& state){
+	warmState = state;
+}
+
+Real Wavechild670ParallelRenderer::getMaxSeamDeviation() const {
+	Real maxDeviation = 0.0;
+	for (uint k = 0; k < seamDeviations.size(); ++k){
+		maxDeviation = max(maxDeviation, seamDeviations[k]);
+	}
+	return maxDeviation;
+}
+
+uint Wavechild670ParallelRenderer::getNumRerenderedChunks() const {
+	return (uint) count(seamRerendered.begin(), seamRerendered.end(), true);
+}
+
+void Wavechild670ParallelRenderer::process(Real* VinputInterleaved, Real* VoutInterleaved, ulong numSamples){
+	Assert(VinputInterleaved);
+	Assert(VoutInterleaved);
+	Assert(VinputInterleaved != VoutInterleaved);
+	ulong numFrames = numSamples/2;
+	ulong overlapFrames = (ulong) (overlapTime*sampleRate);
+	ulong crossfadeFrames = (ulong) (crossfadeTime*sampleRate);
+	//No more chunks than leave each one at least a crossfade long
+	uint numChunks = instances.size();
+	if (crossfadeFrames > 0) {
+		numChunks = (uint) min((ulong) numChunks, max((ulong) 1, numFrames/crossfadeFrames));
+	}
+	
+	vector<Chunk> chunks(numChunks);
+	vector<pthread_t> threads(numChunks);
+	vector<bool> threadStarted(numChunks, false);
+	for (uint k = 0; k < numChunks; ++k){
+		Chunk& chunk = chunks[k];
+		chunk.compressor = instances[k];
+		chunk.compressor->loadState(warmState);
+		chunk.input = VinputInterleaved;
+		chunk.output = VoutInterleaved;
+		chunk.startFrame = k*numFrames/numChunks;
+		chunk.endFrame = (k + 1)*numFrames/numChunks;
+		chunk.numPrerollFrames = min(overlapFrames, chunk.startFrame);
+		chunk.crossfadeFrames = min(crossfadeFrames, chunk.numPrerollFrames);
+		chunk.crossfade = new Real[2*chunk.crossfadeFrames + 1];
+		if (k > 0) {
+			threadStarted[k] = pthread_create(&threads[k], NULL, renderChunk, &chunk) == 0;
+			if (!threadStarted[k]) {
+				LOG_ERROR("Couldn't start a thread for chunk " << k << ", rendering it on this one instead");
+			}
+		}
+	}
+	renderChunk(&chunks[0]); //On this thread
+	for (uint k = 1; k < numChunks; ++k){
+		if (threadStarted[k]) {
+			pthread_join(threads[k], NULL);
+		}
+		else {
+			renderChunk(&chunks[k]);
+		}
+	}
+	
+	//Each chunk's pre-roll fades in over the end of the chunk before. Where they overlap the two 
+	//renders of the same input differ by about as much as the chunk's pre-roll left it off the 
+	//serial render, which is the seam's deviation estimate. A chunk too far off is rendered again 
+	//carrying on from the chunk before, as the serial render would.
+	seamTimes.resize(numChunks - 1);
+	seamDeviations.assign(numChunks - 1, 0.0);
+	seamRerendered.assign(numChunks - 1, false);
+	for (uint k = 1; k < numChunks; ++k){
+		const Chunk& chunk = chunks[k];
+		Real* output = VoutInterleaved + 2*(chunk.startFrame - chunk.crossfadeFrames);
+		seamTimes[k - 1] = chunk.startFrame/sampleRate;
+		for (ulong i = 0; i < 2*chunk.crossfadeFrames; ++i){
+			seamDeviations[k - 1] = max(seamDeviations[k - 1], fabs(chunk.crossfade[i] - output[i]));
+		}
+		if (seamDeviations[k - 1] > maxSeamDeviation) {
+			Wavechild670::State state;
+			chunks[k - 1].compressor->saveState(state);
+			chunk.compressor->loadState(state);
+			ulong start = 2*chunk.startFrame;
+			chunk.compressor->process(chunk.input + start, chunk.output + start, 2*chunk.endFrame - start);
+			seamRerendered[k - 1] = true;
+			continue;
+		}
+		for (ulong i = 0; i < chunk.crossfadeFrames; ++i){
+			Real fadeIn = (i + 0.5)/chunk.crossfadeFrames;
+			output[2*i] += fadeIn*(chunk.crossfade[2*i] - output[2*i]);
+			output[2*i + 1] += fadeIn*(chunk.crossfade[2*i + 1] - output[2*i + 1]);
+		}
+	}
+	for (uint k = 0; k < numChunks; ++k){
+		delete[] chunks[k].crossfade;
+	}
+}
+
+void* Wavechild670ParallelRenderer::renderChunk(void* chunk_){
+	Chunk& chunk = *((Chunk*) chunk_);
+	//The pre-roll output is thrown away apart from the crossfade at its end
+	ulong numPrerollSamples = 2*chunk.numPrerollFrames;
+	Real* preroll = new Real[numPrerollSamples + 1];
+	chunk.compressor->process(chunk.input + 2*(chunk.startFrame - chunk.numPrerollFrames), preroll, numPrerollSamples);
+	memcpy(chunk.crossfade, preroll + numPrerollSamples - 2*chunk.crossfadeFrames, 2*chunk.crossfadeFrames*sizeof(Real));
+	delete[] preroll;
+	ulong start = 2*chunk.startFrame;
+	chunk.compressor->process(chunk.input + start, chunk.output + start, 2*chunk.endFrame - start);
+	return NULL;
+}
+
+TubeSolverStatistics Wavechild670ParallelRenderer::getTubeSolverStatistics(){
+	TubeSolverStatistics statistics;
+	for (uint i = 0; i < instances.size(); ++i){
+		statistics.add(instances[i]->getTubeSolverStatistics());
+	}
+	return statistics;
+}
+
+ulong Wavechild670ParallelRenderer::getNumClippedSamples() const {
+	ulong numClippedSamples = 0;
+	for (uint i = 0; i < instances.size(); ++i){
+		numClippedSamples += instances[i]->getNumClippedSamples();
+	}
+	return numClippedSamples;
+}
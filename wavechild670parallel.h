@@ -0,0 +1,110 @@
+/************************************************************************************
+* 
+* Wavechild670 v0.1 
+* 
+* wavechild670parallel.h
+* 
+* By Peter Raffensperger 11 March 2014
+* 
+* Reference:
+* Toward a Wave Digital Filter Model of the Fairchild 670 Limiter, Raffensperger, P. A., (2012). 
+* Proc. of the 15th International Conference on Digital Audio Effects (DAFx-12), 
+* York, UK, September 17-21, 2012.
+* 
+* Note:
+* Fairchild (R) a registered trademark of Avid Technology, Inc., which is in no way associated or 
+* affiliated with the author.
+* 
+* License:
+* Wavechild670 is licensed under the GNU GPL v2 license. If you use this
+* software in an academic context, we would appreciate it if you referenced the original
+* paper.
+* 
+************************************************************************************/
+
+
+
+#ifndef WAVECHILD670PARALLEL_H
+#define WAVECHILD670PARALLEL_H
+
+#include "Misc.h"
+#include "wavechild670.h"
+#include <pthread.h>
+
+#define WAVECHILD670_PARALLEL_DEFAULT_OVERLAP_TIME 2.0 //Seconds of pre-roll before each chunk
+#define WAVECHILD670_PARALLEL_DEFAULT_CROSSFADE_TIME 0.05 //Seconds, the end of each chunk's pre-roll
+/*
+Volts, -78dBm: over 80dB below the +4dBm operating level, so buried under the programme. A seam 
+estimated to be further off than this is rendered again serially.
+*/
+#define WAVECHILD670_PARALLEL_DEFAULT_MAX_SEAM_DEVIATION 1e-4
+
+class Wavechild670ParallelRenderer {
+	/*
+	Renders a whole file held in memory on several threads, for offline jobs. The file is cut into 
+	one chunk per thread and each chunk gets its own compressor. Every compressor starts from the 
+	same warmed up state, then runs over the overlapTime seconds of input before its chunk so that 
+	the level capacitor voltages and the tubes settle to about where the serial render would have 
+	them. The last crossfadeTime seconds of that pre-roll are faded in over the end of the chunk 
+	before, to hide what difference is left.
+	
+	Each process() renders a whole file from the state left by warmUp() or setWarmState(). The first 
+	chunk is exactly the serial render. The rest are only as close as the pre-roll lets 
+	them get: the longer release time constants need a longer overlapTime. How far off each seam is 
+	gets estimated from the crossfade, where both renders of the same input are at hand, without 
+	needing the serial render to compare against. Any chunk estimated to be more than 
+	maxSeamDeviation off is rendered again from where the chunk before left off, which is as close 
+	as the chunk before but costs the time of a serial render of that chunk. 
+	
+	The scope isn't thread safe, so it should be off and not tracing or armed during process().
+	*/
+public:
+	Wavechild670ParallelRenderer(Real sampleRate_, Wavechild670Parameters& parameters, uint numThreads_, 
+		Real overlapTimeInSeconds=WAVECHILD670_PARALLEL_DEFAULT_OVERLAP_TIME, Real crossfadeTimeInSeconds=WAVECHILD670_PARALLEL_DEFAULT_CROSSFADE_TIME, 
+		Real maxSeamDeviationInVolts=WAVECHILD670_PARALLEL_DEFAULT_MAX_SEAM_DEVIATION);
+	virtual ~Wavechild670ParallelRenderer();
+	
+	void warmUp(Real warmUpTimeInSeconds=0.5);
+	void setWarmState(const Wavechild670::State& state); //Instead of warmUp(), e.g. from the operating point or a cache
+	//Interleaved stereo, the input and output must be different buffers
+	void process(Real* VinputInterleaved, Real* VoutInterleaved, ulong numSamples);
+	
+	uint getNumThreads() const { return instances.size(); }
+	TubeSolverStatistics getTubeSolverStatistics();
+	ulong getNumClippedSamples() const; //Including any in the pre-rolls
+	//From the last process(), one for the start of each chunk after the first
+	uint getNumSeams() const { return seamDeviations.size(); }
+	Real getSeamTime(uint seam) const { return seamTimes[seam]; } //Seconds into the file
+	Real getSeamDeviation(uint seam) const { return seamDeviations[seam]; } //Volts, estimated before any rerender
+	bool wasSeamRerendered(uint seam) const { return seamRerendered[seam]; }
+	Real getMaxSeamDeviation() const;
+	uint getNumRerenderedChunks() const;
+
+protected:
+	struct Chunk {
+		Wavechild670* compressor;
+		Real* input;
+		Real* output;
+		ulong startFrame;
+		ulong endFrame;
+		ulong numPrerollFrames;
+		Real* crossfade; //Output of the end of the pre-roll, crossfadeFrames of it
+		ulong crossfadeFrames;
+	};
+	static void* renderChunk(void* chunk);
+	
+	Real sampleRate;
+	Real overlapTime;
+	Real crossfadeTime;
+	Real maxSeamDeviation;
+	vector<Wavechild670*> instances; //One per thread
+	Wavechild670::State warmState;
+	vector<Real> seamTimes;
+	vector<Real> seamDeviations; //Largest difference between the chunk's pre-roll and the chunk before
+	vector<bool> seamRerendered;
+
+private:
+	Wavechild670ParallelRenderer(const Wavechild670ParallelRenderer& other) {}
+};
+
+#endif
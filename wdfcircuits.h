@@ -131,6 +131,7 @@ public:
 		Assert(tubeSeriesConn2_3Gamma1 >= 0.0 && tubeSeriesConn2_3Gamma1 <= 1.0);
 		cathodeCapacitorConn = cathodeCapacitorConn_;
 		tubeR = tubeSeriesConn2_3R;
+		tube.setPortResistance(tubeR);
 		LOG_INFO(" ");
 		LOG_INFO("outputParallelConn_3Gamma1=" << outputParallelConn_3Gamma1);
 		LOG_INFO("cathodeCapSeriesConn_3Gamma1=" << cathodeCapSeriesConn_3Gamma1);
@@ -148,16 +149,26 @@ public:
 	}
 
 	Real advance(Real vgate){
+		Real b = tube.getB(getTubeIncidentWave(), tubeR, vgate, Vcathode);
+		return setTubeReflectedWave(b);
+	}
+	
+	/*
+	advance() split at the tube, so that several stages can solve their tubes together. 
+	getTubeIncidentWave() propagates the waves up to the tube and setTubeReflectedWave(b) finishes 
+	the sample with the tube's reflected wave, returning the output voltage.
+	*/
+	Real getTubeIncidentWave(){
 		//Get Bs
 		//tubeSeriesConn2_3GetB
 		//tubeSeriesConn1_3GetB
 		//primaryInputSeriesConn_3GetB
 		//primarySeriesConn2_3GetB
-		Real Lpb = -Lpa;
+		Lpb = -Lpa;
 		//primarySeriesConn2_1SetA
 		//RpGetB
 		//primarySeriesConn2_2SetA
-		Real primarySeriesConn2_3b3 = -(Lpb);
+		primarySeriesConn2_3b3 = -(Lpb);
 		//primaryInputSeriesConn_1SetA
 		//primaryParallelConn1_3GetB
 		//transformerGetB
@@ -168,51 +179,55 @@ public:
 		//outputParallelConn_1SetA
 		//RsidechainGetB
 		//outputParallelConn_2SetA
-		Real outputParallelConn_3b3 = -outputParallelConn_3Gamma1*(0.0);
+		outputParallelConn_3b3 = -outputParallelConn_3Gamma1*(0.0);
 		//secondaryOutputParallelConn_1SetA
-		Real Cwb = Cwa;
+		Cwb = Cwa;
 		//secondaryOutputParallelConn_2SetA
-		Real secondaryOutputParallelConn_3b3 = Cwb - secondaryOutputParallelConn_3Gamma1*(Cwb - outputParallelConn_3b3);
+		secondaryOutputParallelConn_3b3 = Cwb - secondaryOutputParallelConn_3Gamma1*(Cwb - outputParallelConn_3b3);
 		//secondarySeriesConn1_1SetA
 		//secondarySeriesConn2_3GetB
 		//RsGetB
 		//secondarySeriesConn2_1SetA
-		Real Lsb = -Lsa;
+		Lsb = -Lsa;
 		//secondarySeriesConn2_2SetA
-		Real secondarySeriesConn2_3b3 = -(Lsb);
+		secondarySeriesConn2_3b3 = -(Lsb);
 		//secondarySeriesConn1_2SetA
-		Real secondarySeriesConn1_3b3 = -(secondaryOutputParallelConn_3b3 + secondarySeriesConn2_3b3);
+		secondarySeriesConn1_3b3 = -(secondaryOutputParallelConn_3b3 + secondarySeriesConn2_3b3);
 		//primaryParallelConn1_1SetA
 		//primaryParallelConn2_3GetB
-		Real Lmb = -Lma;
+		Lmb = -Lma;
 		//primaryParallelConn2_1SetA
 		//RcGetB
 		//primaryParallelConn2_2SetA
-		Real primaryParallelConn2_3b3 = -primaryParallelConn2_3Gamma1*(-Lmb);
+		primaryParallelConn2_3b3 = -primaryParallelConn2_3Gamma1*(-Lmb);
 		//primaryParallelConn1_2SetA
-		Real primaryParallelConn1_3b3 = primaryParallelConn2_3b3 - primaryParallelConn1_3Gamma1*(primaryParallelConn2_3b3 - secondarySeriesConn1_3b3*transformerOneOvern);
+		primaryParallelConn1_3b3 = primaryParallelConn2_3b3 - primaryParallelConn1_3Gamma1*(primaryParallelConn2_3b3 - secondarySeriesConn1_3b3*transformerOneOvern);
 		//primaryInputSeriesConn_2SetA
-		Real primaryInputSeriesConn_3b3 = -(primarySeriesConn2_3b3 + primaryParallelConn1_3b3);
+		primaryInputSeriesConn_3b3 = -(primarySeriesConn2_3b3 + primaryParallelConn1_3b3);
 		//tubeSeriesConn1_1SetA
 		//VplateGetB
 		//tubeSeriesConn1_2SetA
-		Real tubeSeriesConn1_3b3 = -(primaryInputSeriesConn_3b3 + VplateE);
+		tubeSeriesConn1_3b3 = -(primaryInputSeriesConn_3b3 + VplateE);
 		//tubeSeriesConn2_1SetA
 		//cathodeParallelConn_3GetB
 		//VcathodeBiasGetB
 		//cathodeParallelConn_1SetA
 		//cathodeCapSeriesConn_3GetB
-		Real Ccathodeb = Ccathodea;
+		Ccathodeb = Ccathodea;
 		//cathodeCapSeriesConn_1SetA
 		//cathodeCapacitorConnGetB
 		//cathodeCapSeriesConn_2SetA
-		Real cathodeCapSeriesConn_3b3 = -(Ccathodeb + cathodeCapacitorConn->getB());
+		cathodeCapSeriesConn_3b3 = -(Ccathodeb + cathodeCapacitorConn->getB());
 		//cathodeParallelConn_2SetA
-		Real cathodeParallelConn_3b3 = cathodeCapSeriesConn_3b3 - cathodeParallelConn_3Gamma1*(cathodeCapSeriesConn_3b3 - VcathodeBiasE);
+		cathodeParallelConn_3b3 = cathodeCapSeriesConn_3b3 - cathodeParallelConn_3Gamma1*(cathodeCapSeriesConn_3b3 - VcathodeBiasE);
 		//tubeSeriesConn2_2SetA
-		Real tubeSeriesConn2_3b3 = -(tubeSeriesConn1_3b3 + cathodeParallelConn_3b3);
-		//Call tube model
-		Real b = tube.getB(tubeSeriesConn2_3b3, tubeR, vgate, Vcathode);
+		tubeSeriesConn2_3b3 = -(tubeSeriesConn1_3b3 + cathodeParallelConn_3b3);
+		return tubeSeriesConn2_3b3;
+	}
+	Real getTubePortResistance() const { return tubeR; }
+	Real getVcathode() const { return Vcathode; }
+	
+	Real setTubeReflectedWave(Real b){
 		SCOPE("Vak", -(tubeSeriesConn2_3b3 + b));
 		SCOPE("VplateE", VplateE);
 		//Set As
@@ -283,6 +298,33 @@ public:
 		Cwa = state[4];
 		Vcathode = state[5];
 	}
+
+	struct State {
+		Real Ccathodea;
+		Real Lpa;
+		Real Lma;
+		Real Lsa;
+		Real Cwa;
+		Real Vcathode;
+	};
+	void saveState(State& state) const {
+		state.Ccathodea = Ccathodea;
+		state.Lpa = Lpa;
+		state.Lma = Lma;
+		state.Lsa = Lsa;
+		state.Cwa = Cwa;
+		state.Vcathode = Vcathode;
+	}
+	void loadState(const State& state) {
+		Ccathodea = state.Ccathodea;
+		Lpa = state.Lpa;
+		Lma = state.Lma;
+		Lsa = state.Lsa;
+		Cwa = state.Cwa;
+		Vcathode = state.Vcathode;
+	}
+	WDFTubeInterface& getTube() { return tube; }
+	const WDFTubeInterface& getTube() const { return tube; }
 private:
 	//State variables
 	Real Ccathodea;
@@ -311,6 +353,24 @@ private:
 	Real primaryParallelConn2_3Gamma1;
 	Real primaryParallelConn1_3Gamma1;
 	Real tubeR;
+	//Waves held between getTubeIncidentWave and setTubeReflectedWave
+	Real Lpb;
+	Real primarySeriesConn2_3b3;
+	Real outputParallelConn_3b3;
+	Real Cwb;
+	Real secondaryOutputParallelConn_3b3;
+	Real Lsb;
+	Real secondarySeriesConn2_3b3;
+	Real secondarySeriesConn1_3b3;
+	Real Lmb;
+	Real primaryParallelConn2_3b3;
+	Real primaryParallelConn1_3b3;
+	Real primaryInputSeriesConn_3b3;
+	Real tubeSeriesConn1_3b3;
+	Real Ccathodeb;
+	Real cathodeCapSeriesConn_3b3;
+	Real cathodeParallelConn_3b3;
+	Real tubeSeriesConn2_3b3;
 	//Extra members
 	WDFTubeInterface tube;
 };
@@ -489,6 +549,25 @@ public:
 		Lsa = state[2];
 		Cwa = state[3];
 	}
+
+	struct State {
+		Real Lpa;
+		Real Lma;
+		Real Lsa;
+		Real Cwa;
+	};
+	void saveState(State& state) const {
+		state.Lpa = Lpa;
+		state.Lma = Lma;
+		state.Lsa = Lsa;
+		state.Cwa = Cwa;
+	}
+	void loadState(const State& state) {
+		Lpa = state.Lpa;
+		Lma = state.Lma;
+		Lsa = state.Lsa;
+		Cwa = state.Cwa;
+	}
 private:
 	//State variables
 	Real Lpa;
@@ -630,6 +709,22 @@ public:
 		C2a = state[1];
 		C3a = state[2];
 	}
+
+	struct State {
+		Real C1a;
+		Real C2a;
+		Real C3a;
+	};
+	void saveState(State& state) const {
+		state.C1a = C1a;
+		state.C2a = C2a;
+		state.C3a = C3a;
+	}
+	void loadState(const State& state) {
+		C1a = state.C1a;
+		C2a = state.C2a;
+		C3a = state.C3a;
+	}
 private:
 	//State variables
 	Real C1a;
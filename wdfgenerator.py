@@ -160,6 +160,8 @@ class Generator():
 		masterCode += '\t' + self.GetHeader('advance', self.inputs, type='Real ') + self.code +  self.output + '\t}\n'
 		masterCode += self.MakeGetStateFunction()
 		masterCode += self.MakeSetStateFunction()
+		masterCode += self.MakeSaveStateFunction()
+		masterCode += self.MakeLoadStateFunction()
 		masterCode += 'private:\n'
 		masterCode += '\t//State variables\n'
 		for sV in self.stateVariables:
@@ -236,6 +238,22 @@ class Generator():
 			setstatefn += '\t\t' + sV + ' = state[' + str(i) + '];\n'
 		setstatefn += '\t}\n'
 		return setstatefn
+	def MakeSaveStateFunction(self):
+		savestatefn = '\n\t' + 'struct State {\n'
+		for sV in self.stateVariables:
+			savestatefn += '\t\t' + 'Real ' + sV + ';\n'
+		savestatefn += '\t};\n'
+		savestatefn += '\t' + 'void saveState(State& state) const {\n'
+		for sV in self.stateVariables:
+			savestatefn += '\t\t' + 'state.' + sV + ' = ' + sV + ';\n'
+		savestatefn += '\t}\n'
+		return savestatefn
+	def MakeLoadStateFunction(self):
+		loadstatefn = '\t' + 'void loadState(const State& state) {\n'
+		for sV in self.stateVariables:
+			loadstatefn += '\t\t' + sV + ' = state.' + sV + ';\n'
+		loadstatefn += '\t}\n'
+		return loadstatefn
 
 class GeneratorWDFPort():
 	def __init__(self, name, generator):